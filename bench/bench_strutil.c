@@ -0,0 +1,1130 @@
+/*
+ * bench_strutil.c - Throughput benchmarks for the strutil kernels.
+ *
+ * Every kernel is timed once per SIMD level the CPU supports, next to the
+ * libc routine it replaces. Results are printed as GB/s of input scanned,
+ * or as MB/s when that would round to nothing.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fnmatch.h>
+#include <regex.h>
+#include "strutil.h"
+
+
+#define BENCH_MIN_SECONDS	0.25
+
+static const char *level_names[] = { "scalar", "sse2", "avx2", "avx512bw" };
+static const char *pattern_names[] = { "scalar/pat", "sse2/pat", "avx2/pat", "avx512bw/pat" };
+
+static volatile size_t sink;
+
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+static void report(const char *bench, const char *variant, size_t bytes,
+		   size_t iterations, double seconds)
+{
+	double rate = (double)bytes * (double)iterations / seconds;
+
+	if (rate >= 1e8)
+		printf("%-28s %-10s %9.2f GB/s\n", bench, variant, rate / 1e9);
+	else
+		printf("%-28s %-10s %9.2f MB/s\n", bench, variant, rate / 1e6);
+}
+
+
+/*
+ * Repeat STMT until BENCH_MIN_SECONDS have passed and report the rate.
+ */
+#define BENCH_RUN(bench, variant, bytes, STMT) do {			\
+	size_t _iters = 0;						\
+	double _start = now_seconds();					\
+	double _elapsed;						\
+	do {								\
+		STMT;							\
+		_iters++;						\
+		_elapsed = now_seconds() - _start;			\
+	} while (_elapsed < BENCH_MIN_SECONDS);				\
+	report((bench), (variant), (bytes), _iters, _elapsed);		\
+} while (0)
+
+
+static char *make_text(size_t size, unsigned int seed)
+{
+	char *buf = (char *)malloc(size + 1);
+	if (!buf)
+		return NULL;
+
+	srand(seed);
+	for (size_t i = 0; i < size; i++)
+		buf[i] = (rand() % 8) ? (char)('a' + rand() % 26) : ' ';
+	buf[size] = '\0';
+	return buf;
+}
+
+
+static void bench_find_case(const char *bench, char *hay, size_t hay_size,
+			    const char *needle)
+{
+	size_t needle_size = strlen(needle);
+	struct Str *s = str_init();
+	struct Str_pattern *pat = str_pattern_compile(needle, 0);
+	if (!s || !pat || str_add(s, hay)) {
+		str_pattern_free(pat);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN(bench, level_names[lv], hay_size,
+			  sink += str_find(s, needle, needle_size, 0));
+		BENCH_RUN(bench, pattern_names[lv], hay_size,
+			  sink += str_find_pattern(s, pat, 0));
+	}
+	str_simd_set_level(best);
+
+	// volatile keeps the compiler from hoisting the pure libc calls
+	char *volatile vhay = hay;
+	BENCH_RUN(bench, "strstr", hay_size,
+		  sink += (size_t)strstr(vhay, needle));
+	BENCH_RUN(bench, "memmem", hay_size,
+		  sink += (size_t)memmem(vhay, hay_size, needle, needle_size));
+
+	str_pattern_free(pat);
+	str_free(s);
+}
+
+
+static void bench_find(void)
+{
+	const size_t size = 1 << 20;
+	char *hay = make_text(size, 1);
+	if (!hay)
+		return;
+
+	// Needle only at the very end of ordinary text
+	const char *needle = "needle_in_the_haystack";
+	memcpy(hay + size - strlen(needle), needle, strlen(needle));
+	bench_find_case("find/text", hay, size, needle);
+
+	// Repetitive input where the first/last byte filter fires everywhere
+	memset(hay, 'a', size);
+	char periodic[65];
+	memset(periodic, 'a', 64);
+	periodic[32] = 'b';
+	periodic[64] = '\0';
+	bench_find_case("find/periodic", hay, size, periodic);
+
+	free(hay);
+}
+
+
+/*
+ * Case insensitive search of mixed case text, against the lowered copy
+ * plus search that callers did before and against strcasestr.
+ */
+static void bench_find_icase(void)
+{
+	const size_t size = 1 << 20;
+	char *hay = make_text(size, 2);
+	struct Str *s = str_init();
+	if (!hay || !s) {
+		free(hay);
+		str_free(s);
+		return;
+	}
+
+	for (size_t i = 0; i < size; i += 3) {
+		if (hay[i] != ' ')
+			hay[i] &= ~0x20;
+	}
+	const char *needle = "needle_in_the_haystack";
+	memcpy(hay + size - strlen(needle), "NEEDLE_in_the_HAYSTACK", strlen(needle));
+	if (str_add(s, hay)) {
+		free(hay);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("find/icase", level_names[lv], size,
+			  sink += str_find_ex(s, needle, strlen(needle), 0, STR_ICASE));
+	}
+	str_simd_set_level(best);
+
+	BENCH_RUN("find/icase", "lower+find", size, {
+		struct Str *copy = str_init();
+		str_add(copy, hay);
+		str_to_lower(copy);
+		sink += str_find(copy, needle, strlen(needle), 0);
+		str_free(copy);
+	});
+
+	char *volatile vhay = hay;
+	BENCH_RUN("find/icase", "strcasestr", size,
+		  sink += (size_t)strcasestr(vhay, needle));
+
+	free(hay);
+	str_free(s);
+}
+
+
+static void bench_count(void)
+{
+	const size_t size = 1 << 20;
+	char *hay = make_text(size, 3);
+	struct Str *s = str_init();
+	if (!hay || !s || str_add(s, hay)) {
+		free(hay);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("count/char", level_names[lv], size,
+			  sink += str_count_char(s, ' '));
+	}
+	str_simd_set_level(best);
+
+	char *volatile vhay = hay;
+	BENCH_RUN("count/char", "memchr", size, {
+		const char *p = vhay;
+		const char *end = vhay + size;
+		while ((p = memchr(p, ' ', (size_t)(end - p))) != NULL) {
+			sink++;
+			p++;
+		}
+	});
+
+	free(hay);
+	str_free(s);
+}
+
+
+/*
+ * Separator close to the end of a long string: the backward scan only
+ * touches the tail, strrchr walks the whole string. Rates are given for
+ * the full string size.
+ */
+static void bench_rfind(void)
+{
+	const size_t size = 1 << 20;
+	char *hay = make_text(size, 4);
+	struct Str *s = str_init();
+	if (!hay || !s) {
+		free(hay);
+		str_free(s);
+		return;
+	}
+
+	for (size_t i = 0; i < size; i++) {
+		if (hay[i] == '/')
+			hay[i] = ' ';
+	}
+	hay[size - 100] = '/';
+	memcpy(hay + size - 200, "::", 2);
+	if (str_add(s, hay)) {
+		free(hay);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("rfind/tail", level_names[lv], size,
+			  sink += str_rfind(s, "::", 2, STR_NPOS));
+	}
+	str_simd_set_level(best);
+
+	char *volatile vhay = hay;
+	BENCH_RUN("rfind/tail", "strrchr", size,
+		  sink += (size_t)strrchr(vhay, '/'));
+
+	free(hay);
+	str_free(s);
+}
+
+
+/*
+ * Case conversion over mixed-case text. The upper/lower pair keeps every
+ * iteration doing real work; rates are for both passes.
+ */
+static void bench_case(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 5);
+	struct Str *s = str_init();
+	if (!text || !s) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	for (size_t i = 0; i < size; i += 3)
+		if (text[i] != ' ')
+			text[i] -= 'a' - 'A';
+	if (str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("case/upper+lower", level_names[lv], 2 * size, {
+			str_to_upper(s);
+			str_to_lower(s);
+		});
+	}
+	str_simd_set_level(best);
+
+	char *volatile vtext = text;
+	BENCH_RUN("case/upper+lower", "toupper", 2 * size, {
+		char *p = vtext;
+		for (size_t i = 0; i < size; i++)
+			p[i] = (char)toupper((unsigned char)p[i]);
+		for (size_t i = 0; i < size; i++)
+			p[i] = (char)tolower((unsigned char)p[i]);
+	});
+
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("case/title", level_names[lv], size, str_to_title_case(s));
+	}
+	str_simd_set_level(best);
+
+	BENCH_RUN("case/title", "ctype", size, {
+		char *p = vtext;
+		int start = 1;
+		for (size_t i = 0; i < size; i++) {
+			unsigned char c = (unsigned char)p[i];
+			p[i] = (char)(start ? toupper(c) : tolower(c));
+			start = !isalnum(c);
+		}
+	});
+
+	free(text);
+	str_free(s);
+}
+
+
+static void bench_reverse(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 6);
+	struct Str *s = str_init();
+	if (!text || !s || str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("reverse", level_names[lv], size, str_reverse(s));
+	}
+	str_simd_set_level(best);
+
+	char *volatile vtext = text;
+	BENCH_RUN("reverse", "bytewise", size, {
+		char *p = vtext;
+		for (size_t i = 0, j = size - 1; i < j; i++, j--) {
+			char c = p[i];
+			p[i] = p[j];
+			p[j] = c;
+		}
+	});
+
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * A lower / delete / title chain, fused into one str_transform() call
+ * against the same ops as separate passes. The text is rebuilt before
+ * every run, since the delete shrinks it; the copy is in both numbers.
+ */
+static void bench_transform(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 7);
+	struct Str *s = str_init();
+	if (!text || !s) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	struct Str_charset vowels;
+	str_charset_init(&vowels, "aeiou");
+	const struct Str_op chain[] = {
+		{ .type = STR_OP_LOWER },
+		{ .type = STR_OP_DELETE, .set = &vowels },
+		{ .type = STR_OP_TITLE },
+	};
+
+	BENCH_RUN("transform/chain", "fused", size, {
+		str_clear(s);
+		if (!str_add(s, text))
+			sink += (size_t)str_transform(s, chain, 3);
+	});
+	BENCH_RUN("transform/chain", "separate", size, {
+		str_clear(s);
+		if (!str_add(s, text)) {
+			sink += (size_t)str_to_lower(s);
+			sink += (size_t)str_transform(s, &chain[1], 1);
+			sink += (size_t)str_to_title_case(s);
+		}
+	});
+
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * tr-style mapping of separators, digits and two letters, which touches
+ * three of the sixteen 16-byte rows of the table.
+ */
+static void bench_translate(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 8);
+	struct Str *s = str_init();
+	if (!text || !s || str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	uint8_t table[256];
+	for (int c = 0; c < 256; c++)
+		table[c] = (uint8_t)c;
+	table[' '] = table[','] = '_';
+	for (int c = '0'; c <= '9'; c++)
+		table[c] = '#';
+	table['q'] = 'k';
+	table['x'] = 'k';
+
+	struct Str_table *compiled = str_table_compile(table);
+	if (!compiled) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("translate", level_names[lv], size,
+			  sink += (size_t)str_translate_table(s, compiled));
+	}
+	str_simd_set_level(best);
+
+	char *volatile vtext = text;
+	BENCH_RUN("translate", "byte loop", size, {
+		char *p = vtext;
+		for (size_t i = 0; i < size; i++)
+			p[i] = (char)table[(unsigned char)p[i]];
+	});
+
+	str_table_free(compiled);
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * Whitespace squeeze on text with tabs, newlines and a double space
+ * every few hundred bytes. Each run rebuilds the string first, the copy
+ * is included in the rate of both variants.
+ */
+static void bench_squeeze_ws(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 9);
+	char *work = (char *)malloc(size + 1);
+	struct Str *s = str_init();
+	if (!text || !work || !s) {
+		free(text);
+		free(work);
+		str_free(s);
+		return;
+	}
+
+	for (size_t i = 1; i < size; i++) {
+		if (text[i] == ' ' && text[i - 1] == ' ')
+			text[i] = 'x';
+		else if (text[i] == ' ' && i % 5 == 0)
+			text[i] = (i % 2) ? '\t' : '\n';
+	}
+	for (size_t i = 300; i + 1 < size; i += 300)
+		text[i] = text[i + 1] = ' ';
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("ws/squeeze", level_names[lv], size, {
+			str_clear(s);
+			if (!str_add(s, text))
+				sink += (size_t)str_squeeze_ws(s);
+		});
+	}
+	str_simd_set_level(best);
+
+	char *volatile vwork = work;
+	BENCH_RUN("ws/squeeze", "isspace", size, {
+		char *p = vwork;
+		size_t w = 0;
+		int prev = 0;
+		memcpy(p, text, size + 1);
+		for (size_t i = 0; i < size; i++) {
+			int ws = isspace((unsigned char)p[i]);
+			if (!(ws && prev))
+				p[w++] = ws ? ' ' : p[i];
+			prev = ws;
+		}
+		p[w] = '\0';
+		sink += w;
+	});
+
+	free(text);
+	free(work);
+	str_free(s);
+}
+
+
+/*
+ * Validator and sanitizer on a 1 MiB payload: the span of an identifier
+ * set over letters and spaces, and removal of markup bytes that make up
+ * about one byte in a hundred. Every removal run first restores the
+ * payload, so the copy is part of both removal rates.
+ */
+static void bench_charset(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 10);
+	char *work = (char *)malloc(size + 1);
+	struct Str *s = str_init();
+	if (!text || !work || !s || str_add(s, text)) {
+		free(text);
+		free(work);
+		str_free(s);
+		return;
+	}
+
+	// s keeps the clean letters for the span, text gets the markup
+	struct Str_charset word, markup;
+	str_charset_init(&word, " abcdefghijklmnopqrstuvwxyz");
+	str_charset_init(&markup, "<>&\"'");
+	for (size_t i = 97; i < size; i += 97)
+		text[i] = "<>&\"'"[i % 5];
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("charset/span", level_names[lv], size, sink += str_span(s, &word));
+	}
+	str_simd_set_level(best);
+
+	const char *volatile clean = s->data;
+	BENCH_RUN("charset/span", "strspn", size,
+		  sink += strspn(clean, " abcdefghijklmnopqrstuvwxyz"));
+
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("charset/remove", level_names[lv], size, {
+			str_clear(s);
+			if (!str_add(s, text))
+				sink += (size_t)str_remove_chars(s, &markup, STR_KEEP_CAPACITY);
+		});
+	}
+	str_simd_set_level(best);
+
+	char *volatile vwork = work;
+	BENCH_RUN("charset/remove", "strchr", size, {
+		char *p = vwork;
+		size_t w = 0;
+		memcpy(p, text, size + 1);
+		for (size_t i = 0; i < size; i++) {
+			if (!strchr("<>&\"'", p[i]))
+				p[w++] = p[i];
+		}
+		p[w] = '\0';
+		sink += w;
+	});
+
+	free(text);
+	free(work);
+	str_free(s);
+}
+
+
+/*
+ * make_text() with about one word in eight accented, CJK or an emoji,
+ * for the UTF-8 benchmarks.
+ */
+static char *make_utf8_text(size_t size, unsigned int seed)
+{
+	static const char *const words[] = {
+		"caf\xc3\xa9 ", "\xe6\x97\xa5\xe6\x9c\xac ", "na\xc3\xafve ",
+		"\xf0\x9f\x98\x80 ",
+	};
+	char *text = make_text(size, seed);
+	if (!text)
+		return NULL;
+
+	for (size_t i = 0; i + 16 < size; i += 64) {
+		const char *w = words[(i >> 6) & 3];
+		memcpy(text + i, w, strlen(w));
+	}
+	return text;
+}
+
+
+/*
+ * UTF-8 validation of 1 MiB of mixed text, uncached at every level and
+ * then from the cache.
+ */
+static void bench_utf8(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_utf8_text(size, 11);
+	struct Str *s = str_init();
+	if (!text || !s || str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("utf8/validate", level_names[lv], size, {
+			str_touch(s);
+			sink += str_utf8_validate(s);
+		});
+	}
+	str_simd_set_level(best);
+
+	BENCH_RUN("utf8/validate", "cached", size, sink += str_utf8_validate(s));
+
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * Unicode upper and lower case on the same mixed text, at every level,
+ * with the Turkic rules, and the ASCII-only str_to_upper() for scale.
+ * Upper and lower alternate so every run has work to do.
+ */
+static void bench_utf8_case(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_utf8_text(size, 12);
+	struct Str *s = str_init();
+	if (!text || !s || str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("utf8/case", level_names[lv], 2 * size, {
+			sink += (size_t)str_utf8_to_upper(s, 0);
+			sink += (size_t)str_utf8_to_lower(s, 0);
+		});
+	}
+	str_simd_set_level(best);
+
+	BENCH_RUN("utf8/case", "turkic", 2 * size, {
+		sink += (size_t)str_utf8_to_upper(s, STR_TURKIC);
+		sink += (size_t)str_utf8_to_lower(s, STR_TURKIC);
+	});
+	BENCH_RUN("utf8/case", "ascii only", 2 * size, {
+		sink += (size_t)str_to_upper(s);
+		sink += (size_t)str_to_lower(s);
+	});
+
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * Code point counts of the mixed text at every level, then lookups of
+ * random code point offsets with the position index kept and dropped
+ * before each lookup. Lookups count the bytes a scan from the start
+ * would cover, so the two rows compare directly.
+ */
+static void bench_utf8_index(void)
+{
+	const size_t size = 1 << 20;
+	char *text = make_utf8_text(size, 13);
+	struct Str *s = str_init();
+	if (!text || !s || str_add(s, text)) {
+		free(text);
+		str_free(s);
+		return;
+	}
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("utf8/length", level_names[lv], size, sink += str_utf8_length(s));
+	}
+	str_simd_set_level(best);
+
+	enum { LOOKUPS = 64 };
+	size_t length = str_utf8_length(s);
+	size_t index[LOOKUPS], covered = 0;
+	srand(14);
+	for (int i = 0; i < LOOKUPS; i++) {
+		index[i] = (size_t)rand() % length;
+		covered += str_utf8_offset(s, index[i]);
+	}
+
+	BENCH_RUN("utf8/offset", "indexed", covered, {
+		for (int i = 0; i < LOOKUPS; i++)
+			sink += str_utf8_offset(s, index[i]);
+	});
+	BENCH_RUN("utf8/offset", "rescan", covered, {
+		for (int i = 0; i < LOOKUPS; i++) {
+			str_touch(s);
+			sink += str_utf8_offset(s, index[i]);
+		}
+	});
+
+	free(text);
+	str_free(s);
+}
+
+
+/*
+ * Hex and base64 of 1 MiB of random bytes at every level. Encoding
+ * starts from an empty string each round, as does the row that encodes
+ * into a separate buffer and appends that with str_add(). Decoding
+ * rounds add the digits again first, which is counted in.
+ */
+static void bench_codec(void)
+{
+	const size_t size = 1 << 20;
+	unsigned char *bytes = (unsigned char *)malloc(size);
+	char *buf = (char *)malloc(2 * size + 1);
+	struct Str *hex = str_init();
+	struct Str *b64 = str_init();
+	struct Str *s = str_init();
+	if (!bytes || !buf || !hex || !b64 || !s) {
+		free(bytes);
+		free(buf);
+		str_free(hex);
+		str_free(b64);
+		str_free(s);
+		return;
+	}
+
+	srand(15);
+	for (size_t i = 0; i < size; i++)
+		bytes[i] = (unsigned char)rand();
+	if (str_add_hex(hex, bytes, size, 0) || str_add_base64(b64, bytes, size))
+		goto out;
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("codec/hex encode", level_names[lv], size, {
+			str_clear(s);
+			sink += (size_t)str_add_hex(s, bytes, size, 0);
+		});
+	}
+	str_simd_set_level(best);
+
+	char *volatile vbuf = buf;
+	BENCH_RUN("codec/hex encode", "buffer", size, {
+		char *p = vbuf;
+		for (size_t i = 0; i < size; i++) {
+			p[2 * i] = "0123456789abcdef"[bytes[i] >> 4];
+			p[2 * i + 1] = "0123456789abcdef"[bytes[i] & 15];
+		}
+		p[2 * size] = '\0';
+		str_clear(s);
+		sink += (size_t)str_add(s, p);
+	});
+
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("codec/hex decode", level_names[lv], hex->size, {
+			str_clear(s);
+			if (!str_add(s, hex->data))
+				sink += (size_t)str_decode_hex(s, STR_KEEP_CAPACITY);
+		});
+	}
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("codec/base64 encode", level_names[lv], size, {
+			str_clear(s);
+			sink += (size_t)str_add_base64(s, bytes, size);
+		});
+	}
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("codec/base64 decode", level_names[lv], b64->size, {
+			str_clear(s);
+			if (!str_add(s, b64->data))
+				sink += (size_t)str_decode_base64(s, STR_KEEP_CAPACITY);
+		});
+	}
+	str_simd_set_level(best);
+
+out:
+	free(bytes);
+	free(buf);
+	str_free(hex);
+	str_free(b64);
+	str_free(s);
+}
+
+
+/*
+ * Escaping 1 MiB of text with a markup byte every 97 at every level and
+ * in every format, and unescaping the result. The "switch" row is the
+ * usual per-byte loop that appends each escape with str_add().
+ */
+static void bench_escape(void)
+{
+	static const char *const names[] = { "json", "csv", "html", "url" };
+	const size_t size = 1 << 20;
+	char *text = make_text(size, 16);
+	struct Str *s = str_init();
+	struct Str *esc = str_init();
+	if (!text || !s || !esc) {
+		free(text);
+		str_free(s);
+		str_free(esc);
+		return;
+	}
+	for (size_t i = 97; i < size; i += 97)
+		text[i] = "<>&\"'\n"[i % 6];
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		BENCH_RUN("escape/html", level_names[lv], size, {
+			str_clear(s);
+			sink += (size_t)str_add_escaped(s, text, size, STR_ESC_HTML);
+		});
+	}
+	str_simd_set_level(best);
+
+	const char *volatile vtext = text;
+	char one[2] = "";
+	BENCH_RUN("escape/html", "switch", size, {
+		const char *p = vtext;
+		str_clear(s);
+		for (size_t i = 0; i < size; i++) {
+			switch (p[i]) {
+			case '&': sink += (size_t)str_add(s, "&amp;"); break;
+			case '<': sink += (size_t)str_add(s, "&lt;"); break;
+			case '>': sink += (size_t)str_add(s, "&gt;"); break;
+			case '"': sink += (size_t)str_add(s, "&quot;"); break;
+			case '\'': sink += (size_t)str_add(s, "&#39;"); break;
+			default:
+				one[0] = p[i];
+				sink += (size_t)str_add(s, one);
+			}
+		}
+	});
+
+	for (int m = STR_ESC_JSON; m <= STR_ESC_URL; m++) {
+		char bench[32];
+		snprintf(bench, sizeof(bench), "escape/%s", names[m]);
+		BENCH_RUN(bench, "escape", size, {
+			str_clear(s);
+			sink += (size_t)str_add_escaped(s, text, size, (enum str_escape)m);
+		});
+
+		str_clear(esc);
+		if (str_add_escaped(esc, text, size, (enum str_escape)m))
+			continue;
+		BENCH_RUN(bench, "unescape", esc->size, {
+			str_clear(s);
+			if (!str_add(s, esc->data))
+				sink += (size_t)str_unescape(s, (enum str_escape)m, STR_KEEP_CAPACITY);
+		});
+	}
+
+	free(text);
+	str_free(s);
+	str_free(esc);
+}
+
+
+/*
+ * Globs on a 4 KiB string: a routing style pattern, and one that makes a
+ * backtracking matcher retry every split of the input between the stars.
+ */
+static void bench_glob_case(const char *bench, const char *text,
+			    const char *pattern)
+{
+	size_t size = strlen(text);
+	struct Str *s = str_init();
+	struct Str_glob *glob = str_glob_compile(pattern, 0);
+	if (!s || !glob || str_add(s, text)) {
+		str_glob_free(glob);
+		str_free(s);
+		return;
+	}
+
+	BENCH_RUN(bench, "dfa", size, sink += str_glob_match(s, glob));
+
+	const char *volatile vtext = text;
+	BENCH_RUN(bench, "fnmatch", size, sink += (size_t)fnmatch(pattern, vtext, 0));
+
+	str_glob_free(glob);
+	str_free(s);
+}
+
+
+static void bench_glob(void)
+{
+	const size_t size = 4096;
+	char *text = make_text(size, 5);
+	if (!text)
+		return;
+
+	memcpy(text, "user-42-", 8);
+	memcpy(text + size - 4, ".log", 4);
+	bench_glob_case("glob/route", text, "user-?\?-*.log");
+
+	memset(text, 'a', size);
+	bench_glob_case("glob/stars", text, "*a*a*a*a*b");
+
+	free(text);
+}
+
+
+/*
+ * Leftmost-longest search over 64 KiB with a single match at the end: one
+ * pattern with a literal for the prefilter, and one the DFA scans alone.
+ */
+static void bench_regex_case(const char *bench, const char *text,
+			     const char *pattern)
+{
+	size_t size = strlen(text);
+	struct Str *s = str_init();
+	struct Str_regex *re = str_regex_compile(pattern, 0);
+	regex_t posix;
+	if (!s || !re || str_add(s, text) || regcomp(&posix, pattern, REG_EXTENDED)) {
+		str_regex_free(re);
+		str_free(s);
+		return;
+	}
+
+	BENCH_RUN(bench, "lazy-dfa", size, sink += str_search(s, re, 0, NULL));
+
+	regmatch_t m;
+	BENCH_RUN(bench, "regexec", size, sink += (size_t)regexec(&posix, text, 1, &m, 0));
+
+	regfree(&posix);
+	str_regex_free(re);
+	str_free(s);
+}
+
+
+/*
+ * Replacing every 'a' in a run of them, once with "a", where each search
+ * stops after one byte, and once with "a|a*b", where each one reads the
+ * rest of the run: the second rate falls with the run length. The match
+ * is replaced by itself, so the text stays the same between runs.
+ */
+static void bench_regex_replace(size_t size)
+{
+	char bench[32];
+	char *text = (char *)malloc(size + 1);
+	struct Str *s = str_init();
+	struct Str_regex *one = str_regex_compile("a", 0);
+	struct Str_regex *longest = str_regex_compile("a|a*b", 0);
+	if (!text || !s || !one || !longest)
+		goto out;
+
+	memset(text, 'a', size);
+	text[size] = '\0';
+	if (str_add(s, text))
+		goto out;
+
+	snprintf(bench, sizeof(bench), "regex/replace-%zuk", size / 1024);
+	BENCH_RUN(bench, "a", size, sink += (size_t)str_replace_regex(s, one, "a"));
+	BENCH_RUN(bench, "a|a*b", size, sink += (size_t)str_replace_regex(s, longest, "a"));
+
+out:
+	str_regex_free(longest);
+	str_regex_free(one);
+	str_free(s);
+	free(text);
+}
+
+
+static void bench_regex(void)
+{
+	const size_t size = 64 * 1024;
+	char *text = make_text(size, 6);
+	if (!text)
+		return;
+
+	memcpy(text + size - 16, "order-4711 done", 15);
+	bench_regex_case("regex/literal", text, "order-[0-9]+");
+	bench_regex_case("regex/dfa", text, "[0-9]+ (done|ok)");
+
+	free(text);
+
+	bench_regex_replace(1024);
+	bench_regex_replace(8 * 1024);
+}
+
+
+// Textbook O(n * m) dynamic programming, one row at a time
+static size_t edit_distance_dp(const char *a, size_t m, const char *b, size_t n,
+			       size_t *row)
+{
+	for (size_t j = 0; j <= n; j++)
+		row[j] = j;
+	for (size_t i = 1; i <= m; i++) {
+		size_t diag = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= n; j++) {
+			size_t up = row[j];
+			size_t v = diag + (a[i - 1] != b[j - 1]);
+			if (up + 1 < v)
+				v = up + 1;
+			if (row[j - 1] + 1 < v)
+				v = row[j - 1] + 1;
+			row[j] = v;
+			diag = up;
+		}
+	}
+	return row[n];
+}
+
+
+/*
+ * Edit distance of two similar strings, short and long, counted in DP
+ * matrix cells per second (the "GB/s" column is Gcells/s here); then a
+ * top-10 lookup among 100k words, in bytes of candidates per second.
+ */
+static void bench_edit_case(const char *bench, size_t size)
+{
+	char *a = make_text(size, 7);
+	char *b = make_text(size, 7);
+	size_t *row = (size_t *)malloc((size + 1) * sizeof(size_t));
+	struct Str *sa = str_init();
+	struct Str *sb = str_init();
+	if (!a || !b || !row || !sa || !sb)
+		goto out;
+
+	for (size_t i = 0; i < size; i += 9)
+		b[i] = 'A';
+	if (str_add(sa, a) || str_add(sb, b))
+		goto out;
+
+	BENCH_RUN(bench, "myers", size * size, sink += str_edit_distance(sa, sb, STR_NPOS));
+	BENCH_RUN(bench, "dp", size * size, sink += edit_distance_dp(a, size, b, size, row));
+
+out:
+	str_free(sa);
+	str_free(sb);
+	free(row);
+	free(a);
+	free(b);
+}
+
+
+static void bench_fuzzy(void)
+{
+	const size_t n = 100000;
+	const size_t len = 12;
+	char *text = make_text(n * len, 8);
+	struct Str **words = (struct Str **)calloc(n, sizeof(*words));
+	struct Str *query = str_init();
+	if (!text || !words || !query || str_add(query, "quick brown"))
+		goto out;
+
+	for (size_t i = 0; i < n; i++) {
+		char word[16];
+		memcpy(word, text + i * len, len);
+		word[len] = '\0';
+		words[i] = str_init();
+		if (!words[i] || str_add(words[i], word))
+			goto out;
+	}
+
+	struct Str_fuzzy_hit hits[10];
+	BENCH_RUN("fuzzy/top10", "threads", n * len,
+		  sink += str_fuzzy_topk(query, words, n, 10, hits));
+
+out:
+	if (words) {
+		for (size_t i = 0; i < n; i++)
+			str_free(words[i]);
+	}
+	free(words);
+	str_free(query);
+	free(text);
+}
+
+
+static void bench_edit(void)
+{
+	bench_edit_case("edit/short", 24);
+	bench_edit_case("edit/long", 2000);
+	bench_fuzzy();
+}
+
+
+int main(void)
+{
+	printf("%-28s %-10s %14s\n", "benchmark", "variant", "throughput");
+	bench_find();
+	bench_find_icase();
+	bench_count();
+	bench_rfind();
+	bench_case();
+	bench_reverse();
+	bench_transform();
+	bench_translate();
+	bench_squeeze_ws();
+	bench_charset();
+	bench_utf8();
+	bench_utf8_case();
+	bench_utf8_index();
+	bench_codec();
+	bench_escape();
+	bench_glob();
+	bench_regex();
+	bench_edit();
+	return 0;
+}
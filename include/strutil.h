@@ -18,15 +18,71 @@
  * - `str_input()`: Read a string from standard input.
  * - `str_add_input()`: Append input from standard input to existing data.
  * - `str_pop_back()`: Remove trailing data after a specified separator.
+ * - `str_pop_back_any()` / `str_pop_back_str()`: Remove trailing data after
+ *   the last byte from a set, or after the last multi-byte separator.
  * - `str_print()`: Print the string data to standard output.
  * - `str_get_size()`: Get the length of the string.
  * - `str_clear()`: Clear the string data.
  * - `str_free()`: Free the `Str` structure and its associated resources.
  * - `str_rem_word()`: Remove a specified word from the string.
  * - `str_swap_word()`: Swap occurrences of two words in the string.
+ * - `str_replace_all()` / `str_replace_all_ex()`: Replace every occurrence
+ *   of a word in one pass.
+ * - `str_rem_all()`: Remove every occurrence of a word in one pass.
+ * - `str_find()` / `str_find_ex()`: Find a substring with the SIMD search
+ *   kernel.
+ * - `str_rfind()`: Find the last occurrence of a substring.
+ * - `str_count_char()` / `str_count()`: Count occurrences of a byte or word.
+ * - `str_find_all()`: Collect the offsets of every occurrence in one pass.
+ * - `str_simd_get_level()` / `str_simd_set_level()`: Query or override the
+ *   instruction set used by the SIMD kernels.
+ * - `str_pattern_compile()` / `str_pattern_free()`: Precompile a search
+ *   needle for reuse across many strings and threads.
+ * - `str_find_pattern()`, `str_count_pattern()`, `str_rem_pattern()`,
+ *   `str_replace_pattern()`: Search and edit with a compiled pattern.
+ * - `str_dict_compile()` / `str_dict_free()`: Compile a word -> replacement
+ *   dictionary.
+ * - `str_dict_replace()`: Replace all dictionary words in a single scan.
+ * - `str_apply_edits()`: Apply a sorted list of offset edits in one rebuild.
+ * - `str_glob_compile()` / `str_glob_free()`: Compile a wildcard pattern
+ *   into a DFA.
+ * - `str_glob_match()`: Match the whole string against a compiled glob.
+ * - `str_regex_compile()` / `str_regex_free()`: Compile a regular
+ *   expression into a lazily built DFA.
+ * - `str_match()`, `str_search()`, `str_replace_regex()`: Match, find and
+ *   replace with a compiled regex.
+ * - `str_edit_distance()`: Levenshtein distance with an optional cutoff.
+ * - `str_fuzzy_topk()`: The k candidates closest to a query, scanned on
+ *   several threads.
  * - `str_to_upper()`: Convert the string to uppercase.
  * - `str_to_lower()`: Convert the string to lowercase.
  * - `str_to_title_case()`: Convert the string to title case.
+ * - `str_to_title_case_set()`: Title case with caller chosen word boundaries.
+ * - `str_charset_init()`: Build a byte set for str_to_title_case_set().
+ * - `str_transform()`: Apply a chain of byte level ops in a single pass.
+ * - `str_translate()`: Map every byte through a 256 entry table, like tr.
+ * - `str_table_compile()`: Prepare a translation table for reuse.
+ * - `str_translate_table()`: Translate with a compiled table.
+ * - `str_trim()`, `str_trim_left()`, `str_trim_right()`: Strip whitespace
+ *   from the ends.
+ * - `str_squeeze_ws()`: Collapse runs of whitespace into single spaces.
+ * - `str_span()` / `str_cspan()`: Length of the prefix made of (or free of)
+ *   the bytes in a set.
+ * - `str_remove_chars()`: Remove every byte of a set.
+ * - `str_utf8_validate()`: Check for valid UTF-8, with the result cached.
+ * - `str_utf8_repair()`: Replace invalid UTF-8 with U+FFFD.
+ * - `str_utf8_to_upper()`, `str_utf8_to_lower()`, `str_utf8_to_title_case()`:
+ *   Unicode case mapping of UTF-8 text.
+ * - `str_utf8_length()`: Number of code points.
+ * - `str_utf8_offset()`: Byte offset of the Nth code point, from an index.
+ * - `str_utf8_reverse()`: Reverse the characters of UTF-8 text.
+ * - `str_touch()`: Drop cached state after writing to the data directly.
+ * - `str_add_hex()` / `str_add_base64()`: Append binary data as hex or
+ *   base64 digits.
+ * - `str_decode_hex()` / `str_decode_base64()`: Turn hex or base64 text back
+ *   into the bytes it encodes, in place.
+ * - `str_add_escaped()`: Append text escaped for JSON, CSV, HTML or URLs.
+ * - `str_unescape()`: Undo one of those escapings in place.
  * - `str_reverse()`: Reverse the string.
  * - `str_is_empty()`: Check if the string is empty.
  * - `get_dyn_input()`: Helper function to read input dynamically.
@@ -58,13 +114,174 @@
 
 extern const size_t MAX_STRING_SIZE;
 
+/*
+ * Flags for the bulk editing and search functions.
+ *
+ * STR_KEEP_CAPACITY: do not give memory back after data was removed, so
+ *                    later appends can reuse it without a realloc.
+ * STR_WHOLE_WORD:    only match where the needle is not part of a longer
+ *                    word. Word bytes are ASCII letters, digits, '_' and
+ *                    all bytes of multibyte UTF-8 characters; a side of
+ *                    the needle that does not end in a word byte is not
+ *                    checked.
+ * STR_ICASE:         ASCII letters match regardless of case. Bytes outside
+ *                    'A'..'Z' and 'a'..'z' still have to match exactly.
+ * STR_TURKIC:        UTF-8 case mapping follows the Turkish and Azeri
+ *                    rules: i <-> U+0130 and U+0131 <-> I.
+ * STR_HEX_UPPER:     str_add_hex() writes the digits A..F, not a..f.
+ */
+#define STR_KEEP_CAPACITY	0x01u
+#define STR_WHOLE_WORD		0x02u
+#define STR_ICASE		0x04u
+#define STR_TURKIC		0x08u
+#define STR_HEX_UPPER		0x10u
+
+/* Returned by the search functions when there is no match. */
+#define STR_NPOS	((size_t)-1)
+
+/*
+ * Instruction sets the SIMD kernels can be built for. The best one the CPU
+ * supports is picked automatically on first use.
+ */
+enum str_simd_level {
+	STR_SIMD_SCALAR = 0,
+	STR_SIMD_SSE2,
+	STR_SIMD_AVX2,
+	STR_SIMD_AVX512BW,	/* kernels without a 512-bit version run the AVX2 one */
+};
+
+
+/*
+ * Values of Str.utf8, the result of the last str_utf8_validate(). Every
+ * function that changes the data resets it to STR_UTF8_UNKNOWN, unless it
+ * only rewrites or strips ASCII in a way that cannot change the outcome;
+ * code that writes to data directly has to call str_touch().
+ */
+enum str_utf8_state {
+	STR_UTF8_UNKNOWN = 0,
+	STR_UTF8_VALID,
+	STR_UTF8_INVALID,
+};
 
 struct Str {
 	char	*data;
+	size_t	size;		/* length of data, without the terminator */
+	size_t	capacity;	/* bytes allocated for data, without the terminator */
 	unsigned char is_dynamic;
+	unsigned char utf8;	/* enum str_utf8_state */
+	struct Str_index *index;	/* code point offsets, built on demand */
 	pthread_mutex_t lock;
 };
 
+/*
+ * A compiled search needle, see str_pattern_compile(). The layout is
+ * private to the library.
+ */
+struct Str_pattern;
+
+/*
+ * A compiled multi-word dictionary, see str_dict_compile(). The layout is
+ * private to the library.
+ */
+struct Str_dict;
+
+/*
+ * A compiled glob pattern, see str_glob_compile(). The layout is private
+ * to the library.
+ */
+struct Str_glob;
+
+/*
+ * A compiled regular expression, see str_regex_compile(). The layout is
+ * private to the library.
+ */
+struct Str_regex;
+
+/*
+ * A compiled translation table, see str_table_compile(). The layout is
+ * private to the library.
+ */
+struct Str_table;
+
+/*
+ * Sampled code point offsets of a string, see str_utf8_offset(). The
+ * layout is private to the library.
+ */
+struct Str_index;
+
+/*
+ * One result of str_fuzzy_topk(): the candidate's position in the input
+ * array and its edit distance to the query.
+ */
+struct Str_fuzzy_hit {
+	size_t	index;
+	size_t	distance;
+};
+
+/*
+ * A set of byte values: @c is in the set when bit (c & 63) of
+ * bits[c >> 6] is set. Fill it with str_charset_init() or set the bits
+ * directly.
+ */
+struct Str_charset {
+	uint64_t bits[4];
+};
+
+/*
+ * Byte level ops for str_transform().
+ *
+ * STR_OP_LOWER, STR_OP_UPPER: ASCII case mapping.
+ * STR_OP_TITLE:   title case as str_to_title_case_set(), @set being the
+ *                 word boundaries (NULL for the default ones).
+ * STR_OP_MAP:     every byte c becomes @table[c].
+ * STR_OP_DELETE:  drop the bytes in @set.
+ * STR_OP_SQUEEZE: collapse runs of the same byte from @set to one byte.
+ */
+enum str_op_type {
+	STR_OP_LOWER,
+	STR_OP_UPPER,
+	STR_OP_TITLE,
+	STR_OP_MAP,
+	STR_OP_DELETE,
+	STR_OP_SQUEEZE,
+};
+
+struct Str_op {
+	enum str_op_type type;
+	const struct Str_charset *set;
+	const unsigned char *table;	/* 256 entries, for STR_OP_MAP */
+};
+
+/*
+ * Output formats for str_add_escaped() and str_unescape().
+ *
+ * STR_ESC_JSON: the inside of a JSON string. '"', '\\' and the control
+ *               characters are escaped, \n style where JSON has one and
+ *               \u00XX otherwise.
+ * STR_ESC_CSV:  one CSV field as in RFC 4180: quoted, with '"' doubled,
+ *               if it holds a '"', ',', CR or LF.
+ * STR_ESC_HTML: text or attribute values; & < > " ' become entities.
+ * STR_ESC_URL:  percent-encoding of every byte but the RFC 3986
+ *               unreserved characters A-Z a-z 0-9 - . _ ~
+ */
+enum str_escape {
+	STR_ESC_JSON,
+	STR_ESC_CSV,
+	STR_ESC_HTML,
+	STR_ESC_URL,
+};
+
+/*
+ * One edit for str_apply_edits(): delete @del_len bytes at @offset of the
+ * original string and put the @ins_len bytes at @ins in their place.
+ */
+struct Str_edit {
+	size_t	offset;
+	size_t	del_len;
+	const char *ins;
+	size_t	ins_len;
+};
+
 struct Pointer_counter {
 	struct Str *str_ptr;
 	struct Pointer_counter *next;
@@ -150,14 +367,48 @@ void str_free(struct Str *self);
  *
  * This function trims the string data in the Str structure by removing
  * the portion of the string following the last occurrence of the specified
- * separator character. Thread safety is ensured by using mutex locking.
- * Returns 0 on success, or a negative error code if an error occurs.
+ * separator character. The separator is searched backwards from the end,
+ * so the cost depends on the length of the removed tail only. Thread
+ * safety is ensured by using mutex locking. Returns 0 on success, or a
+ * negative error code if an error occurs.
  *
- * Return: 0 on success, or a negative error code on failure.
+ * Return: 0 on success, -EINVAL if @sep does not occur, or -1 if the
+ * string is NULL or empty.
  */
 int str_pop_back(struct Str *self, char sep);
 
 
+/*
+ * str_pop_back_any - Remove the trailing portion of the string after the
+ * last byte that is in a set.
+ *
+ * @self: Pointer to the Str structure from which the data will be modified.
+ * @set: NUL terminated set of separator bytes, e.g. "/\\".
+ *
+ * Like str_pop_back(), the separator itself is kept. Sets of up to eight
+ * bytes are scanned backwards with vector compares.
+ *
+ * Return: 0 on success, -EINVAL if no byte of @set occurs or @set is
+ * empty, or -1 if the string is NULL or empty.
+ */
+int str_pop_back_any(struct Str *self, const char *set);
+
+
+/*
+ * str_pop_back_str - Remove the trailing portion of the string after the
+ * last occurrence of a separator string.
+ *
+ * @self: Pointer to the Str structure from which the data will be modified.
+ * @sep: NUL terminated separator, e.g. "::" or " - ".
+ *
+ * Like str_pop_back(), the separator itself is kept.
+ *
+ * Return: 0 on success, -EINVAL if @sep does not occur or is empty, or -1
+ * if the string is NULL or empty.
+ */
+int str_pop_back_str(struct Str *self, const char *sep);
+
+
 /*
  * str_get_size - Get the length of the string in the Str structure.
  *
@@ -240,9 +491,12 @@ int str_add_input(struct Str *self);
  *
  * @self: Pointer to the Str structure containing the string to convert.
  *
- * This function transforms all lowercase characters in the string data
- * to uppercase. Thread safety is maintained through mutex locking. If
- * the Str structure or its data is NULL, returns -1.
+ * This function transforms all lowercase ASCII characters in the string
+ * data to uppercase, using the widest SIMD kernel the CPU supports (see
+ * str_simd_get_level()). All other bytes, including embedded NULs and
+ * UTF-8 sequences, are left as they are. Thread safety is maintained
+ * through mutex locking. If the Str structure or its data is NULL,
+ * returns -1.
  *
  * Return: 0 on success, or -1 if the Str structure or data is NULL.
  */
@@ -254,9 +508,10 @@ int str_to_upper(struct Str *self);
  *
  * @self: Pointer to the Str structure containing the string to convert.
  *
- * This function transforms all uppercase characters in the string data
- * to lowercase. Mutex locking is used to ensure thread safety. Returns 0
- * on success, or -1 if the Str structure or data is NULL.
+ * This function transforms all uppercase ASCII characters in the string
+ * data to lowercase, with the same kernels as str_to_upper(). Mutex
+ * locking is used to ensure thread safety. Returns 0 on success, or -1 if
+ * the Str structure or data is NULL.
  *
  * Return: 0 on success, or -1 if the Str structure or data is NULL.
  */
@@ -296,6 +551,502 @@ char* get_dyn_input(size_t max_str_size);
 int str_swap_word(struct Str *self, const char *word1, const char *word2);
 
 
+/*
+ * str_replace_all - Replace every occurrence of a word in the string.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @from: The word to be replaced, must not be empty.
+ * @to: The word to replace @from with, may be empty.
+ *
+ * Matches are found left to right without overlapping, in a single scan.
+ * When @from and @to have the same length the data is overwritten in place
+ * and nothing is allocated. A shorter @to is compacted in place; a longer
+ * one is written once into a buffer of the exact final size. Mutex locking
+ * ensures thread safety.
+ *
+ * Return: Number of replacements made (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_replace_all(struct Str *self, const char *from, const char *to);
+
+
+/*
+ * str_replace_all_ex - Replace every occurrence of a word, with flags.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @from: The word to be replaced, must not be empty.
+ * @to: The word to replace @from with, may be empty.
+ * @flags: STR_WHOLE_WORD to skip matches inside longer words, STR_ICASE to
+ *         ignore ASCII case, or 0.
+ *
+ * Same as str_replace_all(), which is this function with @flags 0.
+ *
+ * Return: Number of replacements made (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_replace_all_ex(struct Str *self, const char *from, const char *to,
+		       unsigned int flags);
+
+
+/*
+ * str_rem_all - Remove every occurrence of a word from the string.
+ *
+ * @self: Pointer to the Str structure from which the word will be removed.
+ * @needle: The word to remove, must not be empty.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, STR_WHOLE_WORD to
+ *         skip matches inside longer words, STR_ICASE to ignore ASCII
+ *         case, or 0.
+ *
+ * The buffer is compacted in a single sweep with a read and a write
+ * pointer, so the cost is linear in the string length no matter how many
+ * matches there are. Unless STR_KEEP_CAPACITY is given, the spare memory
+ * is released afterwards. Mutex locking ensures thread safety.
+ *
+ * Return: Number of occurrences removed (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_rem_all(struct Str *self, const char *needle, unsigned int flags);
+
+
+/*
+ * str_find - Find the first occurrence of a byte string.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @needle: Bytes to look for, need not be NUL terminated.
+ * @len: Number of bytes in @needle.
+ * @start: Offset at which the search begins.
+ *
+ * Candidate positions are found with an SSE2/AVX2 filter on the first and
+ * last byte of @needle and then verified. If verification starts costing
+ * more than the scan itself (highly repetitive input), the search switches
+ * to the Two-Way algorithm, so the running time stays linear in the worst
+ * case. The cached size is used, the data is never scanned for its end.
+ * An empty needle matches at @start. Mutex locking ensures thread safety.
+ *
+ * Return: Offset of the match, or STR_NPOS if there is none or on error.
+ */
+size_t str_find(struct Str *self, const char *needle, size_t len, size_t start);
+
+
+/*
+ * str_find_ex - Find the first occurrence of a byte string, with flags.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @needle: Bytes to look for, need not be NUL terminated.
+ * @len: Number of bytes in @needle.
+ * @start: Offset at which the search begins.
+ * @flags: STR_WHOLE_WORD to skip matches inside longer words, STR_ICASE to
+ *         ignore ASCII case, or 0.
+ *
+ * Same as str_find(). In whole word mode the word boundaries are tested
+ * with a vector character class mask inside the candidate filter, so no
+ * second pass over the matches is needed; the bytes before @start still
+ * count as context. Case folding also happens inside the search kernel,
+ * on the bytes it already loaded, without a lowered copy of the string.
+ *
+ * Return: Offset of the match, or STR_NPOS if there is none or on error.
+ */
+size_t str_find_ex(struct Str *self, const char *needle, size_t len,
+		   size_t start, unsigned int flags);
+
+
+/*
+ * str_rfind - Find the last occurrence of a byte string.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @needle: Bytes to look for, need not be NUL terminated.
+ * @len: Number of bytes in @needle.
+ * @pos: Last offset at which a match may start, STR_NPOS for no limit.
+ *
+ * The search runs backwards from @pos (or the cached end) with the same
+ * kind of two byte vector filter as str_find(), so a match near the end
+ * is found without touching the rest of the string. Worst case inputs
+ * fall back to Two-Way on the mirrored string and stay linear.
+ *
+ * Return: Offset of the match, or STR_NPOS if there is none or on error.
+ */
+size_t str_rfind(struct Str *self, const char *needle, size_t len, size_t pos);
+
+
+/*
+ * str_count_char - Count the occurrences of a byte.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @c: The byte to count.
+ *
+ * Blocks of the string are compared against @c with vector compares and
+ * the hits are summed per lane, so the cost is one pass at memory speed.
+ *
+ * Return: Number of bytes equal to @c, 0 on error.
+ */
+size_t str_count_char(struct Str *self, char c);
+
+
+/*
+ * str_count - Count the occurrences of a word.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @needle: NUL terminated word to count.
+ *
+ * Occurrences are counted left to right without overlapping, the way
+ * str_replace_all() would replace them.
+ *
+ * Return: Number of occurrences, 0 for an empty needle or on error.
+ */
+size_t str_count(struct Str *self, const char *needle);
+
+
+/*
+ * str_find_all - Find the offsets of every occurrence of a word.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @needle: NUL terminated word to search for.
+ * @out_offsets: Array receiving the offsets, may be NULL if @max is 0.
+ * @max: Capacity of @out_offsets.
+ *
+ * The string is scanned once; the first @max offsets, in increasing order
+ * and without overlapping, are stored and the rest are only counted. Call
+ * it with @max 0 to size the array first.
+ *
+ * Return: Total number of occurrences, which may exceed @max, 0 on error.
+ */
+size_t str_find_all(struct Str *self, const char *needle, size_t *out_offsets,
+		    size_t max);
+
+
+/*
+ * str_simd_get_level - Get the instruction set used by the SIMD kernels.
+ *
+ * Return: The active level, by default the best one this CPU supports.
+ */
+enum str_simd_level str_simd_get_level(void);
+
+
+/*
+ * str_simd_set_level - Select the instruction set used by the SIMD kernels.
+ *
+ * @level: Level to switch to, must be supported by this CPU.
+ *
+ * Meant for benchmarks and tests that compare the kernels with each other.
+ * It is not synchronized with running string operations, so call it only
+ * while no other thread uses the library.
+ *
+ * Return: 0 on success, or -ENOTSUP if the CPU lacks @level.
+ */
+int str_simd_set_level(enum str_simd_level level);
+
+
+/*
+ * str_pattern_compile - Compile a search needle for repeated use.
+ *
+ * @needle: NUL terminated word to search for.
+ * @flags: STR_WHOLE_WORD to only match whole words, STR_ICASE to ignore
+ *         ASCII case, or 0.
+ *
+ * The needle is copied and its Horspool skip table, SIMD filter bytes and
+ * Two-Way factorization are computed once. The compiled pattern is never
+ * modified afterwards, so one pattern can be used by any number of threads
+ * and Str structures at the same time. Free it with str_pattern_free().
+ *
+ * Return: Pointer to the compiled pattern, or NULL with errno set on
+ * failure.
+ */
+struct Str_pattern *str_pattern_compile(const char *needle, unsigned int flags);
+
+
+/*
+ * str_pattern_free - Free a pattern returned by str_pattern_compile().
+ *
+ * @pat: Pattern to free, may be NULL.
+ */
+void str_pattern_free(struct Str_pattern *pat);
+
+
+/*
+ * str_find_pattern - Find the first match of a compiled pattern.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @pat: Compiled pattern.
+ * @start: Offset at which the search begins.
+ *
+ * Same as str_find(), without the per call needle preprocessing.
+ *
+ * Return: Offset of the match, or STR_NPOS if there is none or on error.
+ */
+size_t str_find_pattern(struct Str *self, const struct Str_pattern *pat,
+			size_t start);
+
+
+/*
+ * str_count_pattern - Count the matches of a compiled pattern.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @pat: Compiled pattern.
+ *
+ * Matches are counted left to right without overlapping.
+ *
+ * Return: Number of matches, 0 for an empty pattern or on error.
+ */
+size_t str_count_pattern(struct Str *self, const struct Str_pattern *pat);
+
+
+/*
+ * str_rem_pattern - Remove every match of a compiled pattern.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @pat: Compiled pattern, must not be empty.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, or 0.
+ *
+ * Same as str_rem_all() with a compiled pattern.
+ *
+ * Return: Number of occurrences removed (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_rem_pattern(struct Str *self, const struct Str_pattern *pat,
+		    unsigned int flags);
+
+
+/*
+ * str_replace_pattern - Replace every match of a compiled pattern.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @pat: Compiled pattern, must not be empty.
+ * @to: The word to replace each match with, may be empty.
+ *
+ * Same as str_replace_all() with a compiled pattern.
+ *
+ * Return: Number of replacements made (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_replace_pattern(struct Str *self, const struct Str_pattern *pat,
+			const char *to);
+
+
+/*
+ * str_dict_compile - Compile a dictionary of words and their replacements.
+ *
+ * @words: Array of @n non-empty, NUL terminated words.
+ * @replacements: Array of @n replacements; NULL (or a NULL entry) removes
+ *                the word.
+ * @n: Number of words.
+ *
+ * The words are compiled into an Aho-Corasick automaton, stored as a
+ * complete DFA over byte classes. If the words end in at most eight
+ * distinct bytes, the scan additionally skips through text that cannot
+ * start a match with a SIMD byte-set search. Both arrays are copied. When
+ * a word is listed twice the first entry wins. The compiled dictionary is
+ * never modified afterwards and can be shared between threads.
+ *
+ * Return: Pointer to the dictionary, or NULL with errno set on failure.
+ */
+struct Str_dict *str_dict_compile(const char *const *words,
+				  const char *const *replacements, size_t n);
+
+
+/*
+ * str_dict_free - Free a dictionary returned by str_dict_compile().
+ *
+ * @dict: Dictionary to free, may be NULL.
+ */
+void str_dict_free(struct Str_dict *dict);
+
+
+/*
+ * str_dict_replace - Replace every dictionary word in the string.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @dict: Compiled dictionary.
+ *
+ * All words are searched in one scan over the data. Where matches overlap
+ * the leftmost one wins, and among those starting at the same position
+ * the longest. The result is sized exactly and written in a single pass.
+ * Mutex locking ensures thread safety.
+ *
+ * Return: Number of replacements made (saturating at INT_MAX), or a
+ * negative error code on failure.
+ */
+int str_dict_replace(struct Str *self, const struct Str_dict *dict);
+
+
+/*
+ * str_apply_edits - Apply a list of offset based edits at once.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @edits: Edits sorted by offset, not overlapping. All offsets refer to the
+ *         string as it was before the call; @ins must not point into it.
+ * @n: Number of edits.
+ *
+ * The final size is computed first and the result is built in a single
+ * sequential pass. When no prefix of the list makes the string longer the
+ * edits are applied in place without allocating; otherwise one buffer of
+ * the exact final size is allocated. An invalid list changes nothing.
+ *
+ * Return: 0 on success, -EINVAL for an unsorted, overlapping or out of
+ * range list, or another negative error code on failure.
+ */
+int str_apply_edits(struct Str *self, const struct Str_edit *edits, size_t n);
+
+
+/*
+ * str_glob_compile - Compile a glob pattern for str_glob_match().
+ *
+ * @pattern: NUL terminated pattern. '*' matches any run of bytes (also
+ *           '/'), '?' any single byte, "[a-z_]" / "[!0-9]" a byte from a
+ *           set or not from it, and '\' makes the next byte literal.
+ * @flags: STR_ICASE to ignore ASCII case, or 0.
+ *
+ * The pattern is turned into a table driven DFA over byte classes, so a
+ * match reads every byte at most once and never backtracks. Patterns
+ * whose DFA would be too large (e.g. "*a" followed by many '?') run as a
+ * bit-parallel NFA instead, which is still linear. The result is read
+ * only and can be shared between threads and Str instances.
+ *
+ * Return: The compiled glob, or NULL with errno set to EINVAL (bad
+ * pattern or flags) or ENOMEM.
+ */
+struct Str_glob *str_glob_compile(const char *pattern, unsigned int flags);
+
+
+/*
+ * str_glob_free - Free a glob returned by str_glob_compile().
+ *
+ * @glob: Glob to free, may be NULL.
+ */
+void str_glob_free(struct Str_glob *glob);
+
+
+/*
+ * str_glob_match - Check whether the whole string matches a glob.
+ *
+ * @self: Pointer to the Str structure to test.
+ * @glob: Compiled glob.
+ *
+ * Return: true if the string matches, false if not or on error.
+ */
+bool str_glob_match(struct Str *self, const struct Str_glob *glob);
+
+
+/*
+ * str_regex_compile - Compile a regular expression.
+ *
+ * @pattern: NUL terminated pattern. Supported are literals, '.' (any byte
+ *           but '\n'), classes "[a-z_]" / "[^0-9]", the escapes \d \w \s
+ *           \D \W \S \n \t \r, groups "(...)" / "(?:...)", alternation
+ *           '|', the repetitions '*', '+', '?', "{n}", "{n,}", "{n,m}", and
+ *           the anchors '^' and '$' (start and end of the whole string).
+ * @flags: STR_ICASE to ignore ASCII case, or 0.
+ *
+ * The pattern becomes a Thompson NFA that is run as a DFA built lazily,
+ * one state per new set of NFA states, so every search is linear in the
+ * bytes it reads and never backtracks. Matches are leftmost-longest, as
+ * in POSIX. When every match contains a literal of two or more bytes,
+ * the SIMD search kernel looks for it first. The result can be shared
+ * between threads and Str instances; its DFA cache has a lock of its own.
+ *
+ * Return: The compiled regex, or NULL with errno set to EINVAL (bad
+ * pattern or flags), E2BIG (pattern too large once counts are expanded)
+ * or ENOMEM.
+ */
+struct Str_regex *str_regex_compile(const char *pattern, unsigned int flags);
+
+
+/*
+ * str_regex_free - Free a regex returned by str_regex_compile().
+ *
+ * @regex: Regex to free, may be NULL.
+ */
+void str_regex_free(struct Str_regex *regex);
+
+
+/*
+ * str_match - Check whether the whole string matches a regex.
+ *
+ * @self: Pointer to the Str structure to test.
+ * @regex: Compiled regex.
+ *
+ * Return: true if the string matches, false if not or on error.
+ */
+bool str_match(struct Str *self, const struct Str_regex *regex);
+
+
+/*
+ * str_search - Find the leftmost-longest match of a regex.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @regex: Compiled regex.
+ * @start: Offset to start searching from; '^' only matches at offset 0.
+ * @match_len: If not NULL, receives the length of the match.
+ *
+ * A search is linear in the bytes it reads, but to be sure a match is the
+ * longest it reads on until every match that could start by its end has
+ * failed, which may be the end of the string. Finding all n matches of a
+ * string of m bytes one search at a time therefore costs O(m * n) in the
+ * worst case: "a|a*b" on a run of 'a' reads the rest of the run for each
+ * single 'a' it matches.
+ *
+ * Return: Offset of the match, or STR_NPOS if there is none or on error.
+ */
+size_t str_search(struct Str *self, const struct Str_regex *regex, size_t start,
+		  size_t *match_len);
+
+
+/*
+ * str_replace_regex - Replace every match of a regex.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @regex: Compiled regex.
+ * @to: Replacement, inserted literally.
+ *
+ * Matches are taken left to right without overlapping. An empty match is
+ * replaced too, after which the search moves on by one byte, so "x*" on
+ * "ab" gives "-a-b-" with @to "-". The result is built in one allocation.
+ * Every match takes a search of its own, so the worst case is O(m * n)
+ * for n matches in m bytes, as described for str_search().
+ *
+ * Return: Number of replacements (saturating at INT_MAX), -EINVAL if
+ * @regex or @to is NULL, -ENOMEM or -E2BIG, or -1 if the Str structure or
+ * its data is NULL.
+ */
+int str_replace_regex(struct Str *self, const struct Str_regex *regex, const char *to);
+
+
+/*
+ * str_edit_distance - Levenshtein distance between two strings.
+ *
+ * @a: First string.
+ * @b: Second string.
+ * @max: Largest distance of interest, or STR_NPOS for no limit.
+ *
+ * Counts single byte insertions, deletions and substitutions. A common
+ * prefix and suffix are skipped first; the rest runs Myers' bit-parallel
+ * algorithm, 64 rows of the DP matrix per machine word, and stops as soon
+ * as the result is known to exceed @max. Both strings are locked.
+ *
+ * Return: The distance, or STR_NPOS if it is larger than @max or on error.
+ */
+size_t str_edit_distance(struct Str *a, struct Str *b, size_t max);
+
+
+/*
+ * str_fuzzy_topk - Find the candidates closest to a query.
+ *
+ * @query: String to look up.
+ * @candidates: Array of @n strings; NULL entries are skipped.
+ * @n: Number of candidates.
+ * @k: Number of results wanted.
+ * @out: Receives up to @k hits, closest first, ties by lower index.
+ *
+ * Large arrays are split between up to one thread per CPU. Every
+ * distance is cut off at the best k-th distance any thread has seen so
+ * far, so most far away candidates cost only a few columns. Each
+ * candidate is locked while it is compared.
+ *
+ * Return: Number of hits stored in @out, 0 on error.
+ */
+size_t str_fuzzy_topk(struct Str *query, struct Str *const *candidates, size_t n,
+		      size_t k, struct Str_fuzzy_hit *out);
+
+
 /*
  * str_to_title_case - Convert the string to title case.
  *
@@ -303,22 +1054,488 @@ int str_swap_word(struct Str *self, const char *word1, const char *word2);
  *
  * This function converts the string data to title case, where the first
  * letter of each word is capitalized and the remaining letters are in
- * lowercase. Mutex locking ensures thread safety. Returns 0 on success,
- * or -1 if the Str structure or its data is NULL or empty.
+ * lowercase. Words are separated by ASCII whitespace and punctuation
+ * other than '_' and the apostrophe, so "it's well-known" becomes
+ * "It's Well-Known". Only ASCII letters change; bytes >= 0x80 count as
+ * word bytes. Mutex locking ensures thread safety.
  *
  * Return: 0 on success, or -1 if the Str structure or data is NULL or empty.
  */
 int str_to_title_case(struct Str *self);
 
 
+/*
+ * str_to_title_case_set - Title case with caller chosen word boundaries.
+ *
+ * @self: Pointer to the Str structure containing the string to modify.
+ * @boundaries: Bytes that end a word, or NULL for the set str_to_title_case()
+ *              uses.
+ *
+ * Upper-cases every ASCII letter at the start of the string or right
+ * after a byte in @boundaries and lower-cases all others. The whole
+ * @self->size bytes are converted, with AVX2 or AVX-512BW kernels where
+ * the CPU has them.
+ *
+ * Return: 0 on success, or -1 if the Str structure or data is NULL or empty.
+ */
+int str_to_title_case_set(struct Str *self, const struct Str_charset *boundaries);
+
+
+/*
+ * str_charset_init - Build a byte set from a string.
+ *
+ * @set: Set to fill.
+ * @chars: NUL-terminated list of the bytes in the set, or NULL for an
+ *         empty set.
+ */
+void str_charset_init(struct Str_charset *set, const char *chars);
+
+
+/*
+ * str_transform - Apply several byte level ops in one pass.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @ops: Ops to apply, in order; each one sees the output of the one before.
+ * @n: Number of ops.
+ *
+ * Runs of case maps, translations and deletions are composed into a
+ * single lookup table first; title case and squeeze, which depend on the
+ * byte before, split the chain into stages that still run together in
+ * the same walk over the string. The lock is taken once. Chains that
+ * reduce to a plain case mapping or title case use the SIMD kernels of
+ * str_to_upper() and str_to_title_case().
+ *
+ * Return: 0 on success, -EINVAL if an op is unknown or lacks its set or
+ * table, -ENOMEM, or -1 if the Str structure or its data is NULL.
+ */
+int str_transform(struct Str *self, const struct Str_op *ops, size_t n);
+
+
+/*
+ * str_translate - Replace every byte by its entry in a table.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @table: New value for each of the 256 byte values.
+ *
+ * Works like tr(1) on the whole @self->size bytes, under the lock. The
+ * table is prepared on every call; use str_table_compile() and
+ * str_translate_table() to map many strings with the same table. A table
+ * that maps a byte to 0 puts an embedded NUL into the string.
+ *
+ * Return: 0 on success, -EINVAL if @table is NULL, or -1 if the Str
+ * structure or its data is NULL.
+ */
+int str_translate(struct Str *self, const uint8_t table[256]);
+
+
+/*
+ * str_table_compile - Prepare a translation table for reuse.
+ *
+ * @table: New value for each of the 256 byte values; it is copied.
+ *
+ * The SIMD kernels look up 16 bytes at a time per block of 16 byte
+ * values the table changes, so maps that touch few blocks (separators,
+ * digits, a few letters) are cheapest.
+ *
+ * Return: The compiled table, to be freed with str_table_free(), or NULL
+ * with errno set (EINVAL, ENOMEM).
+ */
+struct Str_table *str_table_compile(const uint8_t table[256]);
+
+
+/*
+ * str_table_free - Free a table returned by str_table_compile().
+ *
+ * @table: Table to free, or NULL.
+ */
+void str_table_free(struct Str_table *table);
+
+
+/*
+ * str_translate_table - Replace every byte using a compiled table.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @table: Table from str_table_compile().
+ *
+ * Return: 0 on success, -EINVAL if @table is NULL, or -1 if the Str
+ * structure or its data is NULL.
+ */
+int str_translate_table(struct Str *self, const struct Str_table *table);
+
+
+/*
+ * str_trim - Remove whitespace from both ends of the string.
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Whitespace is ' ' and '\t', '\n', '\v', '\f', '\r'. The ends are found
+ * with SIMD compares, the rest of the string is moved down in place, and
+ * the capacity is kept for later appends.
+ *
+ * Return: 0 on success, or -1 if the Str structure or its data is NULL.
+ */
+int str_trim(struct Str *self);
+
+
+/*
+ * str_trim_left - Remove leading whitespace, as str_trim().
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Return: 0 on success, or -1 if the Str structure or its data is NULL.
+ */
+int str_trim_left(struct Str *self);
+
+
+/*
+ * str_trim_right - Remove trailing whitespace, as str_trim().
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Return: 0 on success, or -1 if the Str structure or its data is NULL.
+ */
+int str_trim_right(struct Str *self);
+
+
+/*
+ * str_squeeze_ws - Collapse every run of whitespace into one space.
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Each run of the whitespace bytes of str_trim(), including a lone tab or
+ * newline, becomes a single ' '. The ends are not trimmed; call
+ * str_trim() as well for that. Works in place and keeps the capacity.
+ *
+ * Return: 0 on success, or -1 if the Str structure or its data is NULL.
+ */
+int str_squeeze_ws(struct Str *self);
+
+
+/*
+ * str_span - Length of the longest prefix made only of bytes in a set.
+ *
+ * @self: Pointer to the Str structure to scan.
+ * @set: Allowed bytes, see str_charset_init().
+ *
+ * The set is looked up as a 256-bit bitmap, 32 or 64 bytes per step with
+ * the AVX2 and AVX-512BW kernels. The whole @self->size bytes are
+ * scanned, a NUL stops the span only if it is not in @set.
+ *
+ * Return: Length of the prefix, which is the string size if every byte is
+ * in @set; 0 if the Str structure, its data or @set is NULL.
+ */
+size_t str_span(struct Str *self, const struct Str_charset *set);
+
+
+/*
+ * str_cspan - Length of the longest prefix without any byte of a set.
+ *
+ * @self: Pointer to the Str structure to scan.
+ * @set: Bytes to stop at.
+ *
+ * The complement of str_span(): the offset of the first byte in @set.
+ *
+ * Return: Length of the prefix, which is the string size if no byte is in
+ * @set; 0 if the Str structure, its data or @set is NULL.
+ */
+size_t str_cspan(struct Str *self, const struct Str_charset *set);
+
+
+/*
+ * str_remove_chars - Remove every byte that is in a set.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @set: Bytes to remove.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, or 0.
+ *
+ * The string is compacted in place in one pass. Vector blocks without a
+ * byte to remove are stored back whole; the others are compacted eight
+ * bytes at a time with a shuffle.
+ *
+ * Return: Number of bytes removed (saturating at INT_MAX), -EINVAL if
+ * @set is NULL, or -1 if the Str structure or its data is NULL.
+ */
+int str_remove_chars(struct Str *self, const struct Str_charset *set, unsigned int flags);
+
+
+/*
+ * str_utf8_validate - Check that the string is well-formed UTF-8.
+ *
+ * @self: Pointer to the Str structure to check.
+ *
+ * Overlong forms, surrogates, code points above U+10FFFF and truncated
+ * sequences are all rejected. The AVX2 and AVX-512 kernels classify
+ * each byte with its predecessor through three 16-entry nibble tables,
+ * so a whole vector is checked without branches; ASCII blocks only look
+ * for a sequence left open by the block before. The result is kept in
+ * self->utf8, so asking again before the next change is free.
+ *
+ * Return: true if the data is valid UTF-8 (an empty string is), false
+ * if it is not or if the Str structure is NULL.
+ */
+bool str_utf8_validate(struct Str *self);
+
+
+/*
+ * str_utf8_repair - Replace invalid UTF-8 with U+FFFD.
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Each maximal subpart of an ill-formed sequence, the longest prefix of
+ * a valid sequence or else a single byte, becomes one U+FFFD, as the
+ * Unicode standard recommends. A string already known to be valid is
+ * left alone without a scan, and afterwards the string always is.
+ *
+ * Return: Number of replacements (saturating at INT_MAX), -ENOMEM or
+ * -E2BIG if the repaired string does not fit, or -1 if the Str structure
+ * is NULL.
+ */
+int str_utf8_repair(struct Str *self);
+
+
+/*
+ * str_utf8_to_upper - Convert UTF-8 text to upper case.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @flags: STR_TURKIC for the tr/az dotted and dotless i, or 0.
+ *
+ * Uses the full Unicode case mappings, so a character may turn into
+ * several (U+00DF becomes "SS") and the string may change length.
+ * Runs of ASCII without the bytes the Turkic rules cover go through the
+ * vectorized ASCII kernels; only the rest is decoded and looked up in the
+ * generated tables. As long as every mapping keeps its length the string
+ * is changed in place, otherwise the rest is rebuilt in a new buffer.
+ * Ill-formed sequences are copied unchanged.
+ *
+ * Return: 0 on success, -EINVAL for unknown flags, -ENOMEM or -E2BIG if
+ * the result does not fit, or -1 if the Str structure or its data is NULL.
+ */
+int str_utf8_to_upper(struct Str *self, unsigned int flags);
+
+
+/*
+ * str_utf8_to_lower - Convert UTF-8 text to lower case.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @flags: STR_TURKIC for the tr/az dotted and dotless i, or 0.
+ *
+ * The counterpart of str_utf8_to_upper(). With STR_TURKIC, an I
+ * directly followed by U+0307 COMBINING DOT ABOVE becomes a plain i.
+ * The final form of sigma is not produced.
+ *
+ * Return: As for str_utf8_to_upper().
+ */
+int str_utf8_to_lower(struct Str *self, unsigned int flags);
+
+
+/*
+ * str_utf8_to_title_case - Convert UTF-8 text to title case.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @flags: STR_TURKIC for the tr/az dotted and dotless i, or 0.
+ *
+ * The first character of every word gets its title case mapping (which
+ * differs from upper case for digraphs like U+01C6), the others their
+ * lower case mapping. Words are delimited as in str_to_title_case();
+ * characters outside ASCII always belong to a word.
+ *
+ * Return: As for str_utf8_to_upper().
+ */
+int str_utf8_to_title_case(struct Str *self, unsigned int flags);
+
+
+/*
+ * str_utf8_length - Count the code points of UTF-8 text.
+ *
+ * @self: Pointer to the Str structure to measure.
+ *
+ * Counts the bytes that are not continuation bytes (10xxxxxx), 32 or 16
+ * at a time with a compare and psadbw sums. For valid UTF-8 that is the
+ * number of code points; see str_utf8_validate().
+ *
+ * Return: Number of code points, or 0 if the Str structure or its data is
+ * NULL.
+ */
+size_t str_utf8_length(struct Str *self);
+
+
+/*
+ * str_utf8_offset - Find the byte offset of a code point.
+ *
+ * @self: Pointer to the Str structure to search.
+ * @index: Position of the code point, counted as in str_utf8_length().
+ *
+ * The first call builds an index with the offset of every 256th code
+ * point, only as far as @index; later calls extend it when they need to
+ * and otherwise skip at most 255 code points from the nearest sample, so
+ * walking a string by position costs O(1) per step. Every change to the
+ * data drops the index.
+ *
+ * Return: Byte offset of the code point, the size of the data if @index
+ * is the number of code points, or STR_NPOS if it is larger or if the Str
+ * structure or its data is NULL.
+ */
+size_t str_utf8_offset(struct Str *self, size_t index);
+
+
+/*
+ * str_utf8_reverse - Reverse UTF-8 text character by character.
+ *
+ * @self: Pointer to the Str structure to modify.
+ *
+ * Unlike str_reverse(), multibyte sequences stay intact, and so do
+ * approximate grapheme clusters: a character keeps the combining and
+ * spacing marks, variation selectors, emoji modifiers and tags that
+ * follow it, a zero width joiner glues the characters on both sides,
+ * regional indicators pair up into flags and CR LF stays in order. The
+ * sequences and clusters are turned around in place first, so that the
+ * SIMD reverse of all bytes after puts them back the right way round.
+ *
+ * Return: 0 on success, or -1 if the Str structure or its data is NULL.
+ */
+int str_utf8_reverse(struct Str *self);
+
+
+/*
+ * str_touch - Tell the Str structure its data was changed directly.
+ *
+ * @self: Pointer to the Str structure.
+ *
+ * Drops the cached str_utf8_validate() result and the str_utf8_offset()
+ * index. The library functions do this themselves.
+ */
+void str_touch(struct Str *self);
+
+
+/*
+ * str_add_hex - Append bytes as hexadecimal digits.
+ *
+ * @self: Pointer to the Str structure to append to.
+ * @src: Bytes to encode; may point into the string's own data.
+ * @len: Number of bytes at @src.
+ * @flags: STR_HEX_UPPER for upper case digits, or 0.
+ *
+ * The 2 * @len digits are written straight into the string's memory,
+ * grown once to the exact size, 32 bytes at a time with a byte shuffle
+ * on AVX2 and 16 with compares on SSE2.
+ *
+ * Return: 0 on success, -EINVAL for unknown @flags, -E2BIG if the result
+ * would be too long, -ENOMEM if memory allocation fails, or -1 if the Str
+ * structure or @src is NULL.
+ */
+int str_add_hex(struct Str *self, const void *src, size_t len, unsigned int flags);
+
+
+/*
+ * str_add_base64 - Append bytes as base64 digits.
+ *
+ * @self: Pointer to the Str structure to append to.
+ * @src: Bytes to encode; may point into the string's own data.
+ * @len: Number of bytes at @src.
+ *
+ * Encodes with the standard alphabet of RFC 4648, padding the last group
+ * with '=', into exactly 4 * ceil(@len / 3) bytes of the string's own
+ * memory. With AVX2, 24 bytes become 32 digits per round (SSE2 has no
+ * byte shuffle and uses the scalar loop).
+ *
+ * Return: 0 on success, -E2BIG if the result would be too long, -ENOMEM
+ * if memory allocation fails, or -1 if the Str structure or @src is NULL.
+ */
+int str_add_base64(struct Str *self, const void *src, size_t len);
+
+
+/*
+ * str_decode_hex - Replace hexadecimal digits with the bytes they encode.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, or 0.
+ *
+ * Digits of either case are accepted; there must be an even number of
+ * them and nothing else, not even whitespace. The string is checked with
+ * the span kernel first and then decoded in place, so it is left as it
+ * was when it does not decode. The result may contain NUL bytes; use
+ * str_get_size() for its length.
+ *
+ * Return: 0 on success, -EINVAL if the string is not hex or for unknown
+ * @flags, or -1 if the Str structure or its data is NULL.
+ */
+int str_decode_hex(struct Str *self, unsigned int flags);
+
+
+/*
+ * str_decode_base64 - Replace base64 digits with the bytes they encode.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, or 0.
+ *
+ * Takes the standard alphabet of RFC 4648 in groups of four, the last one
+ * padded with '=' as needed; whitespace and the URL safe alphabet are
+ * not accepted. Bits left over in the last digit are ignored. As in
+ * str_decode_hex(), the string is checked before it is decoded in place.
+ *
+ * Return: As for str_decode_hex().
+ */
+int str_decode_base64(struct Str *self, unsigned int flags);
+
+
+/*
+ * str_add_escaped - Append text escaped for an output format.
+ *
+ * @self: Pointer to the Str structure to append to.
+ * @src: Text to escape; may point into the string's own data.
+ * @len: Number of bytes at @src.
+ * @mode: One of enum str_escape.
+ *
+ * Works from a per-format table of the bytes that stay as they are and
+ * the escapes of all others. A SIMD set lookup marks the bytes to escape
+ * 64 at a time; a first pass adds up the size of their escapes, so the
+ * string grows exactly once, and the second copies the runs between
+ * them whole and writes the escapes from the table. Bytes outside ASCII
+ * are copied as they are, except for STR_ESC_URL, which percent-encodes
+ * them.
+ *
+ * Return: 0 on success, -EINVAL for an unknown @mode, -E2BIG if the result
+ * would be too long, -ENOMEM if memory allocation fails, or -1 if the Str
+ * structure or @src is NULL.
+ */
+int str_add_escaped(struct Str *self, const char *src, size_t len, enum str_escape mode);
+
+
+/*
+ * str_unescape - Undo the escaping of an output format, in place.
+ *
+ * @self: Pointer to the Str structure to modify.
+ * @mode: One of enum str_escape.
+ * @flags: STR_KEEP_CAPACITY to skip the final shrink, or 0.
+ *
+ * Takes more than str_add_escaped() writes: JSON's \/ and \uXXXX for any
+ * code point, surrogate pairs included; any HTML character reference
+ * ("&#233;", "&#xe9;") and the named ones &amp; &lt; &gt; &quot; &apos;
+ * and &nbsp;; percent-escapes in either case. A CSV field is only changed
+ * if it starts with '"'. The escapes are found with the same SIMD set
+ * lookup, checked in a first pass and decoded in a second, so a malformed
+ * string is left as it was. In HTML, an '&' that starts no known reference is
+ * kept as text, and references to U+0000, surrogates or code points
+ * past U+10FFFF give U+FFFD.
+ *
+ * Return: 0 on success; -EINVAL for an unknown @mode or @flags, for a bad
+ * JSON escape or unpaired surrogate, a '%' without two hex digits, or a
+ * quoted CSV field that is not closed or holds a single '"'; -1 if the Str
+ * structure or its data is NULL.
+ */
+int str_unescape(struct Str *self, enum str_escape mode, unsigned int flags);
+
+
 /*
  * str_reverse - Reverse the string in the Str structure.
  *
  * @self: Pointer to the Str structure containing the string to reverse.
  *
- * This function reverses the entire string data stored in the Str structure.
- * Ensures thread safety by locking the mutex. Returns 0 on success, or -1
- * if the Str structure or its data is NULL, or if the string is empty.
+ * This function reverses the entire string data stored in the Str structure,
+ * byte by byte, swapping whole SIMD blocks from both ends at once. UTF-8
+ * sequences are not kept together. Ensures thread safety by locking the
+ * mutex. Returns 0 on success, or -1 if the Str structure or its data is
+ * NULL, or if the string is empty.
  *
  * Return: 0 on success, or -1 if the Str structure or data is NULL or empty.
  */
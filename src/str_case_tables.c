@@ -0,0 +1,861 @@
+/*
+ * Unicode 14.0.0 case mapping tables, generated by tools/gen_case_tables.py.
+ * Do not edit.
+ */
+#include "str_simd.h"
+
+
+const uint32_t str_case_limit = 0x1e980;
+
+
+const uint8_t str_case_stage1[979] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 13, 12, 12, 12, 12, 12, 14, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 15, 16, 17, 18, 19, 20, 21,
+	12, 12, 22, 23, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 25, 26, 27, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 28, 29, 30, 31,
+	12, 12, 12, 12, 12, 12, 32, 33, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 34, 12, 12, 12, 12, 12, 12, 12, 35, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 36, 37, 38, 39, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 40, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 41, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 42, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 43,
+};
+
+
+const uint8_t str_case_stage2[44][128] = {
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+		0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 4,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 5,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		8, 9, 6, 7, 6, 7, 6, 7, 0, 6, 7, 6, 7, 6, 7, 6,
+		7, 6, 7, 6, 7, 6, 7, 6, 7, 4, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 10, 6, 7, 6, 7, 6, 7, 11,
+	},
+	{
+		12, 13, 6, 7, 6, 7, 14, 6, 7, 15, 15, 6, 7, 0, 16, 17,
+		18, 6, 7, 15, 19, 20, 21, 22, 6, 7, 23, 0, 21, 24, 25, 26,
+		6, 7, 6, 7, 6, 7, 27, 6, 7, 27, 0, 0, 6, 7, 27, 6,
+		7, 28, 28, 6, 7, 6, 7, 29, 6, 7, 0, 0, 6, 7, 0, 30,
+		0, 0, 0, 0, 31, 32, 33, 31, 32, 33, 31, 32, 33, 6, 7, 6,
+		7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 34, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		4, 31, 32, 33, 6, 7, 35, 36, 6, 7, 6, 7, 6, 7, 6, 7,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		37, 0, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 0, 0, 0, 0, 0, 0, 38, 6, 7, 39, 40, 41,
+		41, 6, 7, 42, 43, 44, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		45, 46, 47, 48, 49, 0, 50, 50, 0, 51, 0, 52, 53, 0, 0, 0,
+		50, 54, 0, 55, 0, 56, 57, 0, 58, 59, 57, 60, 61, 0, 0, 59,
+		0, 62, 63, 0, 0, 64, 0, 0, 0, 0, 0, 0, 0, 65, 0, 0,
+	},
+	{
+		66, 0, 67, 66, 0, 0, 0, 68, 66, 69, 70, 70, 71, 0, 0, 0,
+		0, 0, 72, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 73, 74, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 75, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		6, 7, 6, 7, 0, 0, 6, 7, 0, 0, 0, 25, 25, 25, 0, 76,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 77, 0, 78, 78, 78, 0, 79, 0, 80, 80,
+		4, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 81, 82, 82, 82,
+		4, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 83, 2, 2, 2, 2, 2, 2, 2, 2, 2, 84, 85, 85, 86,
+		87, 88, 0, 0, 0, 89, 90, 91, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		92, 93, 94, 95, 96, 97, 0, 6, 7, 98, 6, 7, 0, 37, 37, 37,
+	},
+	{
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+	},
+	{
+		6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		100, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 101,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		0, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+		102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+		102, 102, 102, 102, 102, 102, 102, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+		103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+	},
+	{
+		103, 103, 103, 103, 103, 103, 103, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+		104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104, 104,
+		104, 104, 104, 104, 104, 104, 0, 104, 0, 0, 0, 0, 0, 104, 0, 0,
+		105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105,
+		105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105,
+		105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 0, 0, 105, 105, 105,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+		106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+		106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+		106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+		106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+		86, 86, 86, 86, 86, 86, 0, 0, 91, 91, 91, 91, 91, 91, 0, 0,
+	},
+	{
+		107, 108, 109, 110, 110, 111, 112, 113, 114, 0, 0, 0, 0, 0, 0, 0,
+		115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115,
+		115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115,
+		115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 115, 0, 0, 115, 115, 115,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 116, 0, 0, 0, 117, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 118, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 4, 4, 4, 4, 4, 119, 0, 0, 120, 0,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+	},
+	{
+		121, 121, 121, 121, 121, 121, 121, 121, 122, 122, 122, 122, 122, 122, 122, 122,
+		121, 121, 121, 121, 121, 121, 0, 0, 122, 122, 122, 122, 122, 122, 0, 0,
+		121, 121, 121, 121, 121, 121, 121, 121, 122, 122, 122, 122, 122, 122, 122, 122,
+		121, 121, 121, 121, 121, 121, 121, 121, 122, 122, 122, 122, 122, 122, 122, 122,
+		121, 121, 121, 121, 121, 121, 0, 0, 122, 122, 122, 122, 122, 122, 0, 0,
+		4, 121, 4, 121, 4, 121, 4, 121, 0, 122, 0, 122, 0, 122, 0, 122,
+		121, 121, 121, 121, 121, 121, 121, 121, 122, 122, 122, 122, 122, 122, 122, 122,
+		123, 123, 124, 124, 124, 124, 125, 125, 126, 126, 127, 127, 128, 128, 0, 0,
+	},
+	{
+		129, 129, 129, 129, 129, 129, 129, 129, 130, 130, 130, 130, 130, 130, 130, 130,
+		129, 129, 129, 129, 129, 129, 129, 129, 130, 130, 130, 130, 130, 130, 130, 130,
+		129, 129, 129, 129, 129, 129, 129, 129, 130, 130, 130, 130, 130, 130, 130, 130,
+		121, 121, 4, 131, 4, 0, 4, 4, 122, 122, 132, 132, 133, 0, 134, 0,
+		0, 0, 4, 131, 4, 0, 4, 4, 135, 135, 135, 135, 133, 0, 0, 0,
+		121, 121, 4, 4, 0, 0, 4, 4, 122, 122, 136, 136, 0, 0, 0, 0,
+		121, 121, 4, 4, 4, 94, 4, 4, 122, 122, 137, 137, 98, 0, 0, 0,
+		0, 0, 4, 131, 4, 0, 4, 4, 138, 138, 139, 139, 133, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 140, 0, 0, 0, 141, 142, 0, 0, 0, 0,
+		0, 0, 143, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 144, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145, 145,
+		146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146, 146,
+	},
+	{
+		0, 0, 0, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147,
+		147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147, 147,
+		148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 148,
+		148, 148, 148, 148, 148, 148, 148, 148, 148, 148, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+		102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+		102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102, 102,
+		103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+		103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+		103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103, 103,
+		6, 7, 149, 150, 151, 152, 153, 6, 7, 6, 7, 6, 7, 154, 155, 156,
+		157, 0, 6, 7, 0, 6, 7, 0, 0, 0, 0, 0, 0, 0, 158, 158,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 0, 0, 0, 0, 0, 0, 0, 6, 7, 6, 7, 0,
+		0, 0, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159,
+		159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159, 159,
+		159, 159, 159, 159, 159, 159, 0, 159, 0, 0, 0, 0, 0, 159, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		0, 0, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 7, 6, 7, 160, 6, 7,
+	},
+	{
+		6, 7, 6, 7, 6, 7, 6, 7, 0, 0, 0, 6, 7, 161, 0, 0,
+		6, 7, 6, 7, 162, 0, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 163, 164, 165, 166, 163, 0,
+		167, 168, 169, 170, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7, 6, 7,
+		6, 7, 6, 7, 171, 172, 173, 6, 7, 6, 7, 0, 0, 0, 0, 0,
+		6, 7, 0, 0, 0, 0, 6, 7, 6, 7, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 174, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+	},
+	{
+		175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+		175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+		175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+		175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175, 175,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+		0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+		176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+		176, 176, 176, 176, 176, 176, 176, 176, 177, 177, 177, 177, 177, 177, 177, 177,
+		177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+		177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+		176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176, 176,
+		176, 176, 176, 176, 0, 0, 0, 0, 177, 177, 177, 177, 177, 177, 177, 177,
+		177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177,
+		177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 177, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 0, 178, 178, 178, 178,
+	},
+	{
+		178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 178, 0, 178, 178, 178, 178,
+		178, 178, 178, 0, 178, 178, 0, 179, 179, 179, 179, 179, 179, 179, 179, 179,
+		179, 179, 0, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179, 179,
+		179, 179, 0, 179, 179, 179, 179, 179, 179, 179, 0, 179, 179, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+		79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+		79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+		79, 79, 79, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84,
+		84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84,
+		84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84, 84,
+		84, 84, 84, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	},
+	{
+		180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180,
+		180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180, 180,
+		180, 180, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181,
+		181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181, 181,
+		181, 181, 181, 181, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	},
+};
+
+
+const int32_t str_case_records[182][3] = {
+	{ 0, 0, 0 },
+	{ 0, 32, 0 },
+	{ -32, 0, -32 },
+	{ 743, 0, 743 },
+	{ STR_CASE_SPECIAL, 0, STR_CASE_SPECIAL },
+	{ 121, 0, 121 },
+	{ 0, 1, 0 },
+	{ -1, 0, -1 },
+	{ 0, STR_CASE_SPECIAL, 0 },
+	{ -232, 0, -232 },
+	{ 0, -121, 0 },
+	{ -300, 0, -300 },
+	{ 195, 0, 195 },
+	{ 0, 210, 0 },
+	{ 0, 206, 0 },
+	{ 0, 205, 0 },
+	{ 0, 79, 0 },
+	{ 0, 202, 0 },
+	{ 0, 203, 0 },
+	{ 0, 207, 0 },
+	{ 97, 0, 97 },
+	{ 0, 211, 0 },
+	{ 0, 209, 0 },
+	{ 163, 0, 163 },
+	{ 0, 213, 0 },
+	{ 130, 0, 130 },
+	{ 0, 214, 0 },
+	{ 0, 218, 0 },
+	{ 0, 217, 0 },
+	{ 0, 219, 0 },
+	{ 56, 0, 56 },
+	{ 0, 2, 1 },
+	{ -1, 1, 0 },
+	{ -2, 0, -1 },
+	{ -79, 0, -79 },
+	{ 0, -97, 0 },
+	{ 0, -56, 0 },
+	{ 0, -130, 0 },
+	{ 0, 10795, 0 },
+	{ 0, -163, 0 },
+	{ 0, 10792, 0 },
+	{ 10815, 0, 10815 },
+	{ 0, -195, 0 },
+	{ 0, 69, 0 },
+	{ 0, 71, 0 },
+	{ 10783, 0, 10783 },
+	{ 10780, 0, 10780 },
+	{ 10782, 0, 10782 },
+	{ -210, 0, -210 },
+	{ -206, 0, -206 },
+	{ -205, 0, -205 },
+	{ -202, 0, -202 },
+	{ -203, 0, -203 },
+	{ 42319, 0, 42319 },
+	{ 42315, 0, 42315 },
+	{ -207, 0, -207 },
+	{ 42280, 0, 42280 },
+	{ 42308, 0, 42308 },
+	{ -209, 0, -209 },
+	{ -211, 0, -211 },
+	{ 10743, 0, 10743 },
+	{ 42305, 0, 42305 },
+	{ 10749, 0, 10749 },
+	{ -213, 0, -213 },
+	{ -214, 0, -214 },
+	{ 10727, 0, 10727 },
+	{ -218, 0, -218 },
+	{ 42307, 0, 42307 },
+	{ 42282, 0, 42282 },
+	{ -69, 0, -69 },
+	{ -217, 0, -217 },
+	{ -71, 0, -71 },
+	{ -219, 0, -219 },
+	{ 42261, 0, 42261 },
+	{ 42258, 0, 42258 },
+	{ 84, 0, 84 },
+	{ 0, 116, 0 },
+	{ 0, 38, 0 },
+	{ 0, 37, 0 },
+	{ 0, 64, 0 },
+	{ 0, 63, 0 },
+	{ -38, 0, -38 },
+	{ -37, 0, -37 },
+	{ -31, 0, -31 },
+	{ -64, 0, -64 },
+	{ -63, 0, -63 },
+	{ 0, 8, 0 },
+	{ -62, 0, -62 },
+	{ -57, 0, -57 },
+	{ -47, 0, -47 },
+	{ -54, 0, -54 },
+	{ -8, 0, -8 },
+	{ -86, 0, -86 },
+	{ -80, 0, -80 },
+	{ 7, 0, 7 },
+	{ -116, 0, -116 },
+	{ 0, -60, 0 },
+	{ -96, 0, -96 },
+	{ 0, -7, 0 },
+	{ 0, 80, 0 },
+	{ 0, 15, 0 },
+	{ -15, 0, -15 },
+	{ 0, 48, 0 },
+	{ -48, 0, -48 },
+	{ 0, 7264, 0 },
+	{ 3008, 0, 0 },
+	{ 0, 38864, 0 },
+	{ -6254, 0, -6254 },
+	{ -6253, 0, -6253 },
+	{ -6244, 0, -6244 },
+	{ -6242, 0, -6242 },
+	{ -6243, 0, -6243 },
+	{ -6236, 0, -6236 },
+	{ -6181, 0, -6181 },
+	{ 35266, 0, 35266 },
+	{ 0, -3008, 0 },
+	{ 35332, 0, 35332 },
+	{ 3814, 0, 3814 },
+	{ 35384, 0, 35384 },
+	{ -59, 0, -59 },
+	{ 0, -7615, 0 },
+	{ 8, 0, 8 },
+	{ 0, -8, 0 },
+	{ 74, 0, 74 },
+	{ 86, 0, 86 },
+	{ 100, 0, 100 },
+	{ 128, 0, 128 },
+	{ 112, 0, 112 },
+	{ 126, 0, 126 },
+	{ STR_CASE_SPECIAL, 0, 8 },
+	{ STR_CASE_SPECIAL, -8, 0 },
+	{ STR_CASE_SPECIAL, 0, 9 },
+	{ 0, -74, 0 },
+	{ STR_CASE_SPECIAL, -9, 0 },
+	{ -7205, 0, -7205 },
+	{ 0, -86, 0 },
+	{ 0, -100, 0 },
+	{ 0, -112, 0 },
+	{ 0, -128, 0 },
+	{ 0, -126, 0 },
+	{ 0, -7517, 0 },
+	{ 0, -8383, 0 },
+	{ 0, -8262, 0 },
+	{ 0, 28, 0 },
+	{ -28, 0, -28 },
+	{ 0, 16, 0 },
+	{ -16, 0, -16 },
+	{ 0, 26, 0 },
+	{ -26, 0, -26 },
+	{ 0, -10743, 0 },
+	{ 0, -3814, 0 },
+	{ 0, -10727, 0 },
+	{ -10795, 0, -10795 },
+	{ -10792, 0, -10792 },
+	{ 0, -10780, 0 },
+	{ 0, -10749, 0 },
+	{ 0, -10783, 0 },
+	{ 0, -10782, 0 },
+	{ 0, -10815, 0 },
+	{ -7264, 0, -7264 },
+	{ 0, -35332, 0 },
+	{ 0, -42280, 0 },
+	{ 48, 0, 48 },
+	{ 0, -42308, 0 },
+	{ 0, -42319, 0 },
+	{ 0, -42315, 0 },
+	{ 0, -42305, 0 },
+	{ 0, -42258, 0 },
+	{ 0, -42282, 0 },
+	{ 0, -42261, 0 },
+	{ 0, 928, 0 },
+	{ 0, -48, 0 },
+	{ 0, -42307, 0 },
+	{ 0, -35384, 0 },
+	{ -928, 0, -928 },
+	{ -38864, 0, -38864 },
+	{ 0, 40, 0 },
+	{ -40, 0, -40 },
+	{ 0, 39, 0 },
+	{ -39, 0, -39 },
+	{ 0, 34, 0 },
+	{ -34, 0, -34 },
+};
+
+
+const size_t str_case_nspecial = 151;
+
+const struct str_case_special str_case_special[151] = {
+	{ 0x00df, 0, { 0x0053, 0x0053, 0x0000 } },
+	{ 0x00df, 2, { 0x0053, 0x0073, 0x0000 } },
+	{ 0x0130, 1, { 0x0069, 0x0307, 0x0000 } },
+	{ 0x0149, 0, { 0x02bc, 0x004e, 0x0000 } },
+	{ 0x0149, 2, { 0x02bc, 0x004e, 0x0000 } },
+	{ 0x01f0, 0, { 0x004a, 0x030c, 0x0000 } },
+	{ 0x01f0, 2, { 0x004a, 0x030c, 0x0000 } },
+	{ 0x0390, 0, { 0x0399, 0x0308, 0x0301 } },
+	{ 0x0390, 2, { 0x0399, 0x0308, 0x0301 } },
+	{ 0x03b0, 0, { 0x03a5, 0x0308, 0x0301 } },
+	{ 0x03b0, 2, { 0x03a5, 0x0308, 0x0301 } },
+	{ 0x0587, 0, { 0x0535, 0x0552, 0x0000 } },
+	{ 0x0587, 2, { 0x0535, 0x0582, 0x0000 } },
+	{ 0x1e96, 0, { 0x0048, 0x0331, 0x0000 } },
+	{ 0x1e96, 2, { 0x0048, 0x0331, 0x0000 } },
+	{ 0x1e97, 0, { 0x0054, 0x0308, 0x0000 } },
+	{ 0x1e97, 2, { 0x0054, 0x0308, 0x0000 } },
+	{ 0x1e98, 0, { 0x0057, 0x030a, 0x0000 } },
+	{ 0x1e98, 2, { 0x0057, 0x030a, 0x0000 } },
+	{ 0x1e99, 0, { 0x0059, 0x030a, 0x0000 } },
+	{ 0x1e99, 2, { 0x0059, 0x030a, 0x0000 } },
+	{ 0x1e9a, 0, { 0x0041, 0x02be, 0x0000 } },
+	{ 0x1e9a, 2, { 0x0041, 0x02be, 0x0000 } },
+	{ 0x1f50, 0, { 0x03a5, 0x0313, 0x0000 } },
+	{ 0x1f50, 2, { 0x03a5, 0x0313, 0x0000 } },
+	{ 0x1f52, 0, { 0x03a5, 0x0313, 0x0300 } },
+	{ 0x1f52, 2, { 0x03a5, 0x0313, 0x0300 } },
+	{ 0x1f54, 0, { 0x03a5, 0x0313, 0x0301 } },
+	{ 0x1f54, 2, { 0x03a5, 0x0313, 0x0301 } },
+	{ 0x1f56, 0, { 0x03a5, 0x0313, 0x0342 } },
+	{ 0x1f56, 2, { 0x03a5, 0x0313, 0x0342 } },
+	{ 0x1f80, 0, { 0x1f08, 0x0399, 0x0000 } },
+	{ 0x1f81, 0, { 0x1f09, 0x0399, 0x0000 } },
+	{ 0x1f82, 0, { 0x1f0a, 0x0399, 0x0000 } },
+	{ 0x1f83, 0, { 0x1f0b, 0x0399, 0x0000 } },
+	{ 0x1f84, 0, { 0x1f0c, 0x0399, 0x0000 } },
+	{ 0x1f85, 0, { 0x1f0d, 0x0399, 0x0000 } },
+	{ 0x1f86, 0, { 0x1f0e, 0x0399, 0x0000 } },
+	{ 0x1f87, 0, { 0x1f0f, 0x0399, 0x0000 } },
+	{ 0x1f88, 0, { 0x1f08, 0x0399, 0x0000 } },
+	{ 0x1f89, 0, { 0x1f09, 0x0399, 0x0000 } },
+	{ 0x1f8a, 0, { 0x1f0a, 0x0399, 0x0000 } },
+	{ 0x1f8b, 0, { 0x1f0b, 0x0399, 0x0000 } },
+	{ 0x1f8c, 0, { 0x1f0c, 0x0399, 0x0000 } },
+	{ 0x1f8d, 0, { 0x1f0d, 0x0399, 0x0000 } },
+	{ 0x1f8e, 0, { 0x1f0e, 0x0399, 0x0000 } },
+	{ 0x1f8f, 0, { 0x1f0f, 0x0399, 0x0000 } },
+	{ 0x1f90, 0, { 0x1f28, 0x0399, 0x0000 } },
+	{ 0x1f91, 0, { 0x1f29, 0x0399, 0x0000 } },
+	{ 0x1f92, 0, { 0x1f2a, 0x0399, 0x0000 } },
+	{ 0x1f93, 0, { 0x1f2b, 0x0399, 0x0000 } },
+	{ 0x1f94, 0, { 0x1f2c, 0x0399, 0x0000 } },
+	{ 0x1f95, 0, { 0x1f2d, 0x0399, 0x0000 } },
+	{ 0x1f96, 0, { 0x1f2e, 0x0399, 0x0000 } },
+	{ 0x1f97, 0, { 0x1f2f, 0x0399, 0x0000 } },
+	{ 0x1f98, 0, { 0x1f28, 0x0399, 0x0000 } },
+	{ 0x1f99, 0, { 0x1f29, 0x0399, 0x0000 } },
+	{ 0x1f9a, 0, { 0x1f2a, 0x0399, 0x0000 } },
+	{ 0x1f9b, 0, { 0x1f2b, 0x0399, 0x0000 } },
+	{ 0x1f9c, 0, { 0x1f2c, 0x0399, 0x0000 } },
+	{ 0x1f9d, 0, { 0x1f2d, 0x0399, 0x0000 } },
+	{ 0x1f9e, 0, { 0x1f2e, 0x0399, 0x0000 } },
+	{ 0x1f9f, 0, { 0x1f2f, 0x0399, 0x0000 } },
+	{ 0x1fa0, 0, { 0x1f68, 0x0399, 0x0000 } },
+	{ 0x1fa1, 0, { 0x1f69, 0x0399, 0x0000 } },
+	{ 0x1fa2, 0, { 0x1f6a, 0x0399, 0x0000 } },
+	{ 0x1fa3, 0, { 0x1f6b, 0x0399, 0x0000 } },
+	{ 0x1fa4, 0, { 0x1f6c, 0x0399, 0x0000 } },
+	{ 0x1fa5, 0, { 0x1f6d, 0x0399, 0x0000 } },
+	{ 0x1fa6, 0, { 0x1f6e, 0x0399, 0x0000 } },
+	{ 0x1fa7, 0, { 0x1f6f, 0x0399, 0x0000 } },
+	{ 0x1fa8, 0, { 0x1f68, 0x0399, 0x0000 } },
+	{ 0x1fa9, 0, { 0x1f69, 0x0399, 0x0000 } },
+	{ 0x1faa, 0, { 0x1f6a, 0x0399, 0x0000 } },
+	{ 0x1fab, 0, { 0x1f6b, 0x0399, 0x0000 } },
+	{ 0x1fac, 0, { 0x1f6c, 0x0399, 0x0000 } },
+	{ 0x1fad, 0, { 0x1f6d, 0x0399, 0x0000 } },
+	{ 0x1fae, 0, { 0x1f6e, 0x0399, 0x0000 } },
+	{ 0x1faf, 0, { 0x1f6f, 0x0399, 0x0000 } },
+	{ 0x1fb2, 0, { 0x1fba, 0x0399, 0x0000 } },
+	{ 0x1fb2, 2, { 0x1fba, 0x0345, 0x0000 } },
+	{ 0x1fb3, 0, { 0x0391, 0x0399, 0x0000 } },
+	{ 0x1fb4, 0, { 0x0386, 0x0399, 0x0000 } },
+	{ 0x1fb4, 2, { 0x0386, 0x0345, 0x0000 } },
+	{ 0x1fb6, 0, { 0x0391, 0x0342, 0x0000 } },
+	{ 0x1fb6, 2, { 0x0391, 0x0342, 0x0000 } },
+	{ 0x1fb7, 0, { 0x0391, 0x0342, 0x0399 } },
+	{ 0x1fb7, 2, { 0x0391, 0x0342, 0x0345 } },
+	{ 0x1fbc, 0, { 0x0391, 0x0399, 0x0000 } },
+	{ 0x1fc2, 0, { 0x1fca, 0x0399, 0x0000 } },
+	{ 0x1fc2, 2, { 0x1fca, 0x0345, 0x0000 } },
+	{ 0x1fc3, 0, { 0x0397, 0x0399, 0x0000 } },
+	{ 0x1fc4, 0, { 0x0389, 0x0399, 0x0000 } },
+	{ 0x1fc4, 2, { 0x0389, 0x0345, 0x0000 } },
+	{ 0x1fc6, 0, { 0x0397, 0x0342, 0x0000 } },
+	{ 0x1fc6, 2, { 0x0397, 0x0342, 0x0000 } },
+	{ 0x1fc7, 0, { 0x0397, 0x0342, 0x0399 } },
+	{ 0x1fc7, 2, { 0x0397, 0x0342, 0x0345 } },
+	{ 0x1fcc, 0, { 0x0397, 0x0399, 0x0000 } },
+	{ 0x1fd2, 0, { 0x0399, 0x0308, 0x0300 } },
+	{ 0x1fd2, 2, { 0x0399, 0x0308, 0x0300 } },
+	{ 0x1fd3, 0, { 0x0399, 0x0308, 0x0301 } },
+	{ 0x1fd3, 2, { 0x0399, 0x0308, 0x0301 } },
+	{ 0x1fd6, 0, { 0x0399, 0x0342, 0x0000 } },
+	{ 0x1fd6, 2, { 0x0399, 0x0342, 0x0000 } },
+	{ 0x1fd7, 0, { 0x0399, 0x0308, 0x0342 } },
+	{ 0x1fd7, 2, { 0x0399, 0x0308, 0x0342 } },
+	{ 0x1fe2, 0, { 0x03a5, 0x0308, 0x0300 } },
+	{ 0x1fe2, 2, { 0x03a5, 0x0308, 0x0300 } },
+	{ 0x1fe3, 0, { 0x03a5, 0x0308, 0x0301 } },
+	{ 0x1fe3, 2, { 0x03a5, 0x0308, 0x0301 } },
+	{ 0x1fe4, 0, { 0x03a1, 0x0313, 0x0000 } },
+	{ 0x1fe4, 2, { 0x03a1, 0x0313, 0x0000 } },
+	{ 0x1fe6, 0, { 0x03a5, 0x0342, 0x0000 } },
+	{ 0x1fe6, 2, { 0x03a5, 0x0342, 0x0000 } },
+	{ 0x1fe7, 0, { 0x03a5, 0x0308, 0x0342 } },
+	{ 0x1fe7, 2, { 0x03a5, 0x0308, 0x0342 } },
+	{ 0x1ff2, 0, { 0x1ffa, 0x0399, 0x0000 } },
+	{ 0x1ff2, 2, { 0x1ffa, 0x0345, 0x0000 } },
+	{ 0x1ff3, 0, { 0x03a9, 0x0399, 0x0000 } },
+	{ 0x1ff4, 0, { 0x038f, 0x0399, 0x0000 } },
+	{ 0x1ff4, 2, { 0x038f, 0x0345, 0x0000 } },
+	{ 0x1ff6, 0, { 0x03a9, 0x0342, 0x0000 } },
+	{ 0x1ff6, 2, { 0x03a9, 0x0342, 0x0000 } },
+	{ 0x1ff7, 0, { 0x03a9, 0x0342, 0x0399 } },
+	{ 0x1ff7, 2, { 0x03a9, 0x0342, 0x0345 } },
+	{ 0x1ffc, 0, { 0x03a9, 0x0399, 0x0000 } },
+	{ 0xfb00, 0, { 0x0046, 0x0046, 0x0000 } },
+	{ 0xfb00, 2, { 0x0046, 0x0066, 0x0000 } },
+	{ 0xfb01, 0, { 0x0046, 0x0049, 0x0000 } },
+	{ 0xfb01, 2, { 0x0046, 0x0069, 0x0000 } },
+	{ 0xfb02, 0, { 0x0046, 0x004c, 0x0000 } },
+	{ 0xfb02, 2, { 0x0046, 0x006c, 0x0000 } },
+	{ 0xfb03, 0, { 0x0046, 0x0046, 0x0049 } },
+	{ 0xfb03, 2, { 0x0046, 0x0066, 0x0069 } },
+	{ 0xfb04, 0, { 0x0046, 0x0046, 0x004c } },
+	{ 0xfb04, 2, { 0x0046, 0x0066, 0x006c } },
+	{ 0xfb05, 0, { 0x0053, 0x0054, 0x0000 } },
+	{ 0xfb05, 2, { 0x0053, 0x0074, 0x0000 } },
+	{ 0xfb06, 0, { 0x0053, 0x0054, 0x0000 } },
+	{ 0xfb06, 2, { 0x0053, 0x0074, 0x0000 } },
+	{ 0xfb13, 0, { 0x0544, 0x0546, 0x0000 } },
+	{ 0xfb13, 2, { 0x0544, 0x0576, 0x0000 } },
+	{ 0xfb14, 0, { 0x0544, 0x0535, 0x0000 } },
+	{ 0xfb14, 2, { 0x0544, 0x0565, 0x0000 } },
+	{ 0xfb15, 0, { 0x0544, 0x053b, 0x0000 } },
+	{ 0xfb15, 2, { 0x0544, 0x056b, 0x0000 } },
+	{ 0xfb16, 0, { 0x054e, 0x0546, 0x0000 } },
+	{ 0xfb16, 2, { 0x054e, 0x0576, 0x0000 } },
+	{ 0xfb17, 0, { 0x0544, 0x053d, 0x0000 } },
+	{ 0xfb17, 2, { 0x0544, 0x056d, 0x0000 } },
+};
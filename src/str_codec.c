@@ -0,0 +1,622 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+
+/*
+ * Grow @self for @n more bytes of data. *@src is moved along with the
+ * data when it points into it. The caller must hold self->lock.
+ */
+static int append_reserve(struct Str *self, size_t n, const unsigned char **src)
+{
+	size_t old_size = (self->data ? self->size : 0);
+	if (n > MAX_STRING_SIZE - old_size)
+		return -E2BIG;
+
+	uintptr_t data = (uintptr_t)self->data;
+	uintptr_t p = (uintptr_t)*src;
+	bool inside = (self->data && p >= data && p < data + old_size);
+
+	int ret = str_reserve(self, old_size + n);
+	if (ret)
+		return ret;
+
+	if (inside)
+		*src = (const unsigned char *)self->data + (p - data);
+	return 0;
+}
+
+
+/*
+ * Appended digits are ASCII: valid UTF-8 stays valid and invalid stays
+ * invalid, only the index has to go.
+ */
+static void append_done(struct Str *self, size_t size)
+{
+	self->size = size;
+	self->data[size] = '\0';
+	str_index_reset(self);
+}
+
+
+int str_add_hex(struct Str *self, const void *src, size_t len, unsigned int flags)
+{
+	if (!self || !src)
+		return -1;
+	if (flags & ~STR_HEX_UPPER)
+		return -EINVAL;
+	if (len > MAX_STRING_SIZE / 2)
+		return -E2BIG;
+
+	pthread_mutex_lock(&self->lock);
+	const unsigned char *p = (const unsigned char *)src;
+	size_t old_size = (self->data ? self->size : 0);
+	int ret = append_reserve(self, 2 * len, &p);
+	if (!ret) {
+		str_kernels_get()->hex_encode(p, len, (unsigned char *)self->data + old_size,
+					      (flags & STR_HEX_UPPER) ? hex_upper : hex_lower);
+		append_done(self, old_size + 2 * len);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+int str_add_base64(struct Str *self, const void *src, size_t len)
+{
+	if (!self || !src)
+		return -1;
+	if (len / 3 > MAX_STRING_SIZE / 4 - 1)
+		return -E2BIG;
+
+	size_t body = len - len % 3;
+	size_t n = (len + 2) / 3 * 4;
+
+	pthread_mutex_lock(&self->lock);
+	const unsigned char *p = (const unsigned char *)src;
+	size_t old_size = (self->data ? self->size : 0);
+	int ret = append_reserve(self, n, &p);
+	if (!ret) {
+		unsigned char *dst = (unsigned char *)self->data + old_size;
+		str_kernels_get()->base64_encode(p, body, dst);
+
+		// One or two bytes left: two or three digits and the padding
+		if (body < len) {
+			uint32_t v = (uint32_t)p[body] << 16;
+			if (body + 1 < len)
+				v |= (uint32_t)p[body + 1] << 8;
+			dst += body / 3 * 4;
+			dst[0] = (unsigned char)str_base64_digits[v >> 18];
+			dst[1] = (unsigned char)str_base64_digits[(v >> 12) & 63];
+			dst[2] = (body + 1 < len ? (unsigned char)str_base64_digits[(v >> 6) & 63] : '=');
+			dst[3] = '=';
+		}
+		append_done(self, old_size + n);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+// Install the @size decoded bytes. The caller must hold self->lock.
+static void decode_done(struct Str *self, size_t size, unsigned int flags)
+{
+	self->data[size] = '\0';
+	self->size = size;
+	str_data_changed(self);
+	if (!(flags & STR_KEEP_CAPACITY))
+		str_shrink(self);
+}
+
+
+int str_decode_hex(struct Str *self, unsigned int flags)
+{
+	if (!self)
+		return -1;
+	if (flags & ~STR_KEEP_CAPACITY)
+		return -EINVAL;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *s = (unsigned char *)self->data;
+	size_t size = self->size;
+	if (size % 2 || k->span(s, size, &str_hex_set, true) != size) {
+		pthread_mutex_unlock(&self->lock);
+		return -EINVAL;
+	}
+
+	k->hex_decode(s, size / 2);
+	decode_done(self, size / 2, flags);
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+int str_decode_base64(struct Str *self, unsigned int flags)
+{
+	if (!self)
+		return -1;
+	if (flags & ~STR_KEEP_CAPACITY)
+		return -EINVAL;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *s = (unsigned char *)self->data;
+	size_t size = self->size;
+	size_t pad = 0;
+	if (size >= 4 && s[size - 1] == '=')
+		pad = (s[size - 2] == '=' ? 2 : 1);
+
+	// One span covers the full groups and the digits of the last one
+	if (size % 4 || k->span(s, size - pad, &str_base64_set, true) != size - pad) {
+		pthread_mutex_unlock(&self->lock);
+		return -EINVAL;
+	}
+	if (size == 0) {
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	// The last group may be padded, the kernel only takes full ones
+	size_t body = size - 4;
+	uint32_t v = 0;
+	for (size_t i = 0; i < 4 - pad; i++)
+		v |= (uint32_t)str_base64_values[s[body + i]] << (18 - 6 * i);
+
+	k->base64_decode(s, body);
+	unsigned char *dst = s + body / 4 * 3;
+	dst[0] = (unsigned char)(v >> 16);
+	dst[1] = (unsigned char)(v >> 8);
+	dst[2] = (unsigned char)v;
+	decode_done(self, body / 4 * 3 + 3 - pad, flags);
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+/*	ESCAPING	*/
+
+#define ESC_MODES	(STR_ESC_URL + 1)
+
+/*
+ * Bytes in @plain are copied as they are, every other byte b becomes the
+ * @len[b] bytes at @seq[b]. @text is every byte but the one that starts
+ * an escape, for unescaping.
+ */
+struct esc_table {
+	struct str_set_prepared plain;
+	struct str_set_prepared text;
+	unsigned char len[256];
+	char seq[256][8];
+};
+
+static struct esc_table esc_tables[ESC_MODES];
+static pthread_once_t esc_once = PTHREAD_ONCE_INIT;
+
+
+static void esc_set(struct esc_table *t, unsigned char c, const char *seq)
+{
+	t->plain.bits.bits[c >> 6] &= ~(1ull << (c & 63));
+	t->len[c] = (unsigned char)strlen(seq);
+	memcpy(t->seq[c], seq, t->len[c]);
+}
+
+
+static void esc_init(void)
+{
+	char buf[8];
+
+	for (int m = 0; m < ESC_MODES; m++) {
+		struct esc_table *t = &esc_tables[m];
+		memset(t->plain.bits.bits, 0xff, sizeof(t->plain.bits.bits));
+		for (int c = 0; c < 256; c++) {
+			t->len[c] = 1;
+			t->seq[c][0] = (char)c;
+		}
+	}
+
+	struct esc_table *t = &esc_tables[STR_ESC_JSON];
+	for (int c = 0; c < 0x20; c++) {
+		snprintf(buf, sizeof(buf), "\\u%04x", c);
+		esc_set(t, (unsigned char)c, buf);
+	}
+	esc_set(t, '\b', "\\b");
+	esc_set(t, '\f', "\\f");
+	esc_set(t, '\n', "\\n");
+	esc_set(t, '\r', "\\r");
+	esc_set(t, '\t', "\\t");
+	esc_set(t, '"', "\\\"");
+	esc_set(t, '\\', "\\\\");
+
+	// The quotes around the field are added on top
+	t = &esc_tables[STR_ESC_CSV];
+	esc_set(t, '"', "\"\"");
+	esc_set(t, ',', ",");
+	esc_set(t, '\r', "\r");
+	esc_set(t, '\n', "\n");
+
+	t = &esc_tables[STR_ESC_HTML];
+	esc_set(t, '&', "&amp;");
+	esc_set(t, '<', "&lt;");
+	esc_set(t, '>', "&gt;");
+	esc_set(t, '"', "&quot;");
+	esc_set(t, '\'', "&#39;");
+
+	t = &esc_tables[STR_ESC_URL];
+	for (int c = 0; c < 256; c++) {
+		bool unreserved = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+				  (c >= 'a' && c <= 'z') || (c && strchr("-._~", c));
+		if (!unreserved) {
+			snprintf(buf, sizeof(buf), "%%%02X", c);
+			esc_set(t, (unsigned char)c, buf);
+		}
+	}
+
+	static const unsigned char leads[ESC_MODES] = {
+		[STR_ESC_JSON] = '\\', [STR_ESC_CSV] = '"', [STR_ESC_HTML] = '&',
+		[STR_ESC_URL] = '%',
+	};
+	for (int m = 0; m < ESC_MODES; m++) {
+		struct Str_charset set = esc_tables[m].plain.bits;
+		str_set_prepare(&esc_tables[m].plain, &set);
+		memset(set.bits, 0xff, sizeof(set.bits));
+		set.bits[leads[m] >> 6] &= ~(1ull << (leads[m] & 63));
+		str_set_prepare(&esc_tables[m].text, &set);
+	}
+}
+
+
+/*
+ * Size of @src escaped with @t, 64 bytes at a time: the set_mask kernel
+ * marks the bytes that are not plain and only those are looked up.
+ * *@escapes is their number.
+ */
+static size_t esc_size(const struct esc_table *t, const struct str_kernels *k,
+		       const unsigned char *src, size_t len, size_t *escapes)
+{
+	size_t size = len, n = 0;
+
+	for (size_t i = 0; i < len; i += 64) {
+		uint64_t m = k->set_mask(src + i, (len - i < 64 ? len - i : 64), &t->plain);
+		for (; m; m &= m - 1) {
+			size += t->len[src[i + (size_t)__builtin_ctzll(m)]] - 1u;
+			n++;
+		}
+	}
+	*escapes = n;
+	return size;
+}
+
+
+/*
+ * Copy @n bytes, with a single 8 byte move for short runs when both
+ * buffers have room for it; the bytes past @n are written over later.
+ */
+static inline unsigned char *esc_copy(unsigned char *out, const unsigned char *end,
+				      const unsigned char *src, const unsigned char *src_end,
+				      size_t n)
+{
+	if (n <= 8 && end - out >= 8 && src_end - src >= 8)
+		memcpy(out, src, 8);
+	else
+		memcpy(out, src, n);
+	return out + n;
+}
+
+
+/*
+ * Write @src escaped with @t to @out, which ends at @end: the plain runs
+ * between the marked bytes are copied whole, the others replaced by
+ * their seq[] entry.
+ */
+static unsigned char *esc_write(const struct esc_table *t, const struct str_kernels *k,
+				const unsigned char *src, size_t len, unsigned char *out,
+				const unsigned char *end)
+{
+	const unsigned char *src_end = src + len;
+	const unsigned char *seq;
+
+	for (size_t i = 0; i < len; i += 64) {
+		size_t n = (len - i < 64 ? len - i : 64);
+		uint64_t m = k->set_mask(src + i, n, &t->plain);
+		size_t from = i;
+
+		for (; m; m &= m - 1) {
+			size_t j = i + (size_t)__builtin_ctzll(m);
+			out = esc_copy(out, end, src + from, src_end, j - from);
+			seq = (const unsigned char *)t->seq[src[j]];
+			out = esc_copy(out, end, seq, seq + sizeof(t->seq[0]), t->len[src[j]]);
+			from = j + 1;
+		}
+		out = esc_copy(out, end, src + from, src_end, i + n - from);
+	}
+	return out;
+}
+
+
+int str_add_escaped(struct Str *self, const char *src, size_t len, enum str_escape mode)
+{
+	if (!self || !src)
+		return -1;
+	if ((unsigned int)mode >= ESC_MODES)
+		return -EINVAL;
+	// No escape is longer than 6 bytes
+	if (len > MAX_STRING_SIZE / 6)
+		return -E2BIG;
+
+	pthread_once(&esc_once, esc_init);
+	const struct esc_table *t = &esc_tables[mode];
+	const struct str_kernels *k = str_kernels_get();
+
+	pthread_mutex_lock(&self->lock);
+	const unsigned char *p = (const unsigned char *)src;
+	size_t escapes;
+	size_t n = esc_size(t, k, p, len, &escapes);
+	bool quote = (mode == STR_ESC_CSV && escapes);
+	size_t old_size = (self->data ? self->size : 0);
+
+	int ret = append_reserve(self, n + 2 * quote, &p);
+	if (!ret) {
+		unsigned char *out = (unsigned char *)self->data + old_size;
+		unsigned char *end = out + n + 2 * quote;
+		if (quote)
+			*out++ = '"';
+		out = esc_write(t, k, p, len, out, end);
+		if (quote)
+			*out = '"';
+		append_done(self, old_size + n + 2 * quote);
+		str_data_changed(self);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+/*
+ * Unescapers for the sequence at @s, @size bytes long, which starts with
+ * the mode's lead byte. They put up to 4 bytes into @out and their count
+ * into *@n, and return the length of the sequence, or 0 if it is
+ * malformed. None writes more than it reads.
+ */
+typedef size_t (*unesc_fn)(const unsigned char *s, size_t size, unsigned char *out,
+			   size_t *n);
+
+
+static bool hex4(const unsigned char *s, uint32_t *v)
+{
+	*v = 0;
+	for (int i = 0; i < 4; i++) {
+		if (!str_charset_has(&str_hex_set, s[i]))
+			return false;
+		*v = *v << 4 | str_hex_value(s[i]);
+	}
+	return true;
+}
+
+
+static size_t unesc_json(const unsigned char *s, size_t size, unsigned char *out, size_t *n)
+{
+	static const char from[] = "\"\\/bfnrt";
+	static const char to[] = "\"\\/\b\f\n\r\t";
+
+	if (size < 2)
+		return 0;
+	if (s[1] != 'u') {
+		const char *p = (s[1] ? strchr(from, s[1]) : NULL);
+		if (!p)
+			return 0;
+		out[0] = (unsigned char)to[p - from];
+		*n = 1;
+		return 2;
+	}
+
+	uint32_t cp, lo;
+	if (size < 6 || !hex4(s + 2, &cp) || (cp >= 0xdc00 && cp <= 0xdfff))
+		return 0;
+	if (cp < 0xd800 || cp > 0xdbff) {
+		*n = str_utf8_encode(cp, out);
+		return 6;
+	}
+
+	// A high surrogate needs the low half right after it
+	if (size < 12 || s[6] != '\\' || s[7] != 'u' || !hex4(s + 8, &lo) ||
+	    lo < 0xdc00 || lo > 0xdfff)
+		return 0;
+	*n = str_utf8_encode(0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00), out);
+	return 12;
+}
+
+
+static size_t unesc_url(const unsigned char *s, size_t size, unsigned char *out, size_t *n)
+{
+	if (size < 3 || !str_charset_has(&str_hex_set, s[1]) ||
+	    !str_charset_has(&str_hex_set, s[2]))
+		return 0;
+	out[0] = (unsigned char)(str_hex_value(s[1]) << 4 | str_hex_value(s[2]));
+	*n = 1;
+	return 3;
+}
+
+
+/*
+ * Character references are never malformed: an '&' that does not start
+ * one is just an '&'.
+ */
+static size_t unesc_html(const unsigned char *s, size_t size, unsigned char *out, size_t *n)
+{
+	static const struct {
+		const char *name;
+		uint32_t cp;
+	} names[] = {
+		{ "amp;", '&' }, { "lt;", '<' }, { "gt;", '>' }, { "quot;", '"' },
+		{ "apos;", '\'' }, { "nbsp;", 0xa0 },
+	};
+
+	if (size > 2 && s[1] == '#') {
+		bool hex = (s[2] == 'x' || s[2] == 'X');
+		size_t i = 2 + hex, start = i;
+		uint32_t cp = 0;
+
+		for (; i < size; i++) {
+			unsigned int d;
+			if (hex && str_charset_has(&str_hex_set, s[i]))
+				d = str_hex_value(s[i]);
+			else if (!hex && s[i] >= '0' && s[i] <= '9')
+				d = s[i] - '0';
+			else
+				break;
+			// Saturate: anything past U+10FFFF is out of range alike
+			cp = (cp > 0x10ffff ? cp : cp * (hex ? 16 : 10) + d);
+		}
+		if (i > start && i < size && s[i] == ';') {
+			if (cp == 0 || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+				cp = 0xfffd;
+			*n = str_utf8_encode(cp, out);
+			return i + 1;
+		}
+	} else {
+		for (size_t j = 0; j < sizeof(names) / sizeof(names[0]); j++) {
+			size_t len = strlen(names[j].name);
+			if (size > len && !memcmp(s + 1, names[j].name, len)) {
+				*n = str_utf8_encode(names[j].cp, out);
+				return len + 1;
+			}
+		}
+	}
+
+	out[0] = '&';
+	*n = 1;
+	return 1;
+}
+
+
+/*
+ * Run @fn on every sequence that starts with a byte outside @text and
+ * copy the text in between, when @write is set; otherwise only check the
+ * sequences. The set_mask kernel finds the lead bytes 64 at a time.
+ * Returns the new size, or STR_NPOS if a sequence is malformed.
+ */
+static size_t unesc_run(unsigned char *s, size_t size, const struct str_set_prepared *text,
+			unesc_fn fn, bool write, const struct str_kernels *k)
+{
+	size_t r = 0, w = 0;
+	unsigned char out[4];
+
+	for (size_t i = 0; i < size; i += 64) {
+		uint64_t m = k->set_mask(s + i, (size - i < 64 ? size - i : 64), text);
+		for (; m; m &= m - 1) {
+			size_t j = i + (size_t)__builtin_ctzll(m);
+			if (j < r)
+				continue;	/* inside the last sequence */
+			if (write && w != r)
+				memmove(s + w, s + r, j - r);
+			w += j - r;
+
+			size_t n;
+			size_t used = fn(s + j, size - j, out, &n);
+			if (!used)
+				return STR_NPOS;
+			if (write)
+				memcpy(s + w, out, n);
+			w += n;
+			r = j + used;
+		}
+	}
+	if (write && w != r)
+		memmove(s + w, s + r, size - r);
+	return w + (size - r);
+}
+
+
+// A quoted CSV field loses its quotes and one of every pair inside
+static int unesc_csv(unsigned char *s, size_t *size, const struct str_kernels *k)
+{
+	size_t len = *size;
+	if (!len || s[0] != '"')
+		return 0;
+
+	// The pairs are matched on the check pass, as unesc_run() does
+	for (int write = 0; write < 2; write++) {
+		size_t r = 1, w = 0;
+		for (;;) {
+			size_t q = k->find_bytes(s, len, r, (const unsigned char *)"\"", 1);
+			if (q == STR_NPOS)
+				return -EINVAL;
+			if (write)
+				memmove(s + w, s + r, q - r);
+			w += q - r;
+			if (q == len - 1) {
+				if (write)
+					*size = w;
+				break;
+			}
+			if (s[q + 1] != '"')
+				return -EINVAL;
+			if (write)
+				s[w] = '"';
+			w++;
+			r = q + 2;
+		}
+	}
+	return 0;
+}
+
+
+int str_unescape(struct Str *self, enum str_escape mode, unsigned int flags)
+{
+	static const unesc_fn fns[ESC_MODES] = {
+		[STR_ESC_JSON] = unesc_json, [STR_ESC_HTML] = unesc_html,
+		[STR_ESC_URL] = unesc_url,
+	};
+
+	if (!self)
+		return -1;
+	if ((unsigned int)mode >= ESC_MODES || (flags & ~STR_KEEP_CAPACITY))
+		return -EINVAL;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	pthread_once(&esc_once, esc_init);
+	const struct str_set_prepared *text = &esc_tables[mode].text;
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *s = (unsigned char *)self->data;
+	size_t size = self->size;
+	int ret = 0;
+
+	if (mode == STR_ESC_CSV) {
+		ret = unesc_csv(s, &size, k);
+	} else if (unesc_run(s, size, text, fns[mode], false, k) == STR_NPOS) {
+		ret = -EINVAL;
+	} else {
+		size = unesc_run(s, size, text, fns[mode], true, k);
+	}
+
+	if (!ret && size != self->size)
+		decode_done(self, size, flags);
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
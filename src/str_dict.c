@@ -0,0 +1,345 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+
+
+/*
+ * The dictionary is an Aho-Corasick automaton over the *reversed* words,
+ * compiled into a complete DFA on byte classes. Scanning the text from its
+ * end towards its start then yields, at every position, the longest word
+ * that begins there. A forward walk over those positions picks the
+ * leftmost-longest, non-overlapping matches without ever backtracking.
+ */
+struct Str_dict {
+	size_t	nwords;
+	size_t	*word_size;
+	char	**repl;
+	size_t	*repl_size;
+	size_t	nstates;
+	size_t	nclasses;
+	uint8_t	classes[256];	/* byte -> class, 0 for bytes no word uses */
+	uint32_t *delta;	/* nstates * nclasses transitions */
+	int32_t	*out;		/* longest word starting here, or -1 */
+	unsigned char lead[STR_SMALL_SET_MAX];
+	size_t	nlead;		/* 0 if too many lead bytes to prefilter */
+};
+
+
+struct dict_match {
+	size_t	pos;
+	size_t	word;
+};
+
+
+void str_dict_free(struct Str_dict *dict)
+{
+	if (!dict)
+		return;
+
+	if (dict->repl) {
+		for (size_t i = 0; i < dict->nwords; i++)
+			free(dict->repl[i]);
+	}
+	free(dict->repl);
+	free(dict->repl_size);
+	free(dict->word_size);
+	free(dict->delta);
+	free(dict->out);
+	free(dict);
+}
+
+
+/*
+ * Breadth first pass over the trie: set the failure links, complete the
+ * missing transitions from them and propagate the longest output.
+ */
+static int dict_link(struct Str_dict *dict, const int32_t *own)
+{
+	const size_t nc = dict->nclasses;
+	uint32_t *delta = dict->delta;
+	uint32_t *fail = (uint32_t *)calloc(dict->nstates, sizeof(uint32_t));
+	uint32_t *queue = (uint32_t *)malloc(dict->nstates * sizeof(uint32_t));
+	size_t head = 0;
+	size_t tail = 0;
+
+	if (!fail || !queue) {
+		free(fail);
+		free(queue);
+		return -ENOMEM;
+	}
+
+	dict->out[0] = -1;
+	for (size_t c = 0; c < nc; c++) {
+		uint32_t v = delta[c];
+		if (v) {
+			fail[v] = 0;
+			dict->out[v] = own[v];
+			queue[tail++] = v;
+		}
+	}
+
+	while (head < tail) {
+		uint32_t u = queue[head++];
+		for (size_t c = 0; c < nc; c++) {
+			uint32_t v = delta[u * nc + c];
+			if (v) {
+				fail[v] = delta[fail[u] * nc + c];
+				dict->out[v] = (own[v] >= 0 ? own[v] : dict->out[fail[v]]);
+				queue[tail++] = v;
+			} else {
+				delta[u * nc + c] = delta[fail[u] * nc + c];
+			}
+		}
+	}
+
+	free(fail);
+	free(queue);
+	return 0;
+}
+
+
+struct Str_dict *str_dict_compile(const char *const *words,
+				  const char *const *replacements, size_t n)
+{
+	if (!words || !n || n > INT32_MAX) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	size_t total = 0;
+	bool used[256] = { false };
+	for (size_t i = 0; i < n; i++) {
+		if (!words[i] || !*words[i]) {
+			errno = EINVAL;
+			return NULL;
+		}
+		for (const unsigned char *p = (const unsigned char *)words[i]; *p; p++) {
+			used[*p] = true;
+			total++;
+		}
+	}
+
+	struct Str_dict *dict = (struct Str_dict *)calloc(1, sizeof(struct Str_dict));
+	if (!dict)
+		return NULL;
+
+	dict->nwords = n;
+	dict->word_size = (size_t *)malloc(n * sizeof(size_t));
+	dict->repl_size = (size_t *)malloc(n * sizeof(size_t));
+	dict->repl = (char **)calloc(n, sizeof(char *));
+	if (!dict->word_size || !dict->repl_size || !dict->repl)
+		goto fail;
+
+	for (size_t i = 0; i < n; i++) {
+		const char *r = ((replacements && replacements[i]) ? replacements[i] : "");
+		dict->word_size[i] = strlen(words[i]);
+		dict->repl_size[i] = strlen(r);
+		dict->repl[i] = (char *)malloc(dict->repl_size[i] + 1);
+		if (!dict->repl[i])
+			goto fail;
+		memcpy(dict->repl[i], r, dict->repl_size[i] + 1);
+	}
+
+	dict->nclasses = 1;
+	for (size_t c = 0; c < 256; c++)
+		dict->classes[c] = (uint8_t)(used[c] ? dict->nclasses++ : 0);
+
+	// Trie of the reversed words; edge target 0 means "no edge" for now
+	const size_t nc = dict->nclasses;
+	size_t max_states = total + 1;
+	dict->delta = (uint32_t *)calloc(max_states * nc, sizeof(uint32_t));
+	dict->out = (int32_t *)malloc(max_states * sizeof(int32_t));
+	int32_t *own = (int32_t *)malloc(max_states * sizeof(int32_t));
+	if (!dict->delta || !dict->out || !own || max_states > UINT32_MAX) {
+		free(own);
+		goto fail;
+	}
+
+	own[0] = -1;
+	dict->nstates = 1;
+	for (size_t i = 0; i < n; i++) {
+		const unsigned char *w = (const unsigned char *)words[i];
+		uint32_t u = 0;
+		for (size_t k = dict->word_size[i]; k-- > 0;) {
+			uint32_t *edge = &dict->delta[u * nc + dict->classes[w[k]]];
+			if (!*edge) {
+				*edge = (uint32_t)dict->nstates;
+				own[dict->nstates++] = -1;
+			}
+			u = *edge;
+		}
+		if (own[u] < 0)		// the first of duplicate words wins
+			own[u] = (int32_t)i;
+	}
+
+	int ret = dict_link(dict, own);
+	free(own);
+	if (ret)
+		goto fail;
+
+	uint32_t *delta = (uint32_t *)realloc(dict->delta, dict->nstates * nc * sizeof(uint32_t));
+	if (delta)
+		dict->delta = delta;
+
+	// Bytes that leave the root state: the last byte of some word
+	for (size_t c = 0; c < 256; c++) {
+		if (used[c] && dict->delta[dict->classes[c]]) {
+			if (dict->nlead == STR_SMALL_SET_MAX) {
+				dict->nlead = 0;
+				break;
+			}
+			dict->lead[dict->nlead++] = (unsigned char)c;
+		}
+	}
+
+	return dict;
+
+fail:
+	str_dict_free(dict);
+	errno = ENOMEM;
+	return NULL;
+}
+
+
+/*
+ * Scan self->data backwards and record every position where a word starts,
+ * with the longest such word, in decreasing position order.
+ */
+static int dict_scan(const struct Str_dict *dict, const struct Str *self,
+		     struct dict_match **matches, size_t *count)
+{
+	const unsigned char *h = (const unsigned char *)self->data;
+	const struct str_kernels *k = str_kernels_get();
+	const size_t nc = dict->nclasses;
+	struct dict_match *m = NULL;
+	size_t m_cap = 0;
+	size_t m_count = 0;
+	uint32_t state = 0;
+	size_t p = self->size;
+
+	while (p > 0) {
+		// At the root only a lead byte can start a match: skip to it
+		if (state == 0 && dict->nlead) {
+			size_t q = k->rfind_bytes(h, p, dict->lead, dict->nlead);
+			if (q == STR_NPOS)
+				break;
+			p = q + 1;
+		}
+
+		p--;
+		state = dict->delta[state * nc + dict->classes[h[p]]];
+		if (dict->out[state] < 0)
+			continue;
+
+		if (m_count == m_cap) {
+			size_t new_cap = (m_cap ? m_cap * 2 : 64);
+			struct dict_match *tmp = (struct dict_match *)realloc(m, new_cap * sizeof(*m));
+			if (!tmp) {
+				free(m);
+				return -ENOMEM;
+			}
+			m = tmp;
+			m_cap = new_cap;
+		}
+		m[m_count].pos = p;
+		m[m_count].word = (size_t)dict->out[state];
+		m_count++;
+	}
+
+	*matches = m;
+	*count = m_count;
+	return 0;
+}
+
+
+int str_dict_replace(struct Str *self, const struct Str_dict *dict)
+{
+	if (!self) {
+		return -1;
+	} else if (!dict) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	struct dict_match *m;
+	size_t count;
+	int ret = dict_scan(dict, self, &m, &count);
+	if (ret) {
+		pthread_mutex_unlock(&self->lock);
+		return ret;
+	}
+
+	/*
+	 * Greedy pass in increasing position order: a match is taken when it
+	 * starts at or after the end of the previous one. Taken matches are
+	 * packed towards the end of the array, again in decreasing order.
+	 */
+	size_t cursor = 0;
+	size_t grow = 0;
+	size_t shrink = 0;
+	size_t taken = count;
+	for (size_t i = count; i-- > 0;) {
+		if (m[i].pos < cursor)
+			continue;
+
+		size_t w = m[i].word;
+		cursor = m[i].pos + dict->word_size[w];
+		if (dict->repl_size[w] > dict->word_size[w])
+			grow += dict->repl_size[w] - dict->word_size[w];
+		else
+			shrink += dict->word_size[w] - dict->repl_size[w];
+		m[--taken] = m[i];
+	}
+
+	if (taken == count) {
+		free(m);
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	if (grow > MAX_STRING_SIZE - self->size) {
+		free(m);
+		pthread_mutex_unlock(&self->lock);
+		return -E2BIG;
+	}
+
+	size_t new_size = self->size + grow - shrink;
+	char *buf = (char *)malloc(new_size + 1);
+	if (!buf) {
+		free(m);
+		pthread_mutex_unlock(&self->lock);
+		return -ENOMEM;
+	}
+
+	// Single forward write
+	char *wr = buf;
+	size_t rd = 0;
+	for (size_t i = count; i-- > taken;) {
+		size_t w = m[i].word;
+		memcpy(wr, self->data + rd, m[i].pos - rd);
+		wr += m[i].pos - rd;
+		memcpy(wr, dict->repl[w], dict->repl_size[w]);
+		wr += dict->repl_size[w];
+		rd = m[i].pos + dict->word_size[w];
+	}
+	memcpy(wr, self->data + rd, self->size - rd + 1);
+
+	free(m);
+	free(self->data);
+	self->data = buf;
+	self->size = new_size;
+	self->capacity = new_size;
+
+	pthread_mutex_unlock(&self->lock);
+	count -= taken;
+	return (count > INT_MAX ? INT_MAX : (int)count);
+}
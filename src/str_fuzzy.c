@@ -0,0 +1,504 @@
+#define _POSIX_C_SOURCE 200809L
+#include "strutil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+
+#define FUZZY_MAX_THREADS	16
+#define FUZZY_CHUNK		256	/* candidates a worker takes at a time */
+#define FUZZY_MIN_PER_THREAD	2048	/* below this a thread is not worth it */
+
+
+/*
+ * A string prepared as the vertical side of Myers' bit-parallel edit
+ * distance: for every byte value, a bit mask per 64 row block telling
+ * where the byte occurs.
+ */
+struct ed_pattern {
+	size_t	m;
+	size_t	nblocks;
+	uint64_t last;		/* bit of row m - 1 in the last block */
+	uint64_t *peq;		/* peq[c * nblocks + b] */
+	uint64_t *pv;		/* per block work space: vertical +1 deltas */
+	uint64_t *mv;		/* vertical -1 deltas */
+	size_t	*score;		/* value at the last row of each block */
+};
+
+
+static inline unsigned int popcount64(uint64_t x)
+{
+	return (unsigned int)__builtin_popcountll(x);
+}
+
+
+static void ed_pattern_free(struct ed_pattern *p)
+{
+	free(p->peq);
+	free(p->pv);
+	free(p->mv);
+	free(p->score);
+}
+
+
+static bool ed_pattern_init(struct ed_pattern *p, const unsigned char *s, size_t m)
+{
+	memset(p, 0, sizeof(*p));
+	p->m = m;
+	p->nblocks = (m + 63) / 64;
+	if (!m)
+		return true;
+
+	p->last = (uint64_t)1 << ((m - 1) % 64);
+	p->peq = (uint64_t *)calloc(256 * p->nblocks, sizeof(uint64_t));
+	p->pv = (uint64_t *)malloc(p->nblocks * sizeof(uint64_t));
+	p->mv = (uint64_t *)malloc(p->nblocks * sizeof(uint64_t));
+	p->score = (size_t *)malloc(p->nblocks * sizeof(size_t));
+	if (!p->peq || !p->pv || !p->mv || !p->score) {
+		ed_pattern_free(p);
+		return false;
+	}
+
+	for (size_t i = 0; i < m; i++)
+		p->peq[(size_t)s[i] * p->nblocks + i / 64] |= (uint64_t)1 << (i % 64);
+	return true;
+}
+
+
+/*
+ * Distance of a pattern of at most 64 bytes to @t (Hyyrö's formulation of
+ * Myers' algorithm): one column of the DP matrix per step, held as +1/-1
+ * vertical delta masks. @peq is the pattern's single block table.
+ *
+ * Two lower bounds cut the scan short once the result must exceed @max:
+ * the last row can drop by at most one per remaining column, and no
+ * value in a column is below (last row - number of +1 deltas), which
+ * every later path has to pass.
+ */
+static size_t ed_single(const uint64_t *peq, size_t m, uint64_t last,
+			const unsigned char *t, size_t n, size_t max)
+{
+	const uint64_t mask = last | (last - 1);
+	uint64_t pv = ~(uint64_t)0;
+	uint64_t mv = 0;
+	size_t score = m;
+
+	for (size_t j = 0; j < n; j++) {
+		uint64_t eq = peq[t[j]];
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+
+		score += ((ph & last) != 0) - ((mh & last) != 0);
+
+		ph = (ph << 1) | 1;	// row 0 is j + 1: always +1
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+
+		if (score > max + (n - j - 1) ||
+		    (j + 1 > max && score > max + popcount64(pv & mask)))
+			return STR_NPOS;
+	}
+	return (score <= max ? score : STR_NPOS);
+}
+
+
+/*
+ * Advance block @b by one column (Myers' advance_block). @hin is the
+ * horizontal delta entering at the block's top row; returns the one
+ * leaving at its bottom row, @high.
+ */
+static inline int ed_advance(struct ed_pattern *p, size_t b, uint64_t eq,
+			     uint64_t high, int hin)
+{
+	uint64_t pv = p->pv[b];
+	uint64_t mv = p->mv[b];
+	uint64_t xv = eq | mv;
+
+	if (hin < 0)
+		eq |= 1;
+	uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+	uint64_t ph = mv | ~(xh | pv);
+	uint64_t mh = pv & xh;
+	int hout = ((ph & high) ? 1 : ((mh & high) ? -1 : 0));
+
+	ph <<= 1;
+	mh <<= 1;
+	if (hin < 0)
+		mh |= 1;
+	else if (hin > 0)
+		ph |= 1;
+	p->pv[b] = mh | ~(xv | ph);
+	p->mv[b] = ph & xv;
+	return hout;
+}
+
+
+/*
+ * Any pattern length: the column is split into 64 row blocks, chained by
+ * their horizontal deltas. Rows below column + @max can only hold values
+ * over @max, so blocks are only brought in as that diagonal band reaches
+ * them; a block joining late starts from the upper bound "+1 per row",
+ * which keeps every value <= @max exact.
+ */
+static size_t ed_blocks(struct ed_pattern *p, const unsigned char *t, size_t n,
+			size_t max)
+{
+	const size_t nb = p->nblocks;
+	const size_t m = p->m;
+	size_t y;	/* last active block */
+
+	p->pv[0] = ~(uint64_t)0;
+	p->mv[0] = 0;
+	p->score[0] = (m < 64 ? m : 64);
+	y = 0;
+
+	for (size_t j = 0; j < n; j++) {
+		// Bring in the blocks the band reaches in this column
+		size_t reach = (j + max < m - 1 ? j + max : m - 1);
+		while (y < reach / 64) {
+			y++;
+			p->pv[y] = ~(uint64_t)0;
+			p->mv[y] = 0;
+			p->score[y] = p->score[y - 1] + (y + 1 < nb ? 64 : m - 64 * y);
+		}
+
+		const uint64_t *eq = p->peq + (size_t)t[j] * nb;
+		int h = 1;
+		for (size_t b = 0; b <= y; b++) {
+			uint64_t high = (b + 1 < nb ? (uint64_t)1 << 63 : p->last);
+			h = ed_advance(p, b, eq[b], high, h);
+			p->score[b] += (size_t)h;
+		}
+
+		// Lower bound of the column, as in ed_single()
+		size_t ups = 0;
+		for (size_t b = 0; b <= y; b++) {
+			uint64_t mask = (b + 1 < nb ? ~(uint64_t)0 : p->last | (p->last - 1));
+			ups += popcount64(p->pv[b] & mask);
+		}
+		if (j + 1 > max && p->score[y] > max + ups)
+			return STR_NPOS;
+		if (y + 1 == nb && p->score[y] > max + (n - j - 1))
+			return STR_NPOS;
+	}
+
+	if (y + 1 < nb)		// only when m > n + max, ruled out by the caller
+		return STR_NPOS;
+	return (p->score[y] <= max ? p->score[y] : STR_NPOS);
+}
+
+
+/*
+ * Distance of a prepared pattern to @t, or STR_NPOS if above @max. No
+ * distance exceeds the longer length, so @max is clamped to that and the
+ * bounds above cannot overflow.
+ */
+static size_t ed_distance(struct ed_pattern *p, const unsigned char *t, size_t n,
+			  size_t max)
+{
+	size_t diff = (p->m > n ? p->m - n : n - p->m);
+
+	if (max > (p->m > n ? p->m : n))
+		max = (p->m > n ? p->m : n);
+	if (diff > max)
+		return STR_NPOS;
+	if (!p->m || !n)
+		return diff;
+	if (p->nblocks == 1)
+		return ed_single(p->peq, p->m, p->last, t, n, max);
+	return ed_blocks(p, t, n, max);
+}
+
+
+static void lock_pair(struct Str *a, struct Str *b)
+{
+	if (a == b) {
+		pthread_mutex_lock(&a->lock);
+	} else if ((uintptr_t)a < (uintptr_t)b) {
+		pthread_mutex_lock(&a->lock);
+		pthread_mutex_lock(&b->lock);
+	} else {
+		pthread_mutex_lock(&b->lock);
+		pthread_mutex_lock(&a->lock);
+	}
+}
+
+
+static void unlock_pair(struct Str *a, struct Str *b)
+{
+	pthread_mutex_unlock(&a->lock);
+	if (a != b)
+		pthread_mutex_unlock(&b->lock);
+}
+
+
+size_t str_edit_distance(struct Str *a, struct Str *b, size_t max)
+{
+	if (!a || !b)
+		return STR_NPOS;
+
+	lock_pair(a, b);
+	const unsigned char *s = (const unsigned char *)(a->data ? a->data : "");
+	const unsigned char *t = (const unsigned char *)(b->data ? b->data : "");
+	size_t m = (a->data ? a->size : 0);
+	size_t n = (b->data ? b->size : 0);
+
+	// A common prefix and suffix never change the distance
+	while (m && n && *s == *t) {
+		s++, t++;
+		m--, n--;
+	}
+	while (m && n && s[m - 1] == t[n - 1])
+		m--, n--;
+
+	// The shorter string is the bit-parallel side
+	if (m > n) {
+		const unsigned char *tmp = s;
+		s = t;
+		t = tmp;
+		size_t len = m;
+		m = n;
+		n = len;
+	}
+
+	size_t ret;
+	if (max > n)
+		max = n;
+	if (n - m > max) {
+		ret = STR_NPOS;
+	} else if (!m) {
+		ret = n;
+	} else if (m <= 64) {
+		uint64_t peq[256] = { 0 };
+		for (size_t i = 0; i < m; i++)
+			peq[s[i]] |= (uint64_t)1 << i;
+		ret = ed_single(peq, m, (uint64_t)1 << (m - 1), t, n, max);
+	} else {
+		struct ed_pattern p;
+		if (ed_pattern_init(&p, s, m)) {
+			ret = ed_blocks(&p, t, n, max);
+			ed_pattern_free(&p);
+		} else {
+			ret = STR_NPOS;
+		}
+	}
+
+	unlock_pair(a, b);
+	return ret;
+}
+
+
+/*	TOP-K	*/
+
+struct fuzzy_shared {
+	const unsigned char *query;
+	size_t	query_size;
+	struct Str *const *candidates;
+	size_t	n;
+	size_t	k;
+	atomic_size_t next;	/* first candidate nobody has taken yet */
+	atomic_size_t bound;	/* a k-th best distance some worker has seen */
+};
+
+
+struct fuzzy_worker {
+	pthread_t thread;
+	struct fuzzy_shared *sh;
+	struct Str_fuzzy_hit *heap;	/* max-heap on (distance, index) */
+	size_t	count;
+	bool	failed;
+};
+
+
+static inline bool hit_worse(const struct Str_fuzzy_hit *a, const struct Str_fuzzy_hit *b)
+{
+	return (a->distance != b->distance ? a->distance > b->distance : a->index > b->index);
+}
+
+
+static void heap_sift_down(struct Str_fuzzy_hit *h, size_t count, size_t i)
+{
+	for (;;) {
+		size_t l = 2 * i + 1;
+		size_t worst = i;
+		if (l < count && hit_worse(&h[l], &h[worst]))
+			worst = l;
+		if (l + 1 < count && hit_worse(&h[l + 1], &h[worst]))
+			worst = l + 1;
+		if (worst == i)
+			return;
+		struct Str_fuzzy_hit tmp = h[i];
+		h[i] = h[worst];
+		h[worst] = tmp;
+		i = worst;
+	}
+}
+
+
+static void heap_push(struct Str_fuzzy_hit *h, size_t *count, size_t k,
+		      struct Str_fuzzy_hit hit)
+{
+	if (*count < k) {
+		size_t i = (*count)++;
+		h[i] = hit;
+		while (i && hit_worse(&h[i], &h[(i - 1) / 2])) {
+			struct Str_fuzzy_hit tmp = h[i];
+			h[i] = h[(i - 1) / 2];
+			h[(i - 1) / 2] = tmp;
+			i = (i - 1) / 2;
+		}
+	} else if (hit_worse(&h[0], &hit)) {
+		h[0] = hit;
+		heap_sift_down(h, *count, 0);
+	}
+}
+
+
+/*
+ * Take chunks of candidates until none are left. Each distance is only
+ * computed up to the smallest k-th best known, locally or from another
+ * worker: a candidate above that cannot make the final list.
+ */
+static void *fuzzy_worker_run(void *arg)
+{
+	struct fuzzy_worker *w = (struct fuzzy_worker *)arg;
+	struct fuzzy_shared *sh = w->sh;
+	struct ed_pattern p;
+
+	if (!ed_pattern_init(&p, sh->query, sh->query_size)) {
+		w->failed = true;
+		return NULL;
+	}
+
+	for (;;) {
+		size_t first = atomic_fetch_add_explicit(&sh->next, FUZZY_CHUNK,
+							 memory_order_relaxed);
+		if (first >= sh->n)
+			break;
+		size_t end = (sh->n - first > FUZZY_CHUNK ? first + FUZZY_CHUNK : sh->n);
+
+		for (size_t i = first; i < end; i++) {
+			struct Str *c = sh->candidates[i];
+			if (!c)
+				continue;
+
+			size_t max = atomic_load_explicit(&sh->bound, memory_order_relaxed);
+			if (w->count == sh->k && w->heap[0].distance < max)
+				max = w->heap[0].distance;
+
+			pthread_mutex_lock(&c->lock);
+			size_t d = ed_distance(&p, (const unsigned char *)(c->data ? c->data : ""),
+					       (c->data ? c->size : 0), max);
+			pthread_mutex_unlock(&c->lock);
+			if (d == STR_NPOS)
+				continue;
+
+			struct Str_fuzzy_hit hit = { i, d };
+			heap_push(w->heap, &w->count, sh->k, hit);
+
+			// Publish a tighter bound for the other workers
+			if (w->count == sh->k) {
+				size_t mine = w->heap[0].distance;
+				size_t cur = atomic_load_explicit(&sh->bound, memory_order_relaxed);
+				while (mine < cur &&
+				       !atomic_compare_exchange_weak_explicit(&sh->bound, &cur, mine,
+									      memory_order_relaxed,
+									      memory_order_relaxed))
+					;
+			}
+		}
+	}
+
+	ed_pattern_free(&p);
+	return NULL;
+}
+
+
+static int cmp_hits(const void *a, const void *b)
+{
+	const struct Str_fuzzy_hit *x = (const struct Str_fuzzy_hit *)a;
+	const struct Str_fuzzy_hit *y = (const struct Str_fuzzy_hit *)b;
+	return hit_worse(x, y) - hit_worse(y, x);
+}
+
+
+size_t str_fuzzy_topk(struct Str *query, struct Str *const *candidates, size_t n,
+		      size_t k, struct Str_fuzzy_hit *out)
+{
+	if (!query || !candidates || !out || !k || !n)
+		return 0;
+	if (k > n)
+		k = n;
+
+	// Copy the query so the workers never touch its lock
+	pthread_mutex_lock(&query->lock);
+	size_t qsize = (query->data ? query->size : 0);
+	unsigned char *q = (unsigned char *)malloc(qsize + 1);
+	if (q && qsize)
+		memcpy(q, query->data, qsize);
+	pthread_mutex_unlock(&query->lock);
+	if (!q)
+		return 0;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = n / FUZZY_MIN_PER_THREAD;
+	if (cpus > 0 && nthreads > (size_t)cpus)
+		nthreads = (size_t)cpus;
+	if (nthreads > FUZZY_MAX_THREADS)
+		nthreads = FUZZY_MAX_THREADS;
+	if (nthreads > n / k)	// keeps the per worker heaps at O(n) in total
+		nthreads = n / k;
+	if (!nthreads)
+		nthreads = 1;
+
+	struct fuzzy_shared sh = { q, qsize, candidates, n, k, 0, STR_NPOS - 1 };
+	struct fuzzy_worker *w = (struct fuzzy_worker *)calloc(nthreads, sizeof(*w));
+	struct Str_fuzzy_hit *heaps = (struct Str_fuzzy_hit *)malloc(nthreads * k * sizeof(*heaps));
+	if (!w || !heaps) {
+		free(w);
+		free(heaps);
+		free(q);
+		return 0;
+	}
+
+	// Worker 0 is this thread; if a thread cannot be started the rest share its work
+	size_t started = 1;
+	for (size_t t = 0; t < nthreads; t++) {
+		w[t].sh = &sh;
+		w[t].heap = heaps + t * k;
+	}
+	for (size_t t = 1; t < nthreads; t++) {
+		if (pthread_create(&w[t].thread, NULL, fuzzy_worker_run, &w[t]) != 0)
+			break;
+		started++;
+	}
+	fuzzy_worker_run(&w[0]);
+
+	// A worker that could not set up took no candidates; the others did
+	bool failed = w[0].failed;
+	size_t total = w[0].count;
+	for (size_t t = 1; t < started; t++) {
+		pthread_join(w[t].thread, NULL);
+		failed &= w[t].failed;
+		// Pack the heaps back to back for the final sort
+		memmove(heaps + total, w[t].heap, w[t].count * sizeof(*heaps));
+		total += w[t].count;
+	}
+
+	size_t ret = 0;
+	if (!failed) {
+		qsort(heaps, total, sizeof(*heaps), cmp_hits);
+		ret = (total < k ? total : k);
+		memcpy(out, heaps, ret * sizeof(*out));
+	}
+
+	free(heaps);
+	free(w);
+	free(q);
+	return ret;
+}
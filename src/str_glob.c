@@ -0,0 +1,525 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+
+// Compile flags str_glob_compile() knows about
+#define STR_GLOB_FLAGS		STR_ICASE
+
+/*
+ * Subset construction is exponential for patterns like "*a??????????";
+ * past this many states the pattern is run as a bit-parallel NFA instead,
+ * which is slower per byte but just as linear.
+ */
+#define STR_GLOB_MAX_STATES	4096
+
+#define GLOB_DEAD	0u	/* empty state set: nothing can match any more */
+#define GLOB_START	1u
+
+// Flags in the last column of a DFA row
+#define GLOB_ACCEPT	0x01u
+#define GLOB_FINAL	0x02u	/* no byte leaves the state: result is known */
+#define GLOB_ACCEL	0x04u	/* few bytes leave the state: skip to them */
+
+
+/*
+ * A glob is a sequence of tokens, each either a star or a byte set ('?',
+ * a bracket expression or a literal). NFA state i means "the first i
+ * tokens are matched"; bit i of a state set stands for state i.
+ */
+struct glob_token {
+	bool	star;
+	uint64_t set[4];
+};
+
+
+/*
+ * The bytes that leave a DFA state. While a state like the one for the
+ * star in "*.log" is left by few bytes, the matcher jumps straight to the
+ * next of them with the SIMD byte set scan.
+ */
+struct glob_accel {
+	unsigned char set[STR_SMALL_SET_MAX];
+	size_t	nset;
+};
+
+
+struct Str_glob {
+	size_t	nwords;		/* 64 bit words per NFA state set */
+	size_t	ntokens;
+	size_t	nclasses;
+	uint8_t	classes[256];	/* byte -> equivalence class */
+	uint64_t *match;	/* per class: states whose next token takes it */
+	uint64_t *star;		/* states whose next token is a star */
+	/*
+	 * DFA, NULL when the pattern runs as an NFA. A state is a row of
+	 * nclasses + 1 words: the offsets of the next rows, so no multiply
+	 * sits in the per byte dependency chain, and the GLOB_* flags.
+	 */
+	uint32_t *delta;
+	struct glob_accel *accel;	/* per state */
+	size_t	nstates;
+};
+
+
+static inline void set_add(uint64_t *set, unsigned char c)
+{
+	set[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+
+static inline bool set_has(const uint64_t *set, unsigned char c)
+{
+	return (set[c >> 6] >> (c & 63)) & 1;
+}
+
+
+static void set_add_icase(uint64_t *set, unsigned char c, bool icase)
+{
+	set_add(set, c);
+	if (icase) {
+		unsigned char lo = str_fold(c);
+		set_add(set, lo);
+		if (lo >= 'a' && lo <= 'z')
+			set_add(set, lo & ~0x20u);
+	}
+}
+
+
+/*
+ * Parse a bracket expression starting after '['. Returns the position
+ * after the closing ']', or NULL if there is none.
+ */
+static const char *parse_bracket(const char *p, uint64_t *set, bool icase)
+{
+	bool negate = false;
+	bool first = true;
+
+	if (*p == '!' || *p == '^') {
+		negate = true;
+		p++;
+	}
+
+	while (*p && (*p != ']' || first)) {
+		unsigned char lo = (unsigned char)*p++;
+		if (lo == '\\') {
+			if (!*p)
+				return NULL;
+			lo = (unsigned char)*p++;
+		}
+
+		unsigned char hi = lo;
+		if (p[0] == '-' && p[1] && p[1] != ']') {
+			p++;
+			hi = (unsigned char)*p++;
+			if (hi == '\\') {
+				if (!*p)
+					return NULL;
+				hi = (unsigned char)*p++;
+			}
+		}
+		for (unsigned int c = lo; c <= hi; c++)
+			set_add_icase(set, (unsigned char)c, icase);
+		first = false;
+	}
+	if (*p != ']')
+		return NULL;
+
+	if (negate) {
+		for (int w = 0; w < 4; w++)
+			set[w] = ~set[w];
+	}
+	return p + 1;
+}
+
+
+static struct glob_token *parse_glob(const char *p, bool icase, size_t *ntokens)
+{
+	struct glob_token *tok = (struct glob_token *)calloc(strlen(p) + 1, sizeof(*tok));
+	size_t n = 0;
+
+	if (!tok)
+		return NULL;
+
+	while (*p) {
+		if (*p == '*') {
+			// Runs of stars are one star
+			if (!n || !tok[n - 1].star)
+				tok[n++].star = true;
+			p++;
+			continue;
+		}
+
+		uint64_t *set = tok[n].set;
+		if (*p == '?') {
+			memset(set, 0xff, sizeof(tok[n].set));
+			p++;
+		} else if (*p == '[') {
+			p = parse_bracket(p + 1, set, icase);
+			if (!p) {
+				free(tok);
+				errno = EINVAL;
+				return NULL;
+			}
+		} else {
+			if (*p == '\\' && !*++p) {
+				free(tok);
+				errno = EINVAL;
+				return NULL;
+			}
+			set_add_icase(set, (unsigned char)*p++, icase);
+		}
+		n++;
+	}
+
+	*ntokens = n;
+	return tok;
+}
+
+
+/*
+ * Split the bytes into classes that no token tells apart: every byte set
+ * refines the partition into (old class, in set) pairs.
+ */
+static void glob_classes(struct Str_glob *glob, const struct glob_token *tok,
+			 size_t ntokens)
+{
+	memset(glob->classes, 0, sizeof(glob->classes));
+	glob->nclasses = 1;
+
+	for (size_t t = 0; t < ntokens; t++) {
+		if (tok[t].star)
+			continue;
+
+		int16_t remap[2][256];
+		size_t next = 0;
+		memset(remap, 0xff, sizeof(remap));
+		for (unsigned int c = 0; c < 256; c++) {
+			int in = set_has(tok[t].set, (unsigned char)c);
+			int16_t *slot = &remap[in][glob->classes[c]];
+			if (*slot < 0)
+				*slot = (int16_t)next++;
+			glob->classes[c] = (uint8_t)*slot;
+		}
+		glob->nclasses = next;
+	}
+}
+
+
+// S |= (S & star) << 1: a star may also match nothing
+static void glob_close(const struct Str_glob *glob, uint64_t *s)
+{
+	uint64_t carry = 0;
+
+	for (size_t w = 0; w < glob->nwords; w++) {
+		uint64_t e = s[w] & glob->star[w];
+		s[w] |= (e << 1) | carry;
+		carry = e >> 63;
+	}
+}
+
+
+// One byte of class @c: next tokens that take it advance, stars stay
+static void glob_step(const struct Str_glob *glob, const uint64_t *s,
+		      size_t c, uint64_t *out)
+{
+	const uint64_t *m = glob->match + c * glob->nwords;
+	uint64_t carry = 0;
+
+	for (size_t w = 0; w < glob->nwords; w++) {
+		uint64_t adv = s[w] & m[w];
+		out[w] = (adv << 1) | carry | (s[w] & glob->star[w]);
+		carry = adv >> 63;
+	}
+	glob_close(glob, out);
+}
+
+
+static inline bool glob_accepts(const struct Str_glob *glob, const uint64_t *s)
+{
+	return (s[glob->ntokens >> 6] >> (glob->ntokens & 63)) & 1;
+}
+
+
+static uint32_t glob_hash(const uint64_t *s, size_t nwords)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+
+	for (size_t w = 0; w < nwords; w++) {
+		h ^= s[w];
+		h *= 0x100000001b3ull;
+	}
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+
+/*
+ * Lay out the finished DFA: rows with row offsets and flags, and the
+ * acceleration sets. @ids holds the transitions as state numbers.
+ */
+static int glob_finish_dfa(struct Str_glob *glob, const uint32_t *ids,
+			   const bool *accept)
+{
+	const size_t nc = glob->nclasses;
+	const size_t row = nc + 1;
+
+	glob->delta = (uint32_t *)malloc(glob->nstates * row * sizeof(uint32_t));
+	glob->accel = (struct glob_accel *)calloc(glob->nstates, sizeof(struct glob_accel));
+	if (!glob->delta || !glob->accel)
+		return -ENOMEM;
+
+	for (size_t u = 0; u < glob->nstates; u++) {
+		uint32_t *r = glob->delta + u * row;
+		struct glob_accel *a = &glob->accel[u];
+		size_t leave = 0;
+
+		for (size_t c = 0; c < nc; c++)
+			r[c] = (uint32_t)(ids[u * nc + c] * row);
+		for (unsigned int c = 0; c < 256; c++) {
+			if (ids[u * nc + glob->classes[c]] == u)
+				continue;
+			if (leave < STR_SMALL_SET_MAX)
+				a->set[leave] = (unsigned char)c;
+			leave++;
+		}
+
+		r[nc] = (accept[u] ? GLOB_ACCEPT : 0);
+		if (!leave)
+			r[nc] |= GLOB_FINAL;
+		else if (leave <= STR_SMALL_SET_MAX)
+			r[nc] |= GLOB_ACCEL;
+		a->nset = (leave <= STR_SMALL_SET_MAX ? leave : 0);
+	}
+	return 0;
+}
+
+
+/*
+ * Subset construction over the byte classes. The state sets are kept in
+ * one pool and found again through an open addressing hash table. Returns
+ * -E2BIG when the DFA would get larger than STR_GLOB_MAX_STATES.
+ */
+static int glob_build_dfa(struct Str_glob *glob)
+{
+	const size_t nw = glob->nwords;
+	const size_t nc = glob->nclasses;
+	const size_t hash_size = 2 * STR_GLOB_MAX_STATES;
+	uint64_t *pool = (uint64_t *)calloc(STR_GLOB_MAX_STATES * nw, sizeof(uint64_t));
+	uint32_t *table = (uint32_t *)calloc(hash_size, sizeof(uint32_t));
+	uint64_t *next = (uint64_t *)malloc(nw * sizeof(uint64_t));
+	uint32_t *ids = (uint32_t *)malloc(STR_GLOB_MAX_STATES * nc * sizeof(uint32_t));
+	bool *accept = (bool *)malloc(STR_GLOB_MAX_STATES * sizeof(bool));
+	int ret = -ENOMEM;
+
+	if (!pool || !table || !next || !ids || !accept)
+		goto out;
+
+	// State 0 is the empty set; state 1 the start set
+	uint64_t *start = pool + nw;
+	start[0] = 1;
+	glob_close(glob, start);
+	table[glob_hash(pool, nw) & (hash_size - 1)] = GLOB_DEAD + 1;
+	for (uint32_t h = glob_hash(start, nw) & (hash_size - 1);; h = (h + 1) & (hash_size - 1)) {
+		if (!table[h]) {
+			table[h] = GLOB_START + 1;
+			break;
+		}
+	}
+	glob->nstates = 2;
+
+	for (size_t u = 0; u < glob->nstates; u++) {
+		const uint64_t *s = pool + u * nw;
+		accept[u] = glob_accepts(glob, s);
+
+		for (size_t c = 0; c < nc; c++) {
+			glob_step(glob, s, c, next);
+
+			uint32_t h = glob_hash(next, nw) & (hash_size - 1);
+			uint32_t v;
+			for (;; h = (h + 1) & (hash_size - 1)) {
+				if (!table[h]) {
+					if (glob->nstates == STR_GLOB_MAX_STATES) {
+						ret = -E2BIG;
+						goto out;
+					}
+					v = (uint32_t)glob->nstates++;
+					memcpy(pool + v * nw, next, nw * sizeof(uint64_t));
+					table[h] = v + 1;
+					break;
+				}
+				v = table[h] - 1;
+				if (!memcmp(pool + v * nw, next, nw * sizeof(uint64_t)))
+					break;
+			}
+			ids[u * nc + c] = v;
+		}
+	}
+
+	ret = glob_finish_dfa(glob, ids, accept);
+
+out:
+	if (ret) {
+		free(glob->delta);
+		free(glob->accel);
+		glob->delta = NULL;
+		glob->accel = NULL;
+		glob->nstates = 0;
+	}
+	free(pool);
+	free(table);
+	free(next);
+	free(ids);
+	free(accept);
+	return ret;
+}
+
+
+void str_glob_free(struct Str_glob *glob)
+{
+	if (!glob)
+		return;
+
+	free(glob->match);
+	free(glob->star);
+	free(glob->delta);
+	free(glob->accel);
+	free(glob);
+}
+
+
+struct Str_glob *str_glob_compile(const char *pattern, unsigned int flags)
+{
+	if (!pattern || (flags & ~STR_GLOB_FLAGS)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	size_t ntokens;
+	struct glob_token *tok = parse_glob(pattern, (flags & STR_ICASE) != 0, &ntokens);
+	if (!tok)
+		return NULL;
+
+	struct Str_glob *glob = (struct Str_glob *)calloc(1, sizeof(struct Str_glob));
+	if (!glob) {
+		free(tok);
+		return NULL;
+	}
+
+	glob->ntokens = ntokens;
+	glob->nwords = ntokens / 64 + 1;
+	glob_classes(glob, tok, ntokens);
+
+	const size_t nw = glob->nwords;
+	glob->match = (uint64_t *)calloc(glob->nclasses * nw, sizeof(uint64_t));
+	glob->star = (uint64_t *)calloc(nw, sizeof(uint64_t));
+	if (!glob->match || !glob->star)
+		goto fail;
+
+	for (size_t t = 0; t < ntokens; t++) {
+		uint64_t bit = (uint64_t)1 << (t & 63);
+		if (tok[t].star) {
+			glob->star[t >> 6] |= bit;
+			continue;
+		}
+		for (unsigned int c = 0; c < 256; c++) {
+			if (set_has(tok[t].set, (unsigned char)c))
+				glob->match[glob->classes[c] * nw + (t >> 6)] |= bit;
+		}
+	}
+	free(tok);
+	tok = NULL;
+
+	int ret = glob_build_dfa(glob);
+	if (ret && ret != -E2BIG)
+		goto fail;
+
+	return glob;
+
+fail:
+	free(tok);
+	str_glob_free(glob);
+	errno = ENOMEM;
+	return NULL;
+}
+
+
+// Fallback for patterns too large for a DFA: step the state set directly
+static bool glob_match_nfa(const struct Str_glob *glob, const unsigned char *h,
+			   size_t size)
+{
+	const size_t nw = glob->nwords;
+	uint64_t stack_sets[2][8];
+	uint64_t *cur = stack_sets[0];
+	uint64_t *next = stack_sets[1];
+	uint64_t *heap = NULL;
+	bool alive = true;
+
+	if (nw > 8) {
+		heap = (uint64_t *)malloc(2 * nw * sizeof(uint64_t));
+		if (!heap)
+			return false;
+		cur = heap;
+		next = heap + nw;
+	}
+
+	memset(cur, 0, nw * sizeof(uint64_t));
+	cur[0] = 1;
+	glob_close(glob, cur);
+
+	for (size_t i = 0; i < size && alive; i++) {
+		glob_step(glob, cur, glob->classes[h[i]], next);
+		uint64_t *tmp = cur;
+		cur = next;
+		next = tmp;
+
+		alive = false;
+		for (size_t w = 0; w < nw; w++)
+			alive |= (cur[w] != 0);
+	}
+
+	bool ret = alive && glob_accepts(glob, cur);
+	free(heap);
+	return ret;
+}
+
+
+bool str_glob_match(struct Str *self, const struct Str_glob *glob)
+{
+	if (!self || !glob)
+		return false;
+
+	pthread_mutex_lock(&self->lock);
+	const unsigned char *h = (const unsigned char *)self->data;
+	const size_t size = (h ? self->size : 0);
+	bool ret;
+
+	if (!glob->delta) {
+		ret = glob_match_nfa(glob, (h ? h : (const unsigned char *)""), size);
+	} else {
+		const struct str_kernels *k = str_kernels_get();
+		const uint32_t *delta = glob->delta;
+		const size_t nc = glob->nclasses;
+		const size_t row = nc + 1;
+		size_t off = GLOB_START * row;
+		size_t i = 0;
+
+		while (i < size) {
+			uint32_t flags = delta[off + nc];
+			if (flags & (GLOB_FINAL | GLOB_ACCEL)) {
+				if (flags & GLOB_FINAL)
+					break;
+				const struct glob_accel *a = &glob->accel[off / row];
+				i = k->find_bytes(h, size, i, a->set, a->nset);
+				if (i == STR_NPOS)
+					break;	// the rest of the input stays here
+			}
+			off = delta[off + glob->classes[h[i++]]];
+		}
+		ret = (delta[off + nc] & GLOB_ACCEPT);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
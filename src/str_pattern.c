@@ -0,0 +1,255 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+// Compile flags str_pattern_compile() knows about
+#define STR_PATTERN_FLAGS	STR_SEARCH_FLAGS
+
+
+/*
+ * The second filter byte is the last one, unless it equals the first;
+ * then take the last byte that differs, so runs of the first byte (e.g.
+ * "aaaab" in "aaaa...") do not turn every position into a candidate.
+ */
+static size_t pattern_anchor(const unsigned char *n, size_t size, bool icase)
+{
+	for (size_t j = size - 1; j > 0; j--) {
+		if (icase ? str_fold(n[j]) != str_fold(n[0]) : n[j] != n[0])
+			return j;
+	}
+	return size - 1;
+}
+
+
+// Backward search: the first byte that differs from the last one
+static size_t pattern_ranchor(const unsigned char *n, size_t size)
+{
+	for (size_t j = 0; j + 1 < size; j++) {
+		if (n[j] != n[size - 1])
+			return j;
+	}
+	return 0;
+}
+
+
+void str_pattern_init(struct Str_pattern *pat, const char *needle,
+		      size_t size, unsigned int flags)
+{
+	pat->needle = (const unsigned char *)needle;
+	pat->size = size;
+	pat->icase = ((flags & STR_ICASE) != 0);
+	pat->anchor = (size ? pattern_anchor(pat->needle, size, pat->icase) : 0);
+	pat->ranchor = (size ? pattern_ranchor(pat->needle, size) : 0);
+	pat->flags = flags & STR_SEARCH_FLAGS;
+	pat->ww_left = ((flags & STR_WHOLE_WORD) && size && str_is_word_byte(pat->needle[0]));
+	pat->ww_right = ((flags & STR_WHOLE_WORD) && size && str_is_word_byte(pat->needle[size - 1]));
+	pat->compiled = false;
+}
+
+
+struct Str_pattern *str_pattern_compile(const char *needle, unsigned int flags)
+{
+	if (!needle || (flags & ~STR_PATTERN_FLAGS)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct Str_pattern *pat = (struct Str_pattern *)malloc(sizeof(struct Str_pattern));
+	if (!pat)
+		return NULL;
+
+	size_t size = strlen(needle);
+	unsigned char *copy = (unsigned char *)malloc(size + 1);
+	if (!copy) {
+		free(pat);
+		return NULL;
+	}
+	memcpy(copy, needle, size + 1);
+
+	str_pattern_init(pat, (const char *)copy, size, flags);
+
+	// Horspool: shift by the distance from the byte's last use to the end
+	for (size_t c = 0; c < 256; c++)
+		pat->skip[c] = (size ? size : 1);
+	for (size_t i = 0; i + 1 < size; i++) {
+		unsigned char lo = str_fold(copy[i]);
+
+		pat->skip[copy[i]] = size - 1 - i;
+		if (pat->icase && lo >= 'a' && lo <= 'z') {
+			// Both cases of a letter shift alike
+			pat->skip[lo] = size - 1 - i;
+			pat->skip[lo & ~0x20u] = size - 1 - i;
+		}
+	}
+
+	if (size)
+		str_twoway_prepare(&pat->tw, copy, size, pat->icase);
+
+	pat->compiled = true;
+	return pat;
+}
+
+
+void str_pattern_free(struct Str_pattern *pat)
+{
+	if (pat) {
+		free((void *)pat->needle);
+		free(pat);
+	}
+}
+
+
+/*
+ * Where to look next after a match at @pos failed the whole word test. If
+ * the needle must start a word, nothing can match before the current word
+ * ends, so skip its remaining bytes.
+ */
+static size_t ww_next(const struct Str_pattern *pat, const unsigned char *h,
+		      size_t hl, size_t pos)
+{
+	size_t from = pos + 1;
+
+	if (pat->ww_left) {
+		while (from < hl && str_is_word_byte(h[from - 1]))
+			from++;
+	}
+	return from;
+}
+
+
+size_t str_pattern_find_from(const struct Str_pattern *pat, const char *hay,
+			     size_t hay_size, size_t start)
+{
+	const unsigned char *h = (const unsigned char *)hay;
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	size_t from = start;
+	size_t pos;
+
+	if (start > hay_size)
+		return STR_NPOS;
+	if (nl == 0)
+		return start;
+	if (nl > hay_size - start)
+		return STR_NPOS;
+
+	const unsigned char lo = str_fold(n[0]);
+	if (nl == 1 && pat->icase && lo >= 'a' && lo <= 'z') {
+		// A letter: take whichever case shows up first
+		for (pos = from; pos < hay_size; pos++) {
+			if (str_fold(h[pos]) == lo && str_ww_ok(h, hay_size, pos, pat))
+				return pos;
+		}
+		return STR_NPOS;
+	}
+
+	if (nl == 1) {
+		const unsigned char *p;
+		while (from < hay_size && (p = memchr(h + from, n[0], hay_size - from))) {
+			pos = (size_t)(p - h);
+			if (str_ww_ok(h, hay_size, pos, pat))
+				return pos;
+			from = ww_next(pat, h, hay_size, pos);
+		}
+		return STR_NPOS;
+	}
+
+	size_t bail;
+	pos = str_kernels_get()->find(h, hay_size, start, pat, &bail);
+	if (pos != STR_NPOS || bail == STR_NPOS)
+		return pos;
+
+	// Worst case input: finish with Two-Way
+	struct str_twoway local;
+	const struct str_twoway *tw = &pat->tw;
+	if (!pat->compiled) {
+		str_twoway_prepare(&local, n, nl, pat->icase);
+		tw = &local;
+	}
+
+	from = bail;
+	while (hay_size - from >= nl) {
+		pos = str_twoway_search(tw, h + from, hay_size - from, n, nl);
+		if (pos == STR_NPOS)
+			return STR_NPOS;
+
+		pos += from;
+		if (str_ww_ok(h, hay_size, pos, pat))
+			return pos;
+		from = ww_next(pat, h, hay_size, pos);
+		if (from > hay_size)
+			break;
+	}
+	return STR_NPOS;
+}
+
+
+size_t str_pattern_find(const struct Str_pattern *pat, const char *hay,
+			size_t hay_size)
+{
+	return str_pattern_find_from(pat, hay, hay_size, 0);
+}
+
+
+size_t str_pattern_rfind(const struct Str_pattern *pat, const char *hay,
+			 size_t hay_size, size_t last)
+{
+	const unsigned char *h = (const unsigned char *)hay;
+	const size_t nl = pat->size;
+	const struct str_kernels *k = str_kernels_get();
+
+	if (nl > hay_size)
+		return STR_NPOS;
+	if (last > hay_size - nl)
+		last = hay_size - nl;
+	if (nl == 0)
+		return last;
+	if (nl == 1)
+		return k->rfind_bytes(h, last + 1, pat->needle, 1);
+
+	size_t bail;
+	size_t pos = k->rfind(h, hay_size, last, pat, &bail);
+	if (pos != STR_NPOS || bail == 0)
+		return pos;
+
+	/*
+	 * Worst case input: run Two-Way over the rest of the haystack read
+	 * backwards, with the reversed needle. Its first match is our last.
+	 */
+	unsigned char stack_rev[256];
+	unsigned char *rev = stack_rev;
+	if (nl > sizeof(stack_rev)) {
+		rev = (unsigned char *)malloc(nl);
+		if (!rev) {
+			// No memory: finish the naive way, still correct
+			for (size_t i = bail; i-- > 0;) {
+				if (!memcmp(h + i, pat->needle, nl))
+					return i;
+			}
+			return STR_NPOS;
+		}
+	}
+	for (size_t i = 0; i < nl; i++)
+		rev[i] = pat->needle[nl - 1 - i];
+
+	struct str_twoway tw;
+	size_t rest = bail - 1 + nl;
+	str_twoway_prepare(&tw, rev, nl, false);
+	pos = str_twoway_rsearch(&tw, h, rest, rev, nl);
+	if (rev != stack_rev)
+		free(rev);
+
+	return (pos == STR_NPOS ? pos : rest - pos - nl);
+}
+
+
+size_t str_mem_find(const char *hay, size_t hay_size,
+		    const char *needle, size_t needle_size)
+{
+	struct Str_pattern pat;
+
+	str_pattern_init(&pat, needle, needle_size, 0);
+	return str_pattern_find(&pat, hay, hay_size);
+}
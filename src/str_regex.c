@@ -0,0 +1,1623 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+
+
+// Compile flags str_regex_compile() knows about
+#define STR_REGEX_FLAGS		STR_ICASE
+
+#define RE_MAX_DEPTH		256	/* nested groups */
+#define RE_MAX_REPEAT		1000	/* largest count in {n,m} */
+#define RE_MAX_NODES		65536	/* NFA size after expanding counts */
+
+/*
+ * States one lazy DFA may cache before it is flushed and rebuilt from the
+ * state it is in. Each state costs a row of transitions plus its NFA set.
+ */
+#define RE_CACHE_STATES		4096
+
+#define RE_NIL			UINT32_MAX
+#define RE_UNKNOWN		UINT32_MAX	/* transition not computed yet */
+#define RE_TAG			0x80000000u	/* transition leads to a state to look at */
+
+
+/*	PARSER	*/
+
+enum re_op {
+	RE_SET,		/* one byte out of a set */
+	RE_CAT,
+	RE_ALT,
+	RE_REPEAT,
+	RE_BEGIN,	/* ^ */
+	RE_END,		/* $ */
+	RE_EMPTY,
+};
+
+
+struct re_ast {
+	enum re_op op;
+	int	min;		/* RE_REPEAT */
+	int	max;		/* RE_REPEAT, -1 for no limit */
+	size_t	nkids;
+	struct re_ast **kids;
+	uint64_t set[4];	/* RE_SET */
+};
+
+
+struct re_parser {
+	const char *p;
+	bool	icase;
+	int	depth;
+	int	err;
+};
+
+
+static void ast_free(struct re_ast *a)
+{
+	if (!a)
+		return;
+
+	for (size_t i = 0; i < a->nkids; i++)
+		ast_free(a->kids[i]);
+	free(a->kids);
+	free(a);
+}
+
+
+static struct re_ast *ast_new(struct re_parser *ps, enum re_op op)
+{
+	struct re_ast *a = (struct re_ast *)calloc(1, sizeof(struct re_ast));
+
+	if (!a)
+		ps->err = -ENOMEM;
+	else
+		a->op = op;
+	return a;
+}
+
+
+static bool ast_add(struct re_parser *ps, struct re_ast *parent, struct re_ast *kid)
+{
+	struct re_ast **kids = (struct re_ast **)realloc(parent->kids,
+							  (parent->nkids + 1) * sizeof(*kids));
+	if (!kids) {
+		ps->err = -ENOMEM;
+		ast_free(kid);
+		return false;
+	}
+
+	parent->kids = kids;
+	parent->kids[parent->nkids++] = kid;
+	return true;
+}
+
+
+static inline void set_add(uint64_t *set, unsigned char c)
+{
+	set[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+
+static inline bool set_has(const uint64_t *set, unsigned char c)
+{
+	return (set[c >> 6] >> (c & 63)) & 1;
+}
+
+
+static void set_add_range(uint64_t *set, unsigned int lo, unsigned int hi)
+{
+	for (unsigned int c = lo; c <= hi; c++)
+		set_add(set, (unsigned char)c);
+}
+
+
+// Both cases of every letter in the set
+static void set_fold(uint64_t *set)
+{
+	for (unsigned int c = 'a'; c <= 'z'; c++) {
+		if (set_has(set, (unsigned char)c) || set_has(set, (unsigned char)(c & ~0x20u))) {
+			set_add(set, (unsigned char)c);
+			set_add(set, (unsigned char)(c & ~0x20u));
+		}
+	}
+}
+
+
+static void set_invert(uint64_t *set)
+{
+	for (int w = 0; w < 4; w++)
+		set[w] = ~set[w];
+}
+
+
+/*
+ * Class escapes \d \w \s and their negations. Returns false if @c is not
+ * one of them.
+ */
+static bool set_add_escape_class(uint64_t *set, char c)
+{
+	uint64_t tmp[4] = { 0 };
+
+	switch (c | 0x20) {
+	case 'd':
+		set_add_range(tmp, '0', '9');
+		break;
+	case 'w':
+		set_add_range(tmp, '0', '9');
+		set_add_range(tmp, 'a', 'z');
+		set_add_range(tmp, 'A', 'Z');
+		set_add(tmp, '_');
+		break;
+	case 's':
+		set_add_range(tmp, '\t', '\r');
+		set_add(tmp, ' ');
+		break;
+	default:
+		return false;
+	}
+
+	if (c >= 'A' && c <= 'Z')
+		set_invert(tmp);
+	for (int w = 0; w < 4; w++)
+		set[w] |= tmp[w];
+	return true;
+}
+
+
+// Single byte escapes; anything else stands for itself
+static unsigned char escape_byte(char c)
+{
+	switch (c) {
+	case 'n': return '\n';
+	case 't': return '\t';
+	case 'r': return '\r';
+	case 'f': return '\f';
+	case 'v': return '\v';
+	case '0': return '\0';
+	default:  return (unsigned char)c;
+	}
+}
+
+
+// Bracket expression, ps->p is past the '['
+static struct re_ast *parse_class(struct re_parser *ps)
+{
+	struct re_ast *a = ast_new(ps, RE_SET);
+	bool negate = false;
+	bool first = true;
+
+	if (!a)
+		return NULL;
+
+	if (*ps->p == '^') {
+		negate = true;
+		ps->p++;
+	}
+
+	while (*ps->p && (*ps->p != ']' || first)) {
+		unsigned char lo = (unsigned char)*ps->p++;
+		first = false;
+
+		if (lo == '\\') {
+			if (!*ps->p)
+				break;
+			char e = *ps->p++;
+			if (set_add_escape_class(a->set, e))
+				continue;
+			lo = escape_byte(e);
+		}
+
+		unsigned char hi = lo;
+		if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+			ps->p++;
+			hi = (unsigned char)*ps->p++;
+			if (hi == '\\' && *ps->p)
+				hi = escape_byte(*ps->p++);
+			if (hi < lo) {
+				ps->err = -EINVAL;
+				ast_free(a);
+				return NULL;
+			}
+		}
+		set_add_range(a->set, lo, hi);
+	}
+
+	if (*ps->p != ']') {
+		ps->err = -EINVAL;
+		ast_free(a);
+		return NULL;
+	}
+	ps->p++;
+
+	if (ps->icase)
+		set_fold(a->set);
+	if (negate)
+		set_invert(a->set);
+	return a;
+}
+
+
+static struct re_ast *parse_alt(struct re_parser *ps);
+
+
+static struct re_ast *parse_atom(struct re_parser *ps)
+{
+	struct re_ast *a;
+	char c = *ps->p++;
+
+	switch (c) {
+	case '(':
+		if (++ps->depth > RE_MAX_DEPTH) {
+			ps->err = -E2BIG;
+			return NULL;
+		}
+		if (ps->p[0] == '?' && ps->p[1] == ':')
+			ps->p += 2;
+		a = parse_alt(ps);
+		ps->depth--;
+		if (a && *ps->p != ')') {
+			ps->err = -EINVAL;
+			ast_free(a);
+			return NULL;
+		}
+		ps->p++;
+		return a;
+	case '[':
+		return parse_class(ps);
+	case '^':
+		return ast_new(ps, RE_BEGIN);
+	case '$':
+		return ast_new(ps, RE_END);
+	case '.':
+		// Any byte but a newline
+		a = ast_new(ps, RE_SET);
+		if (a) {
+			set_add_range(a->set, 0, 255);
+			a->set[0] &= ~((uint64_t)1 << '\n');
+		}
+		return a;
+	case '*':
+	case '+':
+	case '?':
+	case ')':
+	case '|':
+		ps->err = -EINVAL;	// nothing to repeat, or unbalanced
+		return NULL;
+	}
+
+	a = ast_new(ps, RE_SET);
+	if (!a)
+		return NULL;
+
+	if (c == '\\') {
+		c = *ps->p++;
+		if (!c) {
+			ps->err = -EINVAL;
+			ast_free(a);
+			return NULL;
+		}
+		if (set_add_escape_class(a->set, c))
+			return a;
+		c = (char)escape_byte(c);
+	}
+	set_add(a->set, (unsigned char)c);
+	if (ps->icase)
+		set_fold(a->set);
+	return a;
+}
+
+
+/*
+ * A count "{n}", "{n,}" or "{n,m}" at ps->p. Returns false, without
+ * moving, when there is none; the '{' is then an ordinary byte.
+ */
+static bool parse_count(struct re_parser *ps, int *min, int *max)
+{
+	const char *p = ps->p + 1;
+	long lo = 0;
+	long hi;
+
+	if (*p < '0' || *p > '9')
+		return false;
+	while (*p >= '0' && *p <= '9' && lo <= RE_MAX_REPEAT)
+		lo = lo * 10 + (*p++ - '0');
+
+	hi = lo;
+	if (*p == ',') {
+		p++;
+		hi = -1;
+		if (*p >= '0' && *p <= '9') {
+			hi = 0;
+			while (*p >= '0' && *p <= '9' && hi <= RE_MAX_REPEAT)
+				hi = hi * 10 + (*p++ - '0');
+		}
+	}
+	if (*p != '}')
+		return false;
+
+	if (lo > RE_MAX_REPEAT || hi > RE_MAX_REPEAT || (hi >= 0 && hi < lo)) {
+		ps->err = -EINVAL;
+		return false;
+	}
+	ps->p = p + 1;
+	*min = (int)lo;
+	*max = (int)hi;
+	return true;
+}
+
+
+static struct re_ast *parse_repeat(struct re_parser *ps)
+{
+	struct re_ast *a = parse_atom(ps);
+
+	while (a) {
+		int min;
+		int max;
+		char c = *ps->p;
+
+		if (c == '*') {
+			min = 0, max = -1;
+		} else if (c == '+') {
+			min = 1, max = -1;
+		} else if (c == '?') {
+			min = 0, max = 1;
+		} else if (c == '{' && parse_count(ps, &min, &max)) {
+			ps->p--;	// parse_count moved past the '}'
+		} else {
+			if (ps->err) {
+				ast_free(a);
+				return NULL;
+			}
+			break;
+		}
+		ps->p++;
+
+		struct re_ast *r = ast_new(ps, RE_REPEAT);
+		if (!r || !ast_add(ps, r, a)) {
+			ast_free(r);
+			return NULL;
+		}
+		r->min = min;
+		r->max = max;
+		a = r;
+	}
+	return a;
+}
+
+
+static struct re_ast *parse_cat(struct re_parser *ps)
+{
+	struct re_ast *cat = ast_new(ps, RE_CAT);
+
+	while (cat && *ps->p && *ps->p != '|' && *ps->p != ')') {
+		struct re_ast *a = parse_repeat(ps);
+		if (!a || !ast_add(ps, cat, a)) {
+			ast_free(cat);
+			return NULL;
+		}
+	}
+	return cat;
+}
+
+
+static struct re_ast *parse_alt(struct re_parser *ps)
+{
+	struct re_ast *cat = parse_cat(ps);
+	if (!cat || *ps->p != '|')
+		return cat;
+
+	struct re_ast *alt = ast_new(ps, RE_ALT);
+	if (!alt || !ast_add(ps, alt, cat)) {
+		ast_free(alt);
+		return NULL;
+	}
+
+	while (*ps->p == '|') {
+		ps->p++;
+		cat = parse_cat(ps);
+		if (!cat || !ast_add(ps, alt, cat)) {
+			ast_free(alt);
+			return NULL;
+		}
+	}
+	return alt;
+}
+
+
+/*	THOMPSON NFA	*/
+
+enum re_nop {
+	NFA_BYTE,	/* consume a byte from the node's class set */
+	NFA_SPLIT,	/* epsilon to out and out1 */
+	NFA_NOP,	/* epsilon to out */
+	NFA_BEGIN,	/* epsilon to out at the start of the text */
+	NFA_END,	/* epsilon to out at the end of the text */
+	NFA_MATCH,
+};
+
+
+struct re_node {
+	uint8_t	op;
+	uint32_t out;
+	uint32_t out1;
+	uint32_t set;		/* NFA_BYTE: index into re_prog.sets */
+};
+
+
+/*
+ * One direction of the compiled regex. The reverse program matches the
+ * reversed language (concatenations reversed, ^ and $ swapped) and is used
+ * to find where a match starts.
+ */
+struct re_prog {
+	struct re_node *nodes;
+	size_t	nnodes;
+	size_t	cap;
+	uint32_t start;
+	uint64_t (*sets)[4];	/* byte sets, later class sets */
+	size_t	nsets;
+};
+
+
+/*
+ * A fragment under construction: its entry node and the list of its
+ * dangling exits, threaded through the exit fields themselves (slot
+ * index * 2 + 0 for out, + 1 for out1).
+ */
+struct re_frag {
+	uint32_t start;
+	uint32_t outs;
+};
+
+
+static uint32_t *slot_ptr(struct re_prog *prog, uint32_t slot)
+{
+	struct re_node *n = &prog->nodes[slot >> 1];
+	return ((slot & 1) ? &n->out1 : &n->out);
+}
+
+
+static void patch(struct re_prog *prog, uint32_t list, uint32_t target)
+{
+	while (list != RE_NIL) {
+		uint32_t *p = slot_ptr(prog, list);
+		list = *p;
+		*p = target;
+	}
+}
+
+
+static uint32_t append(struct re_prog *prog, uint32_t l1, uint32_t l2)
+{
+	if (l1 == RE_NIL)
+		return l2;
+
+	uint32_t last = l1;
+	for (uint32_t next; (next = *slot_ptr(prog, last)) != RE_NIL; last = next)
+		;
+	*slot_ptr(prog, last) = l2;
+	return l1;
+}
+
+
+static uint32_t node_new(struct re_prog *prog, uint8_t op, int *err)
+{
+	if (prog->nnodes == RE_MAX_NODES) {
+		*err = -E2BIG;
+		return RE_NIL;
+	}
+	if (prog->nnodes == prog->cap) {
+		size_t cap = (prog->cap ? prog->cap * 2 : 64);
+		struct re_node *nodes = (struct re_node *)realloc(prog->nodes, cap * sizeof(*nodes));
+		if (!nodes) {
+			*err = -ENOMEM;
+			return RE_NIL;
+		}
+		prog->nodes = nodes;
+		prog->cap = cap;
+	}
+
+	uint32_t n = (uint32_t)prog->nnodes++;
+	prog->nodes[n].op = op;
+	prog->nodes[n].out = RE_NIL;
+	prog->nodes[n].out1 = RE_NIL;
+	prog->nodes[n].set = 0;
+	return n;
+}
+
+
+static bool compile_ast(struct re_prog *prog, const struct re_ast *a, bool rev,
+			struct re_frag *f, int *err);
+
+
+// @a repeated @count times in sequence
+static bool compile_seq(struct re_prog *prog, const struct re_ast *a, int count,
+			bool rev, struct re_frag *f, int *err)
+{
+	uint32_t n = node_new(prog, NFA_NOP, err);
+	if (n == RE_NIL)
+		return false;
+
+	f->start = n;
+	f->outs = n << 1;
+	for (int i = 0; i < count; i++) {
+		struct re_frag k;
+		if (!compile_ast(prog, a, rev, &k, err))
+			return false;
+		patch(prog, f->outs, k.start);
+		f->outs = k.outs;
+	}
+	return true;
+}
+
+
+static bool compile_repeat(struct re_prog *prog, const struct re_ast *a, bool rev,
+			   struct re_frag *f, int *err)
+{
+	const struct re_ast *kid = a->kids[0];
+
+	if (!compile_seq(prog, kid, a->min, rev, f, err))
+		return false;
+
+	if (a->max < 0) {
+		// Then kid*: a split that loops back through one more copy
+		struct re_frag k;
+		uint32_t s = node_new(prog, NFA_SPLIT, err);
+		if (s == RE_NIL || !compile_ast(prog, kid, rev, &k, err))
+			return false;
+		prog->nodes[s].out = k.start;
+		patch(prog, k.outs, s);
+		patch(prog, f->outs, s);
+		f->outs = (s << 1) | 1;
+		return true;
+	}
+
+	// Then (kid (kid (...)?)?)? for the optional copies
+	uint32_t skips = RE_NIL;
+	for (int i = a->min; i < a->max; i++) {
+		struct re_frag k;
+		uint32_t s = node_new(prog, NFA_SPLIT, err);
+		if (s == RE_NIL || !compile_ast(prog, kid, rev, &k, err))
+			return false;
+		prog->nodes[s].out = k.start;
+		patch(prog, f->outs, s);
+		skips = append(prog, skips, (s << 1) | 1);
+		f->outs = k.outs;
+	}
+	f->outs = append(prog, f->outs, skips);
+	return true;
+}
+
+
+static bool compile_ast(struct re_prog *prog, const struct re_ast *a, bool rev,
+			struct re_frag *f, int *err)
+{
+	uint32_t n;
+
+	switch (a->op) {
+	case RE_SET: {
+		uint64_t (*sets)[4] = (uint64_t (*)[4])realloc(prog->sets, (prog->nsets + 1) * sizeof(*sets));
+		if (!sets) {
+			*err = -ENOMEM;
+			return false;
+		}
+		prog->sets = sets;
+		memcpy(prog->sets[prog->nsets], a->set, sizeof(a->set));
+
+		n = node_new(prog, NFA_BYTE, err);
+		if (n == RE_NIL)
+			return false;
+		prog->nodes[n].set = (uint32_t)prog->nsets++;
+		f->start = n;
+		f->outs = n << 1;
+		return true;
+	}
+	case RE_BEGIN:
+	case RE_END:
+		n = node_new(prog, ((a->op == RE_BEGIN) != rev ? NFA_BEGIN : NFA_END), err);
+		if (n == RE_NIL)
+			return false;
+		f->start = n;
+		f->outs = n << 1;
+		return true;
+	case RE_EMPTY:
+		return compile_seq(prog, a, 0, rev, f, err);
+	case RE_CAT:
+		if (!compile_seq(prog, a, 0, rev, f, err))
+			return false;
+		for (size_t i = 0; i < a->nkids; i++) {
+			struct re_frag k;
+			if (!compile_ast(prog, a->kids[rev ? a->nkids - 1 - i : i], rev, &k, err))
+				return false;
+			patch(prog, f->outs, k.start);
+			f->outs = k.outs;
+		}
+		return true;
+	case RE_ALT: {
+		// A chain of splits, each trying one branch or the next split
+		uint32_t prev = RE_NIL;
+		f->outs = RE_NIL;
+		for (size_t i = 0; i < a->nkids; i++) {
+			struct re_frag k;
+			bool last = (i + 1 == a->nkids);
+			uint32_t s = (last ? RE_NIL : node_new(prog, NFA_SPLIT, err));
+			if ((!last && s == RE_NIL) || !compile_ast(prog, a->kids[i], rev, &k, err))
+				return false;
+			f->outs = append(prog, f->outs, k.outs);
+
+			uint32_t entry = (last ? k.start : s);
+			if (prev == RE_NIL)
+				f->start = entry;
+			else
+				prog->nodes[prev].out1 = entry;
+			if (!last)
+				prog->nodes[s].out = k.start;
+			prev = s;
+		}
+		return true;
+	}
+	case RE_REPEAT:
+		return compile_repeat(prog, a, rev, f, err);
+	}
+	return false;
+}
+
+
+static int prog_build(struct re_prog *prog, const struct re_ast *ast, bool rev)
+{
+	struct re_frag f;
+	int err = 0;
+
+	if (!compile_ast(prog, ast, rev, &f, &err))
+		return (err ? err : -EINVAL);
+
+	uint32_t m = node_new(prog, NFA_MATCH, &err);
+	if (m == RE_NIL)
+		return err;
+	patch(prog, f.outs, m);
+	prog->start = f.start;
+	return 0;
+}
+
+
+/*	LITERAL PREFILTER	*/
+
+/*
+ * A byte set that stands for exactly one byte, ignoring case if @icase.
+ * Stores that byte in *c.
+ */
+static bool set_is_literal(const uint64_t *set, bool icase, unsigned char *c)
+{
+	int count = 0;
+
+	for (unsigned int b = 0; b < 256; b++) {
+		if (set_has(set, (unsigned char)b) && !count++)
+			*c = (unsigned char)b;
+	}
+
+	// Under STR_ICASE a letter comes with its other case
+	if (count == 2 && icase && *c >= 'A' && *c <= 'Z')
+		return set_has(set, (unsigned char)(*c | 0x20));
+	return count == 1 && *c;	// the literal ends up in a C string
+}
+
+
+/*
+ * Longest run of single byte sets in the top level concatenation: every
+ * match contains it. *prefix tells whether every match also starts with
+ * it. Writes at most @max bytes to @buf and returns the length.
+ */
+static size_t required_literal(const struct re_ast *a, bool icase, char *buf,
+			       size_t max, bool *prefix)
+{
+	size_t best = 0;
+	size_t best_at = 0;
+	size_t run = 0;
+	size_t run_at = 0;
+	char tmp[64];
+
+	*prefix = false;
+	if (a->op != RE_CAT)
+		return 0;
+	if (max > sizeof(tmp))
+		max = sizeof(tmp);
+
+	for (size_t i = 0; i <= a->nkids; i++) {
+		unsigned char c = 0;
+		if (i < a->nkids && a->kids[i]->op == RE_SET &&
+		    set_is_literal(a->kids[i]->set, icase, &c) && run < max) {
+			if (!run)
+				run_at = i;
+			tmp[run++] = (char)c;
+			continue;
+		}
+		if (run > best) {
+			best = run;
+			best_at = run_at;
+			memcpy(buf, tmp, run);
+		}
+		run = 0;
+	}
+
+	*prefix = (best && best_at == 0);
+	return best;
+}
+
+
+/*	LAZY DFA	*/
+
+// DFA state flags
+#define DS_MATCH	0x01u	/* a match ends here */
+#define DS_MATCH_END	0x02u	/* a match ends here if this is the text end */
+#define DS_UNANCHORED	0x04u	/* a new match may start at every byte */
+#define DS_DEAD		0x08u	/* no match can come out of this state */
+#define DS_START	0x10u	/* unanchored start state, nothing under way */
+#define DS_MATCH_EMPTY	0x20u	/* a match ends here if the text is empty */
+
+
+/*
+ * Cached states of one direction. A state is identified by its flags
+ * (only DS_UNANCHORED matters) and the sorted list of its NFA nodes that
+ * either consume a byte, match, or wait for the end of the text.
+ */
+struct re_dfa {
+	const struct re_prog *prog;
+	size_t	nstates;
+	size_t	cap;		/* grows up to RE_CACHE_STATES */
+	/*
+	 * Rows of 1 << Str_regex.shift transitions per state. An entry is the
+	 * row offset of the target, with RE_TAG set if the scan has to stop
+	 * there (see Str_regex.special), or RE_UNKNOWN.
+	 */
+	uint32_t *trans;
+	uint8_t	*flags;
+	uint32_t *set_off;
+	uint32_t *set_len;
+	uint32_t *pool;
+	size_t	pool_size;
+	size_t	pool_cap;
+	uint32_t *table;	/* hash of the sets -> state + 1 */
+	size_t	table_size;
+};
+
+
+struct Str_regex {
+	pthread_mutex_t lock;	/* guards the DFA caches and scratch space */
+	size_t	nclasses;
+	uint8_t	classes[256];
+	unsigned int shift;	/* log2 of the transition row length */
+	unsigned int special;	/* state flags that end a fast scan */
+	struct re_prog fwd;
+	struct re_prog rev;
+	struct re_dfa dfa_fwd;
+	struct re_dfa dfa_rev;
+	// Scratch for the closure, sized for the larger program
+	uint32_t *stack;
+	uint32_t *mark;		/* node visited when equal to stamp */
+	size_t	nmark;
+	uint32_t stamp;
+	uint32_t *list;
+	uint32_t *list2;
+	// Literal prefilter
+	struct Str_pattern *literal;
+	bool	literal_prefix;
+	bool	anchored;	/* pattern starts with ^ */
+	/*
+	 * Bytes that leave the unanchored start state. While no match is under
+	 * way the forward scan jumps to the next of them (or, with a literal
+	 * prefix, to the next copy of the literal) instead of stepping.
+	 */
+	bool	skip;
+	bool	escape[256];
+	unsigned char esc_set[STR_SMALL_SET_MAX];
+	size_t	nesc;
+};
+
+
+static uint32_t set_hash(const uint32_t *s, size_t n, unsigned int flags)
+{
+	uint64_t h = 0xcbf29ce484222325ull ^ flags;
+
+	for (size_t i = 0; i < n; i++) {
+		h ^= s[i];
+		h *= 0x100000001b3ull;
+	}
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+
+/*
+ * Add the epsilon closure of node @n to re->list (length *len). @at_begin
+ * and @at_end tell whether ^ and $ hold here.
+ */
+static void closure(struct Str_regex *re, const struct re_prog *prog, uint32_t n,
+		    bool at_begin, bool at_end, uint32_t *list, size_t *len)
+{
+	size_t sp = 0;
+
+	re->stack[sp++] = n;
+	while (sp) {
+		n = re->stack[--sp];
+		if (n == RE_NIL || re->mark[n] == re->stamp)
+			continue;
+		re->mark[n] = re->stamp;
+
+		const struct re_node *nd = &prog->nodes[n];
+		switch (nd->op) {
+		case NFA_SPLIT:
+			re->stack[sp++] = nd->out1;
+			re->stack[sp++] = nd->out;
+			break;
+		case NFA_NOP:
+			re->stack[sp++] = nd->out;
+			break;
+		case NFA_BEGIN:
+			if (at_begin)
+				re->stack[sp++] = nd->out;
+			break;
+		case NFA_END:
+			if (at_end)
+				re->stack[sp++] = nd->out;
+			else
+				list[(*len)++] = n;	// may still hold later
+			break;
+		default:
+			list[(*len)++] = n;
+			break;
+		}
+	}
+}
+
+
+static void next_stamp(struct Str_regex *re)
+{
+	if (++re->stamp == 0) {
+		memset(re->mark, 0, re->nmark * sizeof(uint32_t));
+		re->stamp = 1;
+	}
+}
+
+
+static void dfa_flush(struct re_dfa *dfa)
+{
+	dfa->nstates = 0;
+	dfa->pool_size = 0;
+	memset(dfa->table, 0, dfa->table_size * sizeof(uint32_t));
+}
+
+
+static bool dfa_grow(struct re_dfa *dfa, unsigned int shift)
+{
+	size_t cap = (dfa->cap ? dfa->cap * 2 : 64);
+	uint32_t *trans = (uint32_t *)realloc(dfa->trans, (cap << shift) * sizeof(uint32_t));
+	if (!trans)
+		return false;
+	dfa->trans = trans;
+
+	uint8_t *flags = (uint8_t *)realloc(dfa->flags, cap);
+	if (!flags)
+		return false;
+	dfa->flags = flags;
+
+	uint32_t *off = (uint32_t *)realloc(dfa->set_off, cap * sizeof(uint32_t));
+	if (!off)
+		return false;
+	dfa->set_off = off;
+
+	uint32_t *len = (uint32_t *)realloc(dfa->set_len, cap * sizeof(uint32_t));
+	if (!len)
+		return false;
+	dfa->set_len = len;
+
+	dfa->cap = cap;
+	return true;
+}
+
+
+/*
+ * Look up or add the state for the node list @s (sorted here). When the
+ * cache is full it is flushed first, which invalidates all other state
+ * numbers. Returns RE_NIL only when out of memory.
+ */
+static uint32_t dfa_state(struct Str_regex *re, struct re_dfa *dfa, uint32_t *s,
+			  size_t n, unsigned int unanchored)
+{
+	const struct re_prog *prog = dfa->prog;
+
+	qsort(s, n, sizeof(uint32_t), cmp_u32);
+
+	uint32_t h = set_hash(s, n, unanchored) & (uint32_t)(dfa->table_size - 1);
+	for (;; h = (h + 1) & (uint32_t)(dfa->table_size - 1)) {
+		uint32_t v = dfa->table[h];
+		if (!v)
+			break;
+		v--;
+		if ((dfa->flags[v] & DS_UNANCHORED) == unanchored && dfa->set_len[v] == n &&
+		    !memcmp(dfa->pool + dfa->set_off[v], s, n * sizeof(uint32_t)))
+			return v;
+	}
+
+	if (dfa->nstates == RE_CACHE_STATES) {
+		dfa_flush(dfa);
+		h = set_hash(s, n, unanchored) & (uint32_t)(dfa->table_size - 1);
+	} else if (dfa->nstates == dfa->cap && !dfa_grow(dfa, re->shift)) {
+		return RE_NIL;
+	}
+	if (dfa->pool_size + n > dfa->pool_cap) {
+		size_t cap = dfa->pool_cap * 2;
+		while (cap < dfa->pool_size + n)
+			cap *= 2;
+		uint32_t *pool = (uint32_t *)realloc(dfa->pool, cap * sizeof(uint32_t));
+		if (!pool)
+			return RE_NIL;
+		dfa->pool = pool;
+		dfa->pool_cap = cap;
+	}
+
+	uint32_t v = (uint32_t)dfa->nstates++;
+	memcpy(dfa->pool + dfa->pool_size, s, n * sizeof(uint32_t));
+	dfa->set_off[v] = (uint32_t)dfa->pool_size;
+	dfa->set_len[v] = (uint32_t)n;
+	dfa->pool_size += n;
+	for (size_t c = 0; c < re->nclasses; c++)
+		dfa->trans[((size_t)v << re->shift) + c] = RE_UNKNOWN;
+
+	/*
+	 * Match flags: directly, or through the pending $ nodes at the end.
+	 * A ^ behind them only holds if the end is also the start.
+	 */
+	unsigned int flags = unanchored;
+	for (int empty = 0; empty < 2; empty++) {
+		const unsigned int end_flag = (empty ? DS_MATCH_EMPTY : DS_MATCH_END);
+		size_t end_len = 0;
+		next_stamp(re);
+		for (size_t i = 0; i < n; i++) {
+			const struct re_node *nd = &prog->nodes[s[i]];
+			if (nd->op == NFA_MATCH)
+				flags |= DS_MATCH | end_flag;
+			else if (nd->op == NFA_END)
+				closure(re, prog, nd->out, empty, true, re->list2, &end_len);
+		}
+		for (size_t i = 0; i < end_len; i++) {
+			if (prog->nodes[re->list2[i]].op == NFA_MATCH)
+				flags |= end_flag;
+		}
+	}
+	if (!n && !unanchored)
+		flags |= DS_DEAD;
+
+	dfa->flags[v] = (uint8_t)flags;
+	dfa->table[h] = v + 1;
+	return v;
+}
+
+
+// Start state at a position where ^ does (@at_begin) or does not hold
+static uint32_t dfa_start(struct Str_regex *re, struct re_dfa *dfa, bool at_begin,
+			  unsigned int unanchored)
+{
+	size_t len = 0;
+
+	next_stamp(re);
+	closure(re, dfa->prog, dfa->prog->start, at_begin, false, re->list, &len);
+
+	uint32_t s = dfa_state(re, dfa, re->list, len, unanchored);
+	if (s != RE_NIL && unanchored && !at_begin)
+		dfa->flags[s] |= DS_START;
+	return s;
+}
+
+
+// The same NFA set without the unanchored start loop
+static uint32_t dfa_cut(struct Str_regex *re, struct re_dfa *dfa, uint32_t s)
+{
+	size_t n = dfa->set_len[s];
+
+	memcpy(re->list, dfa->pool + dfa->set_off[s], n * sizeof(uint32_t));
+	return dfa_state(re, dfa, re->list, n, 0);
+}
+
+
+// Compute and cache the transition of state @s on byte class @c
+static uint32_t dfa_step_slow(struct Str_regex *re, struct re_dfa *dfa, uint32_t s,
+			      size_t c)
+{
+	const struct re_prog *prog = dfa->prog;
+	const uint32_t *set = dfa->pool + dfa->set_off[s];
+	const size_t n = dfa->set_len[s];
+	unsigned int unanchored = dfa->flags[s] & DS_UNANCHORED;
+	size_t len = 0;
+
+	next_stamp(re);
+	for (size_t i = 0; i < n; i++) {
+		const struct re_node *nd = &prog->nodes[set[i]];
+		if (nd->op == NFA_BYTE && set_has(prog->sets[nd->set], (unsigned char)c))
+			closure(re, prog, nd->out, false, false, re->list, &len);
+	}
+	if (unanchored)
+		closure(re, prog, prog->start, false, false, re->list, &len);
+
+	size_t before = dfa->nstates;
+	uint32_t t = dfa_state(re, dfa, re->list, len, unanchored);
+	// Only cache the edge if @s survived (no flush in between)
+	if (t != RE_NIL && dfa->nstates >= before) {
+		dfa->trans[((size_t)s << re->shift) + c] = (t << re->shift) |
+			((dfa->flags[t] & re->special) ? RE_TAG : 0);
+	}
+	return t;
+}
+
+
+/*
+ * Step from state *s over h[i], h[i + 1], ... up to @end, until a state
+ * with a special flag (match, dead, skip) or an uncached transition comes
+ * up. Updates *s and returns the position reached.
+ */
+static inline size_t dfa_run(struct Str_regex *re, struct re_dfa *dfa, uint32_t *s,
+			     const unsigned char *h, size_t i, size_t end)
+{
+	const uint32_t *trans = dfa->trans;
+	const unsigned int shift = re->shift;
+	uint32_t row = *s << shift;
+
+	while (i < end) {
+		uint32_t t = trans[row + re->classes[h[i]]];
+		if (t & RE_TAG) {
+			*s = (t != RE_UNKNOWN ? (t & ~RE_TAG) >> shift :
+			      dfa_step_slow(re, dfa, row >> shift, re->classes[h[i]]));
+			return i + 1;
+		}
+		row = t;
+		i++;
+	}
+	*s = row >> shift;
+	return i;
+}
+
+
+// dfa_run() backwards, over h[i - 1], h[i - 2], ... down to h[end]
+static inline size_t dfa_run_rev(struct Str_regex *re, struct re_dfa *dfa, uint32_t *s,
+				 const unsigned char *h, size_t i, size_t end)
+{
+	const uint32_t *trans = dfa->trans;
+	const unsigned int shift = re->shift;
+	uint32_t row = *s << shift;
+
+	while (i > end) {
+		uint32_t t = trans[row + re->classes[h[i - 1]]];
+		if (t & RE_TAG) {
+			*s = (t != RE_UNKNOWN ? (t & ~RE_TAG) >> shift :
+			      dfa_step_slow(re, dfa, row >> shift, re->classes[h[i - 1]]));
+			return i - 1;
+		}
+		row = t;
+		i--;
+	}
+	*s = row >> shift;
+	return i;
+}
+
+
+static bool dfa_init(struct re_dfa *dfa, const struct re_prog *prog, unsigned int shift)
+{
+	dfa->prog = prog;
+	dfa->table_size = 2 * RE_CACHE_STATES;
+	dfa->table = (uint32_t *)calloc(dfa->table_size, sizeof(uint32_t));
+	// Never NULL, not even while every state has an empty node list
+	dfa->pool_cap = 1024;
+	dfa->pool = (uint32_t *)malloc(dfa->pool_cap * sizeof(uint32_t));
+	return dfa->table && dfa->pool && dfa_grow(dfa, shift);
+}
+
+
+static void dfa_destroy(struct re_dfa *dfa)
+{
+	free(dfa->trans);
+	free(dfa->flags);
+	free(dfa->set_off);
+	free(dfa->set_len);
+	free(dfa->pool);
+	free(dfa->table);
+}
+
+
+/*	COMPILE	*/
+
+/*
+ * Byte classes: bytes no set tells apart share a class. Afterwards every
+ * byte set of both programs is rewritten as a set of class numbers.
+ */
+static void regex_classes(struct Str_regex *re)
+{
+	memset(re->classes, 0, sizeof(re->classes));
+	re->nclasses = 1;
+
+	for (size_t i = 0; i < re->fwd.nsets; i++) {
+		int16_t remap[2][256];
+		size_t next = 0;
+		memset(remap, 0xff, sizeof(remap));
+		for (unsigned int c = 0; c < 256; c++) {
+			int in = set_has(re->fwd.sets[i], (unsigned char)c);
+			int16_t *slot = &remap[in][re->classes[c]];
+			if (*slot < 0)
+				*slot = (int16_t)next++;
+			re->classes[c] = (uint8_t)*slot;
+		}
+		re->nclasses = next;
+	}
+	while (((size_t)1 << re->shift) < re->nclasses)
+		re->shift++;
+
+	struct re_prog *progs[2] = { &re->fwd, &re->rev };
+	for (int p = 0; p < 2; p++) {
+		for (size_t i = 0; i < progs[p]->nsets; i++) {
+			uint64_t cls[4] = { 0 };
+			for (unsigned int c = 0; c < 256; c++) {
+				if (set_has(progs[p]->sets[i], (unsigned char)c))
+					set_add(cls, re->classes[c]);
+			}
+			memcpy(progs[p]->sets[i], cls, sizeof(cls));
+		}
+	}
+}
+
+
+/*
+ * Fill in re->escape from the transitions of the unanchored start state,
+ * and turn skipping on if it pays off: with a literal prefix, or when
+ * less than half of all bytes leave the state. Patterns that match the
+ * empty string never skip.
+ */
+static void regex_start_escape(struct Str_regex *re)
+{
+	struct re_dfa *dfa = &re->dfa_fwd;
+	uint32_t s = dfa_start(re, dfa, false, DS_UNANCHORED);
+	bool leaves[256];
+	size_t count = 0;
+
+	// An empty match could be at every byte: nothing to skip
+	if (s == RE_NIL || (dfa->flags[s] & DS_MATCH))
+		return;
+	for (size_t c = 0; c < re->nclasses; c++) {
+		uint32_t t = dfa_step_slow(re, dfa, s, c);
+		if (t == RE_NIL)
+			return;
+		leaves[c] = (t != s);
+	}
+
+	for (unsigned int b = 0; b < 256; b++) {
+		re->escape[b] = leaves[re->classes[b]];
+		if (re->escape[b] && count++ < STR_SMALL_SET_MAX)
+			re->esc_set[count - 1] = (unsigned char)b;
+	}
+	re->nesc = count;
+	re->skip = (re->literal_prefix || count < 128);
+	if (re->skip) {
+		re->special |= DS_START;
+		dfa_flush(dfa);		// drop the edges cached before the tag
+	}
+}
+
+
+void str_regex_free(struct Str_regex *re)
+{
+	if (!re)
+		return;
+
+	pthread_mutex_destroy(&re->lock);
+	free(re->fwd.nodes);
+	free(re->fwd.sets);
+	free(re->rev.nodes);
+	free(re->rev.sets);
+	dfa_destroy(&re->dfa_fwd);
+	dfa_destroy(&re->dfa_rev);
+	free(re->stack);
+	free(re->mark);
+	free(re->list);
+	free(re->list2);
+	str_pattern_free(re->literal);
+	free(re);
+}
+
+
+struct Str_regex *str_regex_compile(const char *pattern, unsigned int flags)
+{
+	if (!pattern || (flags & ~STR_REGEX_FLAGS)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct re_parser ps = { pattern, (flags & STR_ICASE) != 0, 0, 0 };
+	struct re_ast *ast = parse_alt(&ps);
+	if (ast && *ps.p) {		// a ')' without '('
+		ast_free(ast);
+		ast = NULL;
+		ps.err = -EINVAL;
+	}
+	if (!ast) {
+		errno = (ps.err ? -ps.err : EINVAL);
+		return NULL;
+	}
+
+	struct Str_regex *re = (struct Str_regex *)calloc(1, sizeof(struct Str_regex));
+	if (!re) {
+		ast_free(ast);
+		return NULL;
+	}
+	pthread_mutex_init(&re->lock, NULL);
+
+	int err = prog_build(&re->fwd, ast, false);
+	if (!err)
+		err = prog_build(&re->rev, ast, true);
+	if (err)
+		goto fail;
+
+	char lit[64];
+	bool prefix;
+	size_t lit_len = required_literal(ast, ps.icase, lit, sizeof(lit) - 1, &prefix);
+	re->anchored = (ast->op == RE_CAT && ast->nkids && ast->kids[0]->op == RE_BEGIN);
+	if (lit_len >= 2 || (lit_len == 1 && prefix)) {
+		lit[lit_len] = '\0';
+		re->literal = str_pattern_compile(lit, flags & STR_ICASE);
+		re->literal_prefix = prefix;
+		if (!re->literal) {
+			err = -ENOMEM;
+			goto fail;
+		}
+	}
+	ast_free(ast);
+	ast = NULL;
+
+	re->special = DS_MATCH | DS_DEAD;
+	regex_classes(re);
+
+	size_t nodes = (re->fwd.nnodes > re->rev.nnodes ? re->fwd.nnodes : re->rev.nnodes);
+	re->stack = (uint32_t *)malloc(2 * nodes * sizeof(uint32_t) + 2);
+	re->mark = (uint32_t *)calloc(nodes, sizeof(uint32_t));
+	re->nmark = nodes;
+	re->list = (uint32_t *)malloc(nodes * sizeof(uint32_t) + 1);
+	re->list2 = (uint32_t *)malloc(nodes * sizeof(uint32_t) + 1);
+	re->stamp = 1;
+	if (!re->stack || !re->mark || !re->list || !re->list2 ||
+	    !dfa_init(&re->dfa_fwd, &re->fwd, re->shift) ||
+	    !dfa_init(&re->dfa_rev, &re->rev, re->shift)) {
+		err = -ENOMEM;
+		goto fail;
+	}
+	if (!re->anchored)
+		regex_start_escape(re);
+	return re;
+
+fail:
+	ast_free(ast);
+	str_regex_free(re);
+	errno = -err;
+	return NULL;
+}
+
+
+/*	SEARCH	*/
+
+// Match at @pos of a @size byte text in state flags @f?
+static inline bool accepts(unsigned int f, size_t pos, size_t size)
+{
+	return (f & DS_MATCH) ||
+	       (pos == size && (f & (size ? DS_MATCH_END : DS_MATCH_EMPTY)));
+}
+
+
+/*
+ * Forward anchored scan from @from: end of the longest match starting
+ * there, or STR_NPOS. The caller holds re->lock.
+ */
+static size_t scan_longest(struct Str_regex *re, const unsigned char *h, size_t size,
+			   size_t from)
+{
+	struct re_dfa *dfa = &re->dfa_fwd;
+	uint32_t s = dfa_start(re, dfa, from == 0, 0);
+	size_t last = STR_NPOS;
+
+	for (size_t i = from;;) {
+		if (s == RE_NIL)
+			return STR_NPOS;
+		unsigned int f = dfa->flags[s];
+		if (accepts(f, i, size))
+			last = i;
+		if (i == size || (f & DS_DEAD))
+			break;
+		i = dfa_run(re, dfa, &s, h, i, size);
+	}
+	return last;
+}
+
+
+/*
+ * Next position from @i on where the unanchored start state can be left,
+ * or STR_NPOS if a required literal prefix does not occur any more.
+ */
+static size_t regex_skip(const struct Str_regex *re, const unsigned char *h,
+			 size_t size, size_t i)
+{
+	if (re->literal_prefix)
+		return str_pattern_find_from(re->literal, (const char *)h, size, i);
+
+	if (re->nesc <= STR_SMALL_SET_MAX) {
+		size_t pos = STR_NPOS;
+		if (re->nesc)
+			pos = str_kernels_get()->find_bytes(h, size, i, re->esc_set, re->nesc);
+		return (pos == STR_NPOS ? size : pos);
+	}
+
+	const bool *esc = re->escape;
+	while (i + 4 <= size && !(esc[h[i]] | esc[h[i + 1]] | esc[h[i + 2]] | esc[h[i + 3]]))
+		i += 4;
+	while (i < size && !esc[h[i]])
+		i++;
+	return i;
+}
+
+
+/*
+ * Leftmost-longest match at or after @from, as [*mstart, *mend). The
+ * caller holds re->lock. Three passes, each linear in what it reads:
+ *
+ * 1. Forward, unanchored, to the end e1 of the earliest ending match.
+ *    No match can start after e1, so new starts are cut there, and the
+ *    scan goes on until the remaining threads die; every match that
+ *    starts at or before e1 ends by the last match end seen, e2.
+ * 2. Backward over [from, e2) with the reversed program, unanchored at
+ *    ends in [e1, e2]: the lowest position where it accepts is the
+ *    leftmost start.
+ * 3. Forward, anchored at that start, for the longest match.
+ */
+static bool regex_search_locked(struct Str_regex *re, const unsigned char *h,
+				size_t size, size_t from, size_t *mstart, size_t *mend)
+{
+	struct re_dfa *fwd = &re->dfa_fwd;
+	struct re_dfa *rev = &re->dfa_rev;
+
+	if (re->anchored && from > 0)
+		return false;
+
+	/*
+	 * 1. With a literal every match starts with, the scan skips from the
+	 * start state straight to the next copy of the literal.
+	 */
+	bool skip = re->skip;
+	if (skip)
+		dfa_start(re, fwd, false, DS_UNANCHORED);	// tags the state
+	uint32_t s = dfa_start(re, fwd, from == 0, (re->anchored ? 0 : DS_UNANCHORED));
+	size_t e1 = STR_NPOS;
+	size_t e2 = STR_NPOS;
+	for (size_t i = from;;) {
+		if (s == RE_NIL)
+			return false;
+		unsigned int f = fwd->flags[s];
+		if (skip && (f & DS_START)) {
+			i = regex_skip(re, h, size, i);
+			if (i == STR_NPOS)
+				return false;
+		}
+		if (accepts(f, i, size)) {
+			if (e1 == STR_NPOS) {
+				e1 = i;
+				s = dfa_cut(re, fwd, s);
+				if (s == RE_NIL)
+					return false;
+				f = fwd->flags[s];
+			}
+			e2 = i;
+		}
+		if (i == size || (f & DS_DEAD))
+			break;
+		i = dfa_run(re, fwd, &s, h, i, size);
+	}
+	if (e1 == STR_NPOS)
+		return false;
+
+	// 2.
+	size_t start = e1;
+	s = dfa_start(re, rev, e2 == size, (e2 > e1 ? DS_UNANCHORED : 0));
+	for (size_t i = e2;;) {
+		if (s == RE_NIL)
+			return false;
+		if (i == e1 && (rev->flags[s] & DS_UNANCHORED)) {
+			s = dfa_cut(re, rev, s);
+			if (s == RE_NIL)
+				return false;
+		}
+		unsigned int f = rev->flags[s];
+		if (accepts(f, size - i, size))	// the text end is 0 here
+			start = i;
+		if (i == from || (f & DS_DEAD))
+			break;
+		i = dfa_run_rev(re, rev, &s, h, i, (i > e1 ? e1 : from));
+	}
+
+	// 3.
+	size_t end = scan_longest(re, h, size, start);
+	if (end == STR_NPOS)
+		return false;
+
+	*mstart = start;
+	*mend = end;
+	return true;
+}
+
+
+/*
+ * Where a search from @from can begin: with a literal that every match
+ * contains, STR_NPOS if it is missing, and its position if every match
+ * starts with it.
+ */
+static size_t regex_prefilter(const struct Str_regex *re, const char *h, size_t size,
+			      size_t from)
+{
+	if (!re->literal)
+		return from;
+
+	size_t pos = str_pattern_find_from(re->literal, h, size, from);
+	if (pos == STR_NPOS || !re->literal_prefix)
+		return (pos == STR_NPOS ? pos : from);
+	return pos;
+}
+
+
+static bool regex_search(struct Str_regex *re, const char *h, size_t size,
+			 size_t from, size_t *mstart, size_t *mend)
+{
+	bool ret = false;
+
+	from = regex_prefilter(re, h, size, from);
+	if (from == STR_NPOS)
+		return false;
+
+	pthread_mutex_lock(&re->lock);
+	ret = regex_search_locked(re, (const unsigned char *)h, size, from, mstart, mend);
+	pthread_mutex_unlock(&re->lock);
+	return ret;
+}
+
+
+bool str_match(struct Str *self, const struct Str_regex *regex)
+{
+	if (!self || !regex)
+		return false;
+
+	struct Str_regex *re = (struct Str_regex *)regex;
+
+	pthread_mutex_lock(&self->lock);
+	const unsigned char *h = (const unsigned char *)(self->data ? self->data : "");
+	size_t size = (self->data ? self->size : 0);
+
+	pthread_mutex_lock(&re->lock);
+	bool ret = (scan_longest(re, h, size, 0) == size);
+	pthread_mutex_unlock(&re->lock);
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+size_t str_search(struct Str *self, const struct Str_regex *regex, size_t start,
+		  size_t *match_len)
+{
+	if (!self || !regex)
+		return STR_NPOS;
+
+	pthread_mutex_lock(&self->lock);
+	const char *h = (self->data ? self->data : "");
+	size_t size = (self->data ? self->size : 0);
+	size_t ms = STR_NPOS;
+	size_t me = 0;
+
+	if (start <= size && !regex_search((struct Str_regex *)regex, h, size, start, &ms, &me))
+		ms = STR_NPOS;
+
+	pthread_mutex_unlock(&self->lock);
+	if (ms != STR_NPOS && match_len)
+		*match_len = me - ms;
+	return ms;
+}
+
+
+int str_replace_regex(struct Str *self, const struct Str_regex *regex, const char *to)
+{
+	if (!self) {
+		return -1;
+	} else if (!regex || !to) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	/*
+	 * Collect the matches, then size the result exactly and write it in
+	 * one pass. After an empty match the next search starts one byte
+	 * later, so "x*" puts @to between all bytes that are not 'x'.
+	 */
+	struct Str_regex *re = (struct Str_regex *)regex;
+	const char *h = self->data;
+	const size_t size = self->size;
+	const size_t to_size = strlen(to);
+	size_t (*m)[2] = NULL;
+	size_t count = 0;
+	size_t cap = 0;
+	size_t removed = 0;
+	size_t from = 0;
+	size_t ms;
+	size_t me;
+
+	while (from <= size && regex_search(re, h, size, from, &ms, &me)) {
+		if (count == cap) {
+			size_t new_cap = (cap ? cap * 2 : 16);
+			size_t (*tmp)[2] = (size_t (*)[2])realloc(m, new_cap * sizeof(*m));
+			if (!tmp) {
+				free(m);
+				pthread_mutex_unlock(&self->lock);
+				return -ENOMEM;
+			}
+			m = tmp;
+			cap = new_cap;
+		}
+		m[count][0] = ms;
+		m[count][1] = me;
+		count++;
+		removed += me - ms;
+		from = (me > ms ? me : me + 1);
+	}
+
+	if (!count) {
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+	if (to_size && count > (MAX_STRING_SIZE - size + removed) / to_size) {
+		free(m);
+		pthread_mutex_unlock(&self->lock);
+		return -E2BIG;
+	}
+
+	size_t new_size = size - removed + count * to_size;
+	char *buf = (char *)malloc(new_size + 1);
+	if (!buf) {
+		free(m);
+		pthread_mutex_unlock(&self->lock);
+		return -ENOMEM;
+	}
+
+	char *wr = buf;
+	size_t rd = 0;
+	for (size_t i = 0; i < count; i++) {
+		memcpy(wr, h + rd, m[i][0] - rd);
+		wr += m[i][0] - rd;
+		memcpy(wr, to, to_size);
+		wr += to_size;
+		rd = m[i][1];
+	}
+	memcpy(wr, h + rd, size - rd + 1);
+
+	free(m);
+	free(self->data);
+	self->data = buf;
+	self->size = new_size;
+	self->capacity = new_size;
+
+	pthread_mutex_unlock(&self->lock);
+	return (count > INT_MAX ? INT_MAX : (int)count);
+}
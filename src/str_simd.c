@@ -0,0 +1,2598 @@
+#include "str_simd.h"
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef STR_HAVE_X86_SIMD
+  #include <immintrin.h>
+#endif
+
+
+/*
+ * The first/last byte filter verifies every candidate with memcmp. On
+ * adversarial inputs (long runs of the needle's own bytes) that turns
+ * quadratic, so the kernels keep count of the bytes spent verifying and
+ * hand over to Two-Way once that exceeds a small multiple of the distance
+ * already scanned.
+ */
+#define FIND_WORK_LIMIT(pos)	(((pos) << 2) + 512)
+
+
+#define STR_INLINE	static inline __attribute__((always_inline))
+
+
+const unsigned char str_fold_table[256] = {
+#define F4(c)	(c), (c) + 1, (c) + 2, (c) + 3
+#define F16(c)	F4(c), F4((c) + 4), F4((c) + 8), F4((c) + 12)
+	F16(0x00), F16(0x10), F16(0x20), F16(0x30),
+	// '@', then 'A'..'Z' -> 'a'..'z'
+	0x40, F4(0x61), F4(0x65), F4(0x69), F4(0x6d), F4(0x71), F4(0x75), 0x79,
+	0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	F16(0x60), F16(0x70), F16(0x80), F16(0x90), F16(0xa0), F16(0xb0),
+	F16(0xc0), F16(0xd0), F16(0xe0), F16(0xf0)
+#undef F16
+#undef F4
+};
+
+
+/*
+ * ASCII bytes other than letters, digits, '_' and the apostrophe, so
+ * "don't" stays one word.
+ */
+const struct Str_charset str_title_boundaries = {
+	{ 0xfc00ff7fffffffffull, 0xf800000178000001ull, 0, 0 }
+};
+
+
+/*	TWO-WAY	*/
+
+/*
+ * With icase both algorithms run on the case folded alphabet: every byte
+ * of the needle and of the haystack goes through str_fold() before it is
+ * compared or used as a shift table index.
+ */
+#define TW_BYTE(c)	(icase ? str_fold(c) : (c))
+
+void str_twoway_prepare(struct str_twoway *tw, const unsigned char *n,
+			size_t l, bool icase)
+{
+	size_t ip, jp, k, p, ms, p0;
+
+	memset(tw->shift, 0, sizeof(tw->shift));
+	for (size_t i = 0; i < l; i++)
+		tw->shift[TW_BYTE(n[i])] = i + 1;
+
+	// Maximal suffix for <
+	ip = (size_t)-1; jp = 0; k = p = 1;
+	while (jp + k < l) {
+		if (TW_BYTE(n[ip + k]) == TW_BYTE(n[jp + k])) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else {
+				k++;
+			}
+		} else if (TW_BYTE(n[ip + k]) > TW_BYTE(n[jp + k])) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	ms = ip;
+	p0 = p;
+
+	// And for >, the critical factorization is the longer of the two
+	ip = (size_t)-1; jp = 0; k = p = 1;
+	while (jp + k < l) {
+		if (TW_BYTE(n[ip + k]) == TW_BYTE(n[jp + k])) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else {
+				k++;
+			}
+		} else if (TW_BYTE(n[ip + k]) < TW_BYTE(n[jp + k])) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	if (ip + 1 > ms + 1)
+		ms = ip;
+	else
+		p = p0;
+
+	if (icase ? !str_icase_eq(n, n + p, ms + 1) : memcmp(n, n + p, ms + 1) != 0) {
+		tw->mem0 = 0;
+		p = ((ms > l - ms - 1) ? ms : l - ms - 1) + 1;
+	} else {
+		tw->mem0 = l - p;
+	}
+
+	tw->ms = ms;
+	tw->period = p;
+	tw->icase = icase;
+}
+
+
+/*
+ * Byte @x of the window at @pos. Searching backwards runs the same
+ * algorithm over the haystack mirrored end to front.
+ */
+#define TW_HAY(x)	(rev ? h[hl - 1 - pos - (x)] : h[pos + (x)])
+
+STR_INLINE
+size_t twoway_search_impl(const struct str_twoway *tw,
+			  const unsigned char *h, size_t hl,
+			  const unsigned char *n, size_t l,
+			  const bool icase, const bool rev)
+{
+	const size_t ms = tw->ms;
+	size_t pos = 0;
+	size_t mem = 0;
+	size_t k;
+
+	while (hl - pos >= l) {
+		// Check last byte first; advance by shift on mismatch
+		k = l - tw->shift[TW_BYTE(TW_HAY(l - 1))];
+		if (k) {
+			if (k < mem)
+				k = mem;
+			pos += k;
+			mem = 0;
+			continue;
+		}
+
+		// Compare right half
+		for (k = (ms + 1 > mem ? ms + 1 : mem); k < l && TW_BYTE(n[k]) == TW_BYTE(TW_HAY(k)); k++)
+			;
+		if (k < l) {
+			pos += k - ms;
+			mem = 0;
+			continue;
+		}
+
+		// Compare left half
+		for (k = ms + 1; k > mem && TW_BYTE(n[k - 1]) == TW_BYTE(TW_HAY(k - 1)); k--)
+			;
+		if (k <= mem)
+			return pos;
+
+		pos += tw->period;
+		mem = tw->mem0;
+	}
+	return STR_NPOS;
+}
+
+
+size_t str_twoway_search(const struct str_twoway *tw,
+			 const unsigned char *h, size_t hl,
+			 const unsigned char *n, size_t l)
+{
+	if (tw->icase)
+		return twoway_search_impl(tw, h, hl, n, l, true, false);
+	return twoway_search_impl(tw, h, hl, n, l, false, false);
+}
+
+
+size_t str_twoway_rsearch(const struct str_twoway *tw,
+			  const unsigned char *h, size_t hl,
+			  const unsigned char *n, size_t l)
+{
+	if (tw->icase)
+		return twoway_search_impl(tw, h, hl, n, l, true, true);
+	return twoway_search_impl(tw, h, hl, n, l, false, true);
+}
+#undef TW_HAY
+#undef TW_BYTE
+
+
+/*	FIND KERNELS	*/
+
+/*
+ * All find kernels test the match offsets from @start to hl - nl of the
+ * whole haystack, so that whole word checks can look at the byte before
+ * @start. They report absolute offsets.
+ */
+
+/*
+ * Horspool on the compiled skip table. Like the filter kernels it only
+ * verifies when the window's last byte matches and bails out to Two-Way
+ * when that keeps failing.
+ */
+static size_t find_horspool(const unsigned char *h, size_t hl, size_t start,
+			    const struct Str_pattern *pat, size_t *bail)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const bool icase = pat->icase;
+	const unsigned char last = (icase ? str_fold(n[nl - 1]) : n[nl - 1]);
+	const size_t end = hl - nl;
+	size_t work = 0;
+	size_t i = start;
+
+	while (i <= end) {
+		unsigned char c = h[i + nl - 1];
+		if ((icase ? str_fold(c) : c) == last) {
+			if ((icase ? str_icase_eq(h + i, n, nl - 1) : !memcmp(h + i, n, nl - 1)) &&
+			    str_ww_ok(h, hl, i, pat))
+				return i;
+
+			work += nl;
+			if (work > FIND_WORK_LIMIT(i - start)) {
+				*bail = i + 1;
+				return STR_NPOS;
+			}
+		}
+		i += pat->skip[c];
+	}
+
+	*bail = STR_NPOS;
+	return STR_NPOS;
+}
+
+
+static size_t find_scalar(const unsigned char *h, size_t hl, size_t start,
+			  const struct Str_pattern *pat, size_t *bail)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t anchor = pat->anchor;
+	const unsigned char first = n[0];
+	const unsigned char last = n[anchor];
+	const size_t end = hl - nl;	// last possible match offset, if hl >= nl
+	size_t work = 0;
+	size_t i = start;
+
+	*bail = STR_NPOS;
+	if (hl < nl || start > end)	// tail left over by a vector kernel
+		return STR_NPOS;
+
+	/*
+	 * Horspool pays off when the last byte is a real filter; with a
+	 * needle like "aaaab" memchr on the anchor byte skips further.
+	 */
+	if (pat->compiled && anchor == nl - 1)
+		return find_horspool(h, hl, start, pat, bail);
+
+	if (pat->icase) {
+		const unsigned char ffirst = str_fold(first);
+		const unsigned char flast = str_fold(last);
+
+		for (; i <= end; i++) {
+			if (str_fold(h[i + anchor]) != flast || str_fold(h[i]) != ffirst)
+				continue;
+			if (str_icase_eq(h + i + 1, n + 1, nl - 1) && str_ww_ok(h, hl, i, pat))
+				return i;
+
+			work += nl;
+			if (work > FIND_WORK_LIMIT(i - start)) {
+				*bail = i + 1;
+				return STR_NPOS;
+			}
+		}
+		return STR_NPOS;
+	}
+
+	// memchr on the anchor byte, it is the rarer one when they differ
+	while (i <= end) {
+		const unsigned char *p = memchr(h + i + anchor, last, end - i + 1);
+		if (!p)
+			break;
+
+		i = (size_t)(p - h) - anchor;
+		if (h[i] == first) {
+			if (!memcmp(h + i + 1, n + 1, nl - 1) && str_ww_ok(h, hl, i, pat))
+				return i;
+
+			work += nl;
+			if (work > FIND_WORK_LIMIT(i - start)) {
+				*bail = i + 1;
+				return STR_NPOS;
+			}
+		}
+		i++;
+	}
+
+	return STR_NPOS;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Word byte masks for the whole word mode, see str_is_word_byte(). Ranges
+ * are tested unsigned: x - lo <= hi - lo, via min_epu8.
+ */
+STR_TARGET("sse2") STR_INLINE
+__m128i word_mask_sse2(__m128i x)
+{
+	__m128i d = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+	__m128i a = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	__m128i alpha = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(25)), a);
+	__m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+	__m128i high = _mm_cmplt_epi8(x, _mm_setzero_si128());
+
+	return _mm_or_si128(_mm_or_si128(digit, alpha), _mm_or_si128(under, high));
+}
+
+
+STR_TARGET("avx2") STR_INLINE
+__m256i word_mask_avx2(__m256i x)
+{
+	__m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+	__m256i a = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	__m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+	__m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(25)), a);
+	__m256i under = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+	__m256i high = _mm256_cmpgt_epi8(_mm256_setzero_si256(), x);
+
+	return _mm256_or_si256(_mm256_or_si256(digit, alpha), _mm256_or_si256(under, high));
+}
+
+
+/*
+ * Both vector kernels compare a block of candidate start positions against
+ * the needle's first byte and the block @anchor bytes further against the
+ * byte at that offset. Only positions where both agree are verified.
+ *
+ * In case insensitive mode the filter bytes are folded to lower case and
+ * the haystack bytes are OR-ed with 0x20 before the compare, but only for
+ * a filter byte that is a letter: 'a' then matches exactly 'a' and 'A',
+ * and no other byte, so this costs one OR per compare and no extra pass.
+ *
+ * In whole word mode the same pass also drops candidates that sit inside
+ * a word: the "byte before" mask is the block's own word mask shifted up
+ * one lane, with the top lane of the previous block carried in, and the
+ * "byte after" mask comes from one more load at +nl.
+ *
+ * The block loads stay inside the haystack; the remaining positions go to
+ * the next narrower kernel.
+ */
+static inline unsigned char fold_bit(unsigned char c)
+{
+	c = str_fold(c);
+	return (unsigned char)((c >= 'a' && c <= 'z') ? 0x20 : 0);
+}
+
+
+static inline bool verify(const unsigned char *h, const unsigned char *n,
+			  size_t size, const bool icase)
+{
+	return (icase ? str_icase_eq(h, n, size) : !memcmp(h, n, size));
+}
+
+
+STR_TARGET("sse2") STR_INLINE
+size_t find_sse2_impl(const unsigned char *h, size_t hl, size_t i,
+		      const struct Str_pattern *pat, size_t *bail,
+		      const bool ww, const bool icase)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t anchor = pat->anchor;
+	const size_t reach = (ww ? nl : nl - 1);
+	const size_t start = i;
+	const __m128i vfirst = _mm_set1_epi8((char)(icase ? str_fold(n[0]) : n[0]));
+	const __m128i vlast = _mm_set1_epi8((char)(icase ? str_fold(n[anchor]) : n[anchor]));
+	const __m128i mfirst = _mm_set1_epi8((char)fold_bit(n[0]));
+	const __m128i mlast = _mm_set1_epi8((char)fold_bit(n[anchor]));
+	unsigned int carry = (ww && i > 0 && str_is_word_byte(h[i - 1]));
+	size_t work = 0;
+
+	for (; i + reach + 16 <= hl; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(h + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(h + i + anchor));
+		__m128i fa = (icase ? _mm_or_si128(a, mfirst) : a);
+		__m128i fb = (icase ? _mm_or_si128(b, mlast) : b);
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(fa, vfirst), _mm_cmpeq_epi8(fb, vlast)));
+
+		if (ww) {
+			unsigned int word = (unsigned int)_mm_movemask_epi8(word_mask_sse2(a));
+			unsigned int before = ((word << 1) | carry) & 0xffffu;
+			carry = word >> 15;
+			if (pat->ww_left)
+				mask &= ~before;
+			if (pat->ww_right && mask) {
+				__m128i c = _mm_loadu_si128((const __m128i *)(h + i + nl));
+				mask &= ~(unsigned int)_mm_movemask_epi8(word_mask_sse2(c));
+			}
+		}
+
+		while (mask) {
+			size_t pos = i + (size_t)__builtin_ctz(mask);
+			if (verify(h + pos + 1, n + 1, nl - 1, icase))
+				return pos;
+			work += nl;
+			mask &= mask - 1;
+		}
+		if (work > FIND_WORK_LIMIT(i - start)) {
+			*bail = i + 16;
+			return STR_NPOS;
+		}
+	}
+
+	return find_scalar(h, hl, i, pat, bail);
+}
+
+
+STR_TARGET("sse2")
+static size_t find_sse2(const unsigned char *h, size_t hl, size_t start,
+			const struct Str_pattern *pat, size_t *bail)
+{
+	switch (pat->flags & (STR_WHOLE_WORD | STR_ICASE)) {
+	case STR_WHOLE_WORD | STR_ICASE:
+		return find_sse2_impl(h, hl, start, pat, bail, true, true);
+	case STR_WHOLE_WORD:
+		return find_sse2_impl(h, hl, start, pat, bail, true, false);
+	case STR_ICASE:
+		return find_sse2_impl(h, hl, start, pat, bail, false, true);
+	default:
+		return find_sse2_impl(h, hl, start, pat, bail, false, false);
+	}
+}
+
+
+STR_TARGET("avx2") STR_INLINE
+size_t find_avx2_impl(const unsigned char *h, size_t hl, size_t i,
+		      const struct Str_pattern *pat, size_t *bail,
+		      const bool ww, const bool icase)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t anchor = pat->anchor;
+	const size_t reach = (ww ? nl : nl - 1);
+	const size_t start = i;
+	const __m256i vfirst = _mm256_set1_epi8((char)(icase ? str_fold(n[0]) : n[0]));
+	const __m256i vlast = _mm256_set1_epi8((char)(icase ? str_fold(n[anchor]) : n[anchor]));
+	const __m256i mfirst = _mm256_set1_epi8((char)fold_bit(n[0]));
+	const __m256i mlast = _mm256_set1_epi8((char)fold_bit(n[anchor]));
+	unsigned int carry = (ww && i > 0 && str_is_word_byte(h[i - 1]));
+	size_t work = 0;
+
+	for (; i + reach + 32 <= hl; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(h + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(h + i + anchor));
+		__m256i fa = (icase ? _mm256_or_si256(a, mfirst) : a);
+		__m256i fb = (icase ? _mm256_or_si256(b, mlast) : b);
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(fa, vfirst), _mm256_cmpeq_epi8(fb, vlast)));
+
+		if (ww) {
+			unsigned int word = (unsigned int)_mm256_movemask_epi8(word_mask_avx2(a));
+			unsigned int before = (word << 1) | carry;
+			carry = word >> 31;
+			if (pat->ww_left)
+				mask &= ~before;
+			if (pat->ww_right && mask) {
+				__m256i c = _mm256_loadu_si256((const __m256i *)(h + i + nl));
+				mask &= ~(unsigned int)_mm256_movemask_epi8(word_mask_avx2(c));
+			}
+		}
+
+		while (mask) {
+			size_t pos = i + (size_t)__builtin_ctz(mask);
+			if (verify(h + pos + 1, n + 1, nl - 1, icase))
+				return pos;
+			work += nl;
+			mask &= mask - 1;
+		}
+		if (work > FIND_WORK_LIMIT(i - start)) {
+			*bail = i + 32;
+			return STR_NPOS;
+		}
+	}
+
+	return find_sse2(h, hl, i, pat, bail);
+}
+
+
+STR_TARGET("avx2")
+static size_t find_avx2(const unsigned char *h, size_t hl, size_t start,
+			const struct Str_pattern *pat, size_t *bail)
+{
+	switch (pat->flags & (STR_WHOLE_WORD | STR_ICASE)) {
+	case STR_WHOLE_WORD | STR_ICASE:
+		return find_avx2_impl(h, hl, start, pat, bail, true, true);
+	case STR_WHOLE_WORD:
+		return find_avx2_impl(h, hl, start, pat, bail, true, false);
+	case STR_ICASE:
+		return find_avx2_impl(h, hl, start, pat, bail, false, true);
+	default:
+		return find_avx2_impl(h, hl, start, pat, bail, false, false);
+	}
+}
+#endif
+
+
+/*	REVERSE BYTE SET SCAN	*/
+static size_t rfind_bytes_scalar(const unsigned char *h, size_t end,
+				 const unsigned char *set, size_t nset)
+{
+	while (end--) {
+		for (size_t k = 0; k < nset; k++) {
+			if (h[end] == set[k])
+				return end;
+		}
+	}
+	return STR_NPOS;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Walk 16/32 byte blocks down from @end, OR together one compare per set
+ * byte and take the highest set bit of the mask.
+ */
+STR_TARGET("sse2")
+static size_t rfind_bytes_sse2(const unsigned char *h, size_t end,
+			       const unsigned char *set, size_t nset)
+{
+	__m128i vset[STR_SMALL_SET_MAX];
+	for (size_t k = 0; k < nset; k++)
+		vset[k] = _mm_set1_epi8((char)set[k]);
+
+	for (; end >= 16; end -= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(h + end - 16));
+		__m128i hit = _mm_cmpeq_epi8(v, vset[0]);
+		for (size_t k = 1; k < nset; k++)
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, vset[k]));
+
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+		if (mask)
+			return end - 16 + (size_t)(31 - __builtin_clz(mask));
+	}
+	return rfind_bytes_scalar(h, end, set, nset);
+}
+
+
+STR_TARGET("avx2")
+static size_t rfind_bytes_avx2(const unsigned char *h, size_t end,
+			       const unsigned char *set, size_t nset)
+{
+	__m256i vset[STR_SMALL_SET_MAX];
+	for (size_t k = 0; k < nset; k++)
+		vset[k] = _mm256_set1_epi8((char)set[k]);
+
+	for (; end >= 32; end -= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(h + end - 32));
+		__m256i hit = _mm256_cmpeq_epi8(v, vset[0]);
+		for (size_t k = 1; k < nset; k++)
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, vset[k]));
+
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+		if (mask)
+			return end - 32 + (size_t)(31 - __builtin_clz(mask));
+	}
+	return rfind_bytes_sse2(h, end, set, nset);
+}
+#endif
+
+
+/*	FORWARD BYTE SET SCAN	*/
+static size_t find_bytes_scalar(const unsigned char *h, size_t size, size_t i,
+				const unsigned char *set, size_t nset)
+{
+	if (nset == 1) {
+		const unsigned char *p = (i < size ? memchr(h + i, set[0], size - i) : NULL);
+		return (p ? (size_t)(p - h) : STR_NPOS);
+	}
+
+	for (; i < size; i++) {
+		for (size_t k = 0; k < nset; k++) {
+			if (h[i] == set[k])
+				return i;
+		}
+	}
+	return STR_NPOS;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+STR_TARGET("sse2")
+static size_t find_bytes_sse2(const unsigned char *h, size_t size, size_t i,
+			      const unsigned char *set, size_t nset)
+{
+	__m128i vset[STR_SMALL_SET_MAX];
+	for (size_t k = 0; k < nset; k++)
+		vset[k] = _mm_set1_epi8((char)set[k]);
+
+	for (; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(h + i));
+		__m128i hit = _mm_cmpeq_epi8(v, vset[0]);
+		for (size_t k = 1; k < nset; k++)
+			hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, vset[k]));
+
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+		if (mask)
+			return i + (size_t)__builtin_ctz(mask);
+	}
+	return find_bytes_scalar(h, size, i, set, nset);
+}
+
+
+STR_TARGET("avx2")
+static size_t find_bytes_avx2(const unsigned char *h, size_t size, size_t i,
+			      const unsigned char *set, size_t nset)
+{
+	__m256i vset[STR_SMALL_SET_MAX];
+	for (size_t k = 0; k < nset; k++)
+		vset[k] = _mm256_set1_epi8((char)set[k]);
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(h + i));
+		__m256i hit = _mm256_cmpeq_epi8(v, vset[0]);
+		for (size_t k = 1; k < nset; k++)
+			hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, vset[k]));
+
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+		if (mask)
+			return i + (size_t)__builtin_ctz(mask);
+	}
+	return find_bytes_sse2(h, size, i, set, nset);
+}
+#endif
+
+
+/*	BYTE COUNT	*/
+static size_t count_byte_scalar(const unsigned char *h, size_t size,
+				unsigned char c)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < size; i++)
+		count += (h[i] == c);
+	return count;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * A compare yields 0xff (-1) per equal byte, so subtracting it from a byte
+ * accumulator counts the hits of each lane. The lanes are summed with
+ * psadbw every 255 blocks, before any of them can wrap.
+ */
+STR_TARGET("sse2")
+static size_t count_byte_sse2(const unsigned char *h, size_t size,
+			      unsigned char c)
+{
+	const __m128i v = _mm_set1_epi8((char)c);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i total = zero;
+	size_t i = 0;
+
+	while (i + 16 <= size) {
+		__m128i acc = zero;
+		for (size_t k = 0; k < 255 && i + 16 <= size; k++, i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(h + i));
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(x, v));
+		}
+		total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+	}
+
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, total);
+	return (size_t)(lanes[0] + lanes[1]) + count_byte_scalar(h + i, size - i, c);
+}
+
+
+STR_TARGET("avx2")
+static size_t count_byte_avx2(const unsigned char *h, size_t size,
+			      unsigned char c)
+{
+	const __m256i v = _mm256_set1_epi8((char)c);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i total = zero;
+	size_t i = 0;
+
+	while (i + 64 <= size) {
+		__m256i acc0 = zero;
+		__m256i acc1 = zero;
+		for (size_t k = 0; k < 255 && i + 64 <= size; k++, i += 64) {
+			__m256i x0 = _mm256_loadu_si256((const __m256i *)(h + i));
+			__m256i x1 = _mm256_loadu_si256((const __m256i *)(h + i + 32));
+			acc0 = _mm256_sub_epi8(acc0, _mm256_cmpeq_epi8(x0, v));
+			acc1 = _mm256_sub_epi8(acc1, _mm256_cmpeq_epi8(x1, v));
+		}
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(acc0, zero));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(acc1, zero));
+	}
+
+	__m128i t = _mm_add_epi64(_mm256_castsi256_si128(total),
+				  _mm256_extracti128_si256(total, 1));
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, t);
+	return (size_t)(lanes[0] + lanes[1]) + count_byte_sse2(h + i, size - i, c);
+}
+#endif
+
+
+/*	REVERSE FIND	*/
+static size_t rfind_scalar(const unsigned char *h, size_t hl, size_t last,
+			   const struct Str_pattern *pat, size_t *bail)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t ranchor = pat->ranchor;
+	const unsigned char lastb = n[nl - 1];
+	const unsigned char other = n[ranchor];
+	size_t work = 0;
+
+	(void)hl;
+	*bail = 0;
+	for (size_t i = last + 1; i-- > 0;) {
+		if (h[i + nl - 1] != lastb || h[i + ranchor] != other)
+			continue;
+		if (!memcmp(h + i, n, nl - 1))
+			return i;
+
+		work += nl;
+		if (work > FIND_WORK_LIMIT(last - i)) {
+			*bail = i;
+			return STR_NPOS;
+		}
+	}
+	return STR_NPOS;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Blocks of candidate offsets are taken from the top down; within a block
+ * the highest set bit of the filter mask is the latest candidate.
+ */
+STR_TARGET("sse2")
+static size_t rfind_sse2(const unsigned char *h, size_t hl, size_t last,
+			 const struct Str_pattern *pat, size_t *bail)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t ranchor = pat->ranchor;
+	const __m128i vlast = _mm_set1_epi8((char)n[nl - 1]);
+	const __m128i vother = _mm_set1_epi8((char)n[ranchor]);
+	size_t top = last + 1;	// candidates below top are left
+	size_t work = 0;
+
+	for (; top >= 16; top -= 16) {
+		const unsigned char *p = h + top - 16;
+		__m128i a = _mm_loadu_si128((const __m128i *)(p + nl - 1));
+		__m128i b = _mm_loadu_si128((const __m128i *)(p + ranchor));
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(a, vlast), _mm_cmpeq_epi8(b, vother)));
+
+		while (mask) {
+			unsigned int bit = 31 - (unsigned int)__builtin_clz(mask);
+			if (!memcmp(p + bit, n, nl - 1))
+				return top - 16 + bit;
+			work += nl;
+			mask &= ~(1u << bit);
+		}
+		if (work > FIND_WORK_LIMIT(last + 1 - top)) {
+			*bail = top - 16;
+			return STR_NPOS;
+		}
+	}
+
+	*bail = 0;
+	return (top ? rfind_scalar(h, hl, top - 1, pat, bail) : STR_NPOS);
+}
+
+
+STR_TARGET("avx2")
+static size_t rfind_avx2(const unsigned char *h, size_t hl, size_t last,
+			 const struct Str_pattern *pat, size_t *bail)
+{
+	const unsigned char *n = pat->needle;
+	const size_t nl = pat->size;
+	const size_t ranchor = pat->ranchor;
+	const __m256i vlast = _mm256_set1_epi8((char)n[nl - 1]);
+	const __m256i vother = _mm256_set1_epi8((char)n[ranchor]);
+	size_t top = last + 1;
+	size_t work = 0;
+
+	for (; top >= 32; top -= 32) {
+		const unsigned char *p = h + top - 32;
+		__m256i a = _mm256_loadu_si256((const __m256i *)(p + nl - 1));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(p + ranchor));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(a, vlast), _mm256_cmpeq_epi8(b, vother)));
+
+		while (mask) {
+			unsigned int bit = 31 - (unsigned int)__builtin_clz(mask);
+			if (!memcmp(p + bit, n, nl - 1))
+				return top - 32 + bit;
+			work += nl;
+			mask &= ~(1u << bit);
+		}
+		if (work > FIND_WORK_LIMIT(last + 1 - top)) {
+			*bail = top - 32;
+			return STR_NPOS;
+		}
+	}
+
+	*bail = 0;
+	return (top ? rfind_sse2(h, hl, top - 1, pat, bail) : STR_NPOS);
+}
+#endif
+
+
+/*	ASCII CASE	*/
+static void case_flip_bytes(unsigned char *s, size_t size, unsigned char first)
+{
+	for (size_t i = 0; i < size; i++) {
+		if ((unsigned char)(s[i] - first) < 26)
+			s[i] ^= 0x20;
+	}
+}
+
+
+/*
+ * SWAR, eight bytes per step. Adding (0x80 - first) to the low seven bits
+ * of each byte sets its top bit exactly when the byte is >= first, with no
+ * carry into the next byte; the same with first + 26 gives the upper
+ * end. Bytes >= 0x80 are left alone. The surviving 0x80 bits, moved down
+ * to 0x20, are the case bits to flip.
+ */
+static void case_flip_scalar(unsigned char *s, size_t size, unsigned char first)
+{
+	const uint64_t ones = 0x0101010101010101ull;
+	const uint64_t lo7 = 0x7f7f7f7f7f7f7f7full;
+	const uint64_t ge = (uint64_t)(0x80 - first) * ones;
+	const uint64_t gt = (uint64_t)(0x80 - (first + 26)) * ones;
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8) {
+		uint64_t x;
+		memcpy(&x, s + i, 8);
+		uint64_t h = x & lo7;
+		uint64_t in = (h + ge) & ~(h + gt) & ~x & (ones << 7);
+		x ^= in >> 2;
+		memcpy(s + i, &x, 8);
+	}
+	case_flip_bytes(s + i, size - i, first);
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Shifting the range down to start at -128 turns "first <= c < first + 26"
+ * into a single signed compare against -128 + 26.
+ */
+STR_TARGET("sse2")
+static void case_flip_sse2(unsigned char *s, size_t size, unsigned char first)
+{
+	const __m128i bias = _mm_set1_epi8((char)(0x80 - first));
+	const __m128i limit = _mm_set1_epi8(-128 + 26);
+	const __m128i bit = _mm_set1_epi8(0x20);
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i in = _mm_cmplt_epi8(_mm_add_epi8(x, bias), limit);
+		x = _mm_xor_si128(x, _mm_and_si128(in, bit));
+		_mm_storeu_si128((__m128i *)(s + i), x);
+	}
+	case_flip_scalar(s + i, size - i, first);
+}
+
+
+STR_TARGET("avx2")
+static void case_flip_avx2(unsigned char *s, size_t size, unsigned char first)
+{
+	const __m256i bias = _mm256_set1_epi8((char)(0x80 - first));
+	const __m256i limit = _mm256_set1_epi8(-128 + 26);
+	const __m256i bit = _mm256_set1_epi8(0x20);
+	size_t i = 0;
+
+	for (; i + 64 <= size; i += 64) {
+		__m256i x0 = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i x1 = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+		__m256i in0 = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(x0, bias));
+		__m256i in1 = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(x1, bias));
+		x0 = _mm256_xor_si256(x0, _mm256_and_si256(in0, bit));
+		x1 = _mm256_xor_si256(x1, _mm256_and_si256(in1, bit));
+		_mm256_storeu_si256((__m256i *)(s + i), x0);
+		_mm256_storeu_si256((__m256i *)(s + i + 32), x1);
+	}
+	case_flip_sse2(s + i, size - i, first);
+}
+
+
+// Mask registers make the tail a masked load and store, no scalar loop
+STR_TARGET("avx512bw")
+static void case_flip_avx512bw(unsigned char *s, size_t size, unsigned char first)
+{
+	const __m512i vfirst = _mm512_set1_epi8((char)first);
+	const __m512i span = _mm512_set1_epi8(25);
+	const __m512i bit = _mm512_set1_epi8(0x20);
+	size_t i = 0;
+
+	for (; i + 64 <= size; i += 64) {
+		__m512i x = _mm512_loadu_si512((const void *)(s + i));
+		__mmask64 in = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, vfirst), span);
+		x = _mm512_mask_blend_epi8(in, x, _mm512_xor_si512(x, bit));
+		_mm512_storeu_si512((void *)(s + i), x);
+	}
+	if (i < size) {
+		__mmask64 live = ~0ull >> (64 - (size - i));
+		__m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+		__mmask64 in = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, vfirst), span) & live;
+		_mm512_mask_storeu_epi8(s + i, in, _mm512_xor_si512(x, bit));
+	}
+}
+#endif
+
+
+/*	TITLE CASE	*/
+
+/*
+ * Title cases @size bytes, @start telling whether the byte before them
+ * was a boundary. Returns the same for the last byte, so a vector kernel
+ * can finish its tail here.
+ */
+static bool title_case_bytes(unsigned char *s, size_t size,
+			     const struct Str_charset *set, bool start)
+{
+	unsigned char flip = start ? 0x20 : 0;
+
+	for (size_t i = 0; i < size; i++) {
+		unsigned char c = s[i];
+		unsigned char cased = (unsigned char)((c | 0x20) ^ flip);
+		unsigned char letter = -(unsigned char)((unsigned char)((c | 0x20) - 'a') < 26);
+		s[i] = (unsigned char)(c ^ ((c ^ cased) & letter));	// no branch to mispredict
+		flip = ((set->bits[c >> 6] >> (c & 63)) & 1) << 5;
+	}
+	return flip != 0;
+}
+
+
+static bool title_case_scalar(unsigned char *s, size_t size,
+			      const struct Str_charset *set, bool start)
+{
+	return title_case_bytes(s, size, set, start);
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Set membership with two shuffles: the low nibble of a byte picks a row,
+ * whose bit n says whether the byte with high nibble n (lo) or n + 8 (hi)
+ * is in the set. The high nibble then picks the bit to test.
+ */
+static void charset_nibble_tables(const struct Str_charset *set,
+				  unsigned char lo[16], unsigned char hi[16])
+{
+	memset(lo, 0, 16);
+	memset(hi, 0, 16);
+	for (unsigned int c = 0; c < 256; c++) {
+		if (!((set->bits[c >> 6] >> (c & 63)) & 1))
+			continue;
+		if (c < 0x80)
+			lo[c & 15] |= (unsigned char)(1u << (c >> 4));
+		else
+			hi[c & 15] |= (unsigned char)(1u << ((c >> 4) - 8));
+	}
+}
+
+
+// The nibble tables of a set, in registers
+struct charset_avx2 {
+	__m256i	lo;
+	__m256i	hi;
+};
+
+struct charset_avx512 {
+	__m512i	lo;
+	__m512i	hi;
+};
+
+
+STR_TARGET("avx2")
+static inline void charset_load_avx2(struct charset_avx2 *t, const struct Str_charset *set)
+{
+	unsigned char lo[16], hi[16];
+	charset_nibble_tables(set, lo, hi);
+	t->lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+	t->hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi));
+}
+
+
+// 0xff in every byte of @x that is in the set
+STR_TARGET("avx2")
+static inline __m256i charset_member_avx2(__m256i x, const struct charset_avx2 *t)
+{
+	const __m256i tbit = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+					      1, 2, 4, 8, 16, 32, 64, -128,
+					      1, 2, 4, 8, 16, 32, 64, -128,
+					      1, 2, 4, 8, 16, 32, 64, -128);
+	const __m256i nib = _mm256_set1_epi8(0x0f);
+	__m256i ln = _mm256_and_si256(x, nib);
+	__m256i hn = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+	__m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(t->lo, ln),
+					 _mm256_shuffle_epi8(t->hi, ln), x);
+	__m256i sel = _mm256_shuffle_epi8(tbit, hn);
+	return _mm256_cmpeq_epi8(_mm256_and_si256(row, sel), sel);
+}
+
+
+STR_TARGET("avx512bw")
+static inline void charset_load_avx512(struct charset_avx512 *t, const struct Str_charset *set)
+{
+	unsigned char lo[16], hi[16];
+	charset_nibble_tables(set, lo, hi);
+	t->lo = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)lo));
+	t->hi = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)hi));
+}
+
+
+STR_TARGET("avx512bw")
+static inline __mmask64 charset_member_avx512(__m512i x, const struct charset_avx512 *t)
+{
+	const __m512i tbit = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+								  1, 2, 4, 8, 16, 32, 64, -128));
+	const __m512i nib = _mm512_set1_epi8(0x0f);
+	__m512i ln = _mm512_and_si512(x, nib);
+	__m512i hn = _mm512_and_si512(_mm512_srli_epi16(x, 4), nib);
+	__m512i row = _mm512_mask_blend_epi8(_mm512_movepi8_mask(x),
+					     _mm512_shuffle_epi8(t->lo, ln),
+					     _mm512_shuffle_epi8(t->hi, ln));
+	return _mm512_test_epi8_mask(row, _mm512_shuffle_epi8(tbit, hn));
+}
+
+
+/*
+ * A letter is upper-cased when the byte before it is a boundary and
+ * lower-cased otherwise. The boundary mask of a block, moved up one byte
+ * with the last byte of the previous block shifted in, gives exactly the
+ * letters to upper-case. There is no SSE2 kernel: without pshufb the set
+ * lookup costs more than the table loop.
+ */
+STR_TARGET("avx2")
+static bool title_case_avx2(unsigned char *s, size_t size,
+			    const struct Str_charset *set, bool start)
+{
+	struct charset_avx2 t;
+	charset_load_avx2(&t, set);
+
+	const __m256i bias = _mm256_set1_epi8((char)(0x80 - 'a'));
+	const __m256i limit = _mm256_set1_epi8(-128 + 26);
+	const __m256i bit = _mm256_set1_epi8(0x20);
+	__m256i prev = _mm256_set1_epi8(start ? -1 : 0);
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i b = charset_member_avx2(x, &t);
+		// b moved up one byte, across the 128-bit lane boundary
+		__m256i first = _mm256_alignr_epi8(b, _mm256_permute2x128_si256(prev, b, 0x21), 15);
+		prev = b;
+
+		__m256i lower = _mm256_or_si256(x, bit);
+		__m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(lower, bias));
+		__m256i want = _mm256_xor_si256(lower, _mm256_and_si256(first, bit));
+		x = _mm256_blendv_epi8(x, want, letter);
+		_mm256_storeu_si256((__m256i *)(s + i), x);
+	}
+	return title_case_bytes(s + i, size - i, set, _mm256_extract_epi8(prev, 31) != 0);
+}
+
+
+// With mask registers the shift across lanes is a plain 64-bit shift
+STR_TARGET("avx512bw")
+static bool title_case_avx512bw(unsigned char *s, size_t size,
+				const struct Str_charset *set, bool start)
+{
+	struct charset_avx512 t;
+	charset_load_avx512(&t, set);
+
+	const __m512i va = _mm512_set1_epi8('a');
+	const __m512i span = _mm512_set1_epi8(25);
+	const __m512i bit = _mm512_set1_epi8(0x20);
+	__mmask64 carry = start;
+	size_t i = 0;
+
+	while (i < size) {
+		size_t n = size - i >= 64 ? 64 : size - i;
+		__mmask64 live = ~0ull >> (64 - n);
+		__m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+		__mmask64 b = charset_member_avx512(x, &t);
+		__mmask64 first = (b << 1) | carry;
+		carry = (b >> (n - 1)) & 1;
+
+		__m512i lower = _mm512_or_si512(x, bit);
+		__mmask64 letter = _mm512_cmple_epu8_mask(_mm512_sub_epi8(lower, va), span);
+		__m512i want = _mm512_mask_blend_epi8(first, lower, _mm512_andnot_si512(bit, x));
+		_mm512_mask_storeu_epi8(s + i, letter & live, want);
+		i += n;
+	}
+	return carry != 0;
+}
+#endif
+
+
+/*	REVERSE	*/
+
+/*
+ * All kernels work from both ends inwards: load a block at the front and
+ * one at the back, reverse each, store them crosswise. What is left in
+ * the middle is shorter than two blocks and goes to the next narrower
+ * kernel.
+ */
+static void reverse_scalar(unsigned char *s, size_t size)
+{
+	size_t i = 0, j = size;
+
+	for (; j - i >= 16; i += 8, j -= 8) {
+		uint64_t a, b;
+		memcpy(&a, s + i, 8);
+		memcpy(&b, s + j - 8, 8);
+		a = __builtin_bswap64(a);
+		b = __builtin_bswap64(b);
+		memcpy(s + i, &b, 8);
+		memcpy(s + j - 8, &a, 8);
+	}
+	for (; i + 1 < j; i++, j--) {
+		unsigned char c = s[i];
+		s[i] = s[j - 1];
+		s[j - 1] = c;
+	}
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+// SSE2 has no byte shuffle: reverse the dwords, then the words, then swap bytes
+STR_TARGET("sse2")
+static inline __m128i reverse_block_sse2(__m128i x)
+{
+	x = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+
+STR_TARGET("sse2")
+static void reverse_sse2(unsigned char *s, size_t size)
+{
+	size_t i = 0, j = size;
+
+	for (; j - i >= 32; i += 16, j -= 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + j - 16));
+		_mm_storeu_si128((__m128i *)(s + i), reverse_block_sse2(b));
+		_mm_storeu_si128((__m128i *)(s + j - 16), reverse_block_sse2(a));
+	}
+	reverse_scalar(s + i, j - i);
+}
+
+
+// pshufb reverses within each 128-bit lane, the permute swaps the lanes
+STR_TARGET("avx2")
+static void reverse_avx2(unsigned char *s, size_t size)
+{
+	const __m256i idx = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+					     7, 6, 5, 4, 3, 2, 1, 0,
+					     15, 14, 13, 12, 11, 10, 9, 8,
+					     7, 6, 5, 4, 3, 2, 1, 0);
+	size_t i = 0, j = size;
+
+	for (; j - i >= 64; i += 32, j -= 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(s + j - 32));
+		a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, idx), _MM_SHUFFLE(1, 0, 3, 2));
+		b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, idx), _MM_SHUFFLE(1, 0, 3, 2));
+		_mm256_storeu_si256((__m256i *)(s + i), b);
+		_mm256_storeu_si256((__m256i *)(s + j - 32), a);
+	}
+	reverse_sse2(s + i, j - i);
+}
+
+
+/*
+ * vpermb would do a block in one instruction but needs AVX512VBMI; a lane
+ * local pshufb plus a 128-bit lane reversal only needs AVX512BW.
+ */
+STR_TARGET("avx512bw")
+static void reverse_avx512bw(unsigned char *s, size_t size)
+{
+	const __m512i idx = _mm512_broadcast_i32x4(_mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+								 7, 6, 5, 4, 3, 2, 1, 0));
+	size_t i = 0, j = size;
+
+	for (; j - i >= 128; i += 64, j -= 64) {
+		__m512i a = _mm512_loadu_si512((const void *)(s + i));
+		__m512i b = _mm512_loadu_si512((const void *)(s + j - 64));
+		a = _mm512_shuffle_epi8(a, idx);
+		b = _mm512_shuffle_epi8(b, idx);
+		a = _mm512_shuffle_i64x2(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+		b = _mm512_shuffle_i64x2(b, b, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm512_storeu_si512((void *)(s + i), b);
+		_mm512_storeu_si512((void *)(s + j - 64), a);
+	}
+	reverse_avx2(s + i, j - i);
+}
+#endif
+
+
+/*	TRANSLATE	*/
+static void translate_scalar(unsigned char *s, size_t size, const struct Str_table *t)
+{
+	const unsigned char *map = t->map;
+	size_t i = 0;
+
+	if (!t->nrows)
+		return;
+	for (; i + 4 <= size; i += 4) {
+		unsigned char a = map[s[i]], b = map[s[i + 1]];
+		unsigned char c = map[s[i + 2]], d = map[s[i + 3]];
+		s[i] = a;
+		s[i + 1] = b;
+		s[i + 2] = c;
+		s[i + 3] = d;
+	}
+	for (; i < size; i++)
+		s[i] = map[s[i]];
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * For every changed row: bytes whose high nibble selects the row pick
+ * their delta by low nibble. The deltas are xor-ed in at the end, bytes
+ * in untouched rows get 0.
+ */
+STR_TARGET("avx2")
+static void translate_avx2(unsigned char *s, size_t size, const struct Str_table *t)
+{
+	const unsigned int nrows = t->nrows;
+	const __m256i nib = _mm256_set1_epi8(0x0f);
+	__m256i row[16], delta[16];
+	size_t i = 0;
+
+	if (!nrows)
+		return;
+	for (unsigned int r = 0; r < nrows; r++) {
+		row[r] = _mm256_set1_epi8((char)t->rows[r]);
+		delta[r] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t->delta[r]));
+	}
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i lo = _mm256_and_si256(x, nib);
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+		__m256i acc = _mm256_setzero_si256();
+		for (unsigned int r = 0; r < nrows; r++) {
+			__m256i in = _mm256_cmpeq_epi8(hi, row[r]);
+			acc = _mm256_or_si256(acc, _mm256_and_si256(in, _mm256_shuffle_epi8(delta[r], lo)));
+		}
+		_mm256_storeu_si256((__m256i *)(s + i), _mm256_xor_si256(x, acc));
+	}
+	for (; i < size; i++)
+		s[i] = t->map[s[i]];
+}
+
+
+STR_TARGET("avx512bw")
+static void translate_avx512bw(unsigned char *s, size_t size, const struct Str_table *t)
+{
+	const unsigned int nrows = t->nrows;
+	const __m512i nib = _mm512_set1_epi8(0x0f);
+	__m512i row[16], delta[16];
+	size_t i = 0;
+
+	if (!nrows)
+		return;
+	for (unsigned int r = 0; r < nrows; r++) {
+		row[r] = _mm512_set1_epi8((char)t->rows[r]);
+		delta[r] = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)t->delta[r]));
+	}
+
+	while (i < size) {
+		size_t n = size - i >= 64 ? 64 : size - i;
+		__mmask64 live = ~0ull >> (64 - n);
+		__m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+		__m512i lo = _mm512_and_si512(x, nib);
+		__m512i hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), nib);
+		__m512i acc = _mm512_setzero_si512();
+		for (unsigned int r = 0; r < nrows; r++) {
+			__mmask64 in = _mm512_cmpeq_epi8_mask(hi, row[r]);
+			acc = _mm512_or_si512(acc, _mm512_maskz_shuffle_epi8(in, delta[r], lo));
+		}
+		_mm512_mask_storeu_epi8(s + i, live, _mm512_xor_si512(x, acc));
+		i += n;
+	}
+}
+#endif
+
+
+/*	WHITESPACE	*/
+
+/*
+ * Whitespace is the C locale isspace() set: ' ' and '\t' .. '\r'. In the
+ * vector kernels the range is one signed compare after shifting '\t' down
+ * to -128, the same trick as in the case kernels.
+ */
+static inline bool ws_byte(unsigned char c)
+{
+	return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+
+static size_t ws_span_scalar(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	while (i < size && ws_byte(s[i]))
+		i++;
+	return i;
+}
+
+
+static size_t ws_rspan_scalar(const unsigned char *s, size_t size)
+{
+	size_t i = size;
+
+	while (i > 0 && ws_byte(s[i - 1]))
+		i--;
+	return size - i;
+}
+
+
+/*
+ * Copies s[r .. end) to s[w ..], every whitespace byte as ' ' and dropping
+ * those that follow another one. *prev says whether the byte before r was
+ * whitespace. Returns the new write offset; w <= r, so this works in place.
+ */
+static size_t squeeze_ws_range(unsigned char *s, size_t w, size_t r, size_t end, bool *prev)
+{
+	bool p = *prev;
+
+	for (; r < end; r++) {
+		unsigned char c = s[r];
+		bool ws = ws_byte(c);
+		s[w] = ws ? ' ' : c;
+		w += !(ws && p);
+		p = ws;
+	}
+	*prev = p;
+	return w;
+}
+
+
+static size_t squeeze_ws_scalar(unsigned char *s, size_t size)
+{
+	bool prev = false;
+	return squeeze_ws_range(s, 0, 0, size, &prev);
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+STR_TARGET("sse2")
+static inline __m128i ws_mask_sse2(__m128i x)
+{
+	const __m128i bias = _mm_set1_epi8((char)(0x80 - '\t'));
+	const __m128i limit = _mm_set1_epi8(-128 + 5);
+	return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+			    _mm_cmplt_epi8(_mm_add_epi8(x, bias), limit));
+}
+
+
+STR_TARGET("sse2")
+static size_t ws_span_sse2(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16) {
+		unsigned int m = ~(unsigned int)_mm_movemask_epi8(ws_mask_sse2(
+			_mm_loadu_si128((const __m128i *)(s + i)))) & 0xffff;
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+	return i + ws_span_scalar(s + i, size - i);
+}
+
+
+STR_TARGET("sse2")
+static size_t ws_rspan_sse2(const unsigned char *s, size_t size)
+{
+	size_t i = size;
+
+	for (; i >= 16; i -= 16) {
+		unsigned int m = ~(unsigned int)_mm_movemask_epi8(ws_mask_sse2(
+			_mm_loadu_si128((const __m128i *)(s + i - 16)))) & 0xffff;
+		if (m)
+			return size - (i - 16 + 32 - (size_t)__builtin_clz(m));
+	}
+	return size - i + ws_rspan_scalar(s, i);
+}
+
+
+/*
+ * Most blocks of ordinary text have no two whitespace bytes in a row:
+ * those are stored back whole, with their whitespace turned into spaces.
+ * Blocks with a run to collapse take the byte loop here; the AVX2 and
+ * AVX-512 kernels compact them with pshufb instead.
+ */
+STR_TARGET("sse2")
+static size_t squeeze_ws_sse2(unsigned char *s, size_t size)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	size_t w = 0, r = 0;
+	bool prev = false;
+
+	for (; r + 16 <= size; r += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(s + r));
+		__m128i ws = ws_mask_sse2(x);
+		unsigned int m = (unsigned int)_mm_movemask_epi8(ws);
+
+		if (m & (m << 1 | prev)) {
+			w = squeeze_ws_range(s, w, r, r + 16, &prev);
+			continue;
+		}
+		x = _mm_or_si128(_mm_andnot_si128(ws, x), _mm_and_si128(ws, space));
+		_mm_storeu_si128((__m128i *)(s + w), x);
+		w += 16;
+		prev = m >> 15;
+	}
+	return squeeze_ws_range(s, w, r, size, &prev);
+}
+
+
+/*
+ * Compaction by pshufb, eight bytes at a time: entry k of the table moves
+ * the bytes whose bits are set in k to the front. Filled in once by
+ * dispatch_init().
+ */
+static unsigned char compact_shuffle[256][8];
+static unsigned char compact_count[256];
+
+
+static void compact_init(void)
+{
+	for (unsigned int k = 0; k < 256; k++) {
+		unsigned int n = 0;
+		for (unsigned int b = 0; b < 8; b++) {
+			if (k & (1u << b))
+				compact_shuffle[k][n++] = (unsigned char)b;
+		}
+		compact_count[k] = (unsigned char)n;
+		for (; n < 8; n++)
+			compact_shuffle[k][n] = 0x80;
+	}
+}
+
+
+/*
+ * Writes the bytes of the @size (a multiple of 8) at @src whose bit is
+ * set in @keep to @dst, returns how many. Every group stores eight bytes,
+ * so @dst may only run ahead of data that has been read already.
+ */
+STR_TARGET("avx2")
+static inline size_t compact_avx2(unsigned char *dst, const unsigned char *src,
+				  uint64_t keep, size_t size)
+{
+	size_t w = 0;
+
+	for (size_t g = 0; g < size; g += 8, keep >>= 8) {
+		unsigned int k = keep & 0xff;
+		__m128i x = _mm_loadl_epi64((const __m128i *)(src + g));
+		__m128i idx = _mm_loadl_epi64((const __m128i *)compact_shuffle[k]);
+		_mm_storel_epi64((__m128i *)(dst + w), _mm_shuffle_epi8(x, idx));
+		w += compact_count[k];
+	}
+	return w;
+}
+
+
+STR_TARGET("avx2")
+static inline __m256i ws_mask_avx2(__m256i x)
+{
+	const __m256i bias = _mm256_set1_epi8((char)(0x80 - '\t'));
+	const __m256i limit = _mm256_set1_epi8(-128 + 5);
+	return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+			       _mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, bias)));
+}
+
+
+STR_TARGET("avx2")
+static size_t ws_span_avx2(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32) {
+		uint32_t m = ~(uint32_t)_mm256_movemask_epi8(ws_mask_avx2(
+			_mm256_loadu_si256((const __m256i *)(s + i))));
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+	return i + ws_span_sse2(s + i, size - i);
+}
+
+
+STR_TARGET("avx2")
+static size_t ws_rspan_avx2(const unsigned char *s, size_t size)
+{
+	size_t i = size;
+
+	for (; i >= 32; i -= 32) {
+		uint32_t m = ~(uint32_t)_mm256_movemask_epi8(ws_mask_avx2(
+			_mm256_loadu_si256((const __m256i *)(s + i - 32))));
+		if (m)
+			return size - (i - (size_t)__builtin_clz(m));
+	}
+	return size - i + ws_rspan_sse2(s, i);
+}
+
+
+STR_TARGET("avx2")
+static size_t squeeze_ws_avx2(unsigned char *s, size_t size)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	size_t w = 0, r = 0;
+	bool prev = false;
+
+	for (; r + 32 <= size; r += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + r));
+		__m256i ws = ws_mask_avx2(x);
+		uint32_t m = (uint32_t)_mm256_movemask_epi8(ws);
+
+		uint32_t dup = m & (m << 1 | prev);
+
+		x = _mm256_blendv_epi8(x, space, ws);
+		prev = m >> 31;
+		if (dup) {
+			unsigned char buf[32];
+			_mm256_storeu_si256((__m256i *)buf, x);
+			w += compact_avx2(s + w, buf, ~dup, 32);
+			continue;
+		}
+		_mm256_storeu_si256((__m256i *)(s + w), x);
+		w += 32;
+	}
+	return squeeze_ws_range(s, w, r, size, &prev);
+}
+
+
+STR_TARGET("avx512bw")
+static size_t squeeze_ws_avx512bw(unsigned char *s, size_t size)
+{
+	const __m512i space = _mm512_set1_epi8(' ');
+	const __m512i tab = _mm512_set1_epi8('\t');
+	const __m512i span = _mm512_set1_epi8(4);
+	size_t w = 0, r = 0;
+	bool prev = false;
+
+	for (; r + 64 <= size; r += 64) {
+		__m512i x = _mm512_loadu_si512((const void *)(s + r));
+		__mmask64 m = _mm512_cmpeq_epi8_mask(x, space) |
+			      _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, tab), span);
+
+		__mmask64 dup = m & (m << 1 | prev);
+
+		x = _mm512_mask_blend_epi8(m, x, space);
+		prev = m >> 63;
+		if (dup) {
+			unsigned char buf[64];
+			_mm512_storeu_si512((void *)buf, x);
+			w += compact_avx2(s + w, buf, ~dup, 64);
+			continue;
+		}
+		_mm512_storeu_si512((void *)(s + w), x);
+		w += 64;
+	}
+	return squeeze_ws_range(s, w, r, size, &prev);
+}
+#endif
+
+
+/*	CHARSET	*/
+
+// First offset whose membership in @set is not @in, or @size
+static size_t span_scalar(const unsigned char *s, size_t size,
+			  const struct Str_charset *set, bool in)
+{
+	size_t i = 0;
+
+	while (i < size && str_charset_has(set, s[i]) == in)
+		i++;
+	return i;
+}
+
+
+void str_set_prepare(struct str_set_prepared *p, const struct Str_charset *set)
+{
+	p->bits = *set;
+#ifdef STR_HAVE_X86_SIMD
+	charset_nibble_tables(set, p->lo, p->hi);
+#else
+	memset(p->lo, 0, sizeof(p->lo));
+	memset(p->hi, 0, sizeof(p->hi));
+#endif
+}
+
+
+static uint64_t set_mask_scalar(const unsigned char *s, size_t n,
+			       const struct str_set_prepared *set)
+{
+	uint64_t m = 0;
+
+	for (size_t i = 0; i < n; i++)
+		m |= (uint64_t)!str_charset_has(&set->bits, s[i]) << i;
+	return m;
+}
+
+
+static size_t remove_set_scalar(unsigned char *s, size_t size, const struct Str_charset *set)
+{
+	// A local copy: the stores to @s could otherwise alias the set
+	const struct Str_charset bits = *set;
+	size_t w = 0;
+
+	for (size_t r = 0; r < size; r++) {
+		unsigned char c = s[r];
+		s[w] = c;
+		w += !str_charset_has(&bits, c);
+	}
+	return w;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * The set lookup is the pshufb nibble lookup of the title case kernels,
+ * so as there, SSE2 keeps the scalar loops.
+ */
+STR_TARGET("avx2")
+static size_t span_avx2(const unsigned char *s, size_t size,
+			const struct Str_charset *set, bool in)
+{
+	const uint32_t flip = in ? ~0u : 0;
+	struct charset_avx2 t;
+	size_t i = 0;
+
+	charset_load_avx2(&t, set);
+	for (; i + 32 <= size; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		uint32_t m = (uint32_t)_mm256_movemask_epi8(charset_member_avx2(x, &t)) ^ flip;
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+	return i + span_scalar(s + i, size - i, set, in);
+}
+
+
+STR_TARGET("avx2")
+static uint64_t set_mask_avx2(const unsigned char *s, size_t n,
+			      const struct str_set_prepared *set)
+{
+	if (n < 64)
+		return set_mask_scalar(s, n, set);
+
+	struct charset_avx2 t;
+	t.lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->lo));
+	t.hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->hi));
+	__m256i a = _mm256_loadu_si256((const __m256i *)s);
+	__m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+	uint64_t in = (uint32_t)_mm256_movemask_epi8(charset_member_avx2(a, &t)) |
+		      (uint64_t)(uint32_t)_mm256_movemask_epi8(charset_member_avx2(b, &t)) << 32;
+	return ~in;
+}
+
+
+STR_TARGET("avx2")
+static size_t remove_set_avx2(unsigned char *s, size_t size, const struct Str_charset *set)
+{
+	struct charset_avx2 t;
+	size_t w = 0, r = 0;
+
+	charset_load_avx2(&t, set);
+	for (; r + 32 <= size; r += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + r));
+		uint32_t m = (uint32_t)_mm256_movemask_epi8(charset_member_avx2(x, &t));
+
+		if (!m) {
+			_mm256_storeu_si256((__m256i *)(s + w), x);
+			w += 32;
+		} else if (~m) {
+			// w <= r: each group is read before anything is written over it
+			w += compact_avx2(s + w, s + r, ~m, 32);
+		}
+	}
+	if (r < size) {
+		memmove(s + w, s + r, size - r);
+		w += remove_set_scalar(s + w, size - r, set);
+	}
+	return w;
+}
+
+
+STR_TARGET("avx512bw")
+static size_t span_avx512bw(const unsigned char *s, size_t size,
+			    const struct Str_charset *set, bool in)
+{
+	const uint64_t flip = in ? ~0ull : 0;
+	struct charset_avx512 t;
+	size_t i = 0;
+
+	charset_load_avx512(&t, set);
+	while (i < size) {
+		size_t n = size - i >= 64 ? 64 : size - i;
+		__mmask64 live = ~0ull >> (64 - n);
+		__m512i x = _mm512_maskz_loadu_epi8(live, s + i);
+		uint64_t m = (charset_member_avx512(x, &t) ^ flip) & live;
+		if (m)
+			return i + (size_t)__builtin_ctzll(m);
+		i += n;
+	}
+	return size;
+}
+
+
+STR_TARGET("avx512bw")
+static uint64_t set_mask_avx512bw(const unsigned char *s, size_t n,
+				  const struct str_set_prepared *set)
+{
+	struct charset_avx512 t;
+	__mmask64 live = ~0ull >> (64 - n);
+
+	t.lo = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)set->lo));
+	t.hi = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)set->hi));
+	return ~charset_member_avx512(_mm512_maskz_loadu_epi8(live, s), &t) & live;
+}
+
+
+STR_TARGET("avx512bw")
+static size_t remove_set_avx512bw(unsigned char *s, size_t size, const struct Str_charset *set)
+{
+	struct charset_avx512 t;
+	size_t w = 0, r = 0;
+
+	charset_load_avx512(&t, set);
+	for (; r + 64 <= size; r += 64) {
+		__m512i x = _mm512_loadu_si512((const void *)(s + r));
+		uint64_t m = charset_member_avx512(x, &t);
+
+		if (!m) {
+			_mm512_storeu_si512((void *)(s + w), x);
+			w += 64;
+		} else if (~m) {
+			w += compact_avx2(s + w, s + r, ~m, 64);
+		}
+	}
+	if (r < size) {
+		memmove(s + w, s + r, size - r);
+		w += remove_set_scalar(s + w, size - r, set);
+	}
+	return w;
+}
+#endif
+
+
+/*	UTF-8	*/
+static size_t ascii_span_scalar(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= size; i += 8) {
+		uint64_t w;
+		memcpy(&w, s + i, 8);
+		if (w & 0x8080808080808080ull)
+			break;
+	}
+	while (i < size && s[i] < 0x80)
+		i++;
+	return i;
+}
+
+
+static size_t utf8_check_scalar(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+	uint32_t cp;
+
+	while (i < size) {
+		uint64_t w;
+
+		// ASCII eight bytes at a time
+		if (i + 8 <= size) {
+			memcpy(&w, s + i, 8);
+			if (!(w & 0x8080808080808080ull)) {
+				i += 8;
+				continue;
+			}
+		}
+		size_t n = str_utf8_decode(s + i, size - i, &cp);
+		if (cp == STR_UTF8_BAD)
+			return i;
+		i += n;
+	}
+	return size;
+}
+
+
+/*
+ * The vector kernels only tell that a block at @i has an error somewhere.
+ * All sequences before @i were complete and valid except perhaps one that
+ * runs into the block, which starts at the first non-continuation byte
+ * among the three before @i; the scalar check picks up from there.
+ */
+static size_t utf8_check_resume(const unsigned char *s, size_t i, size_t size)
+{
+	size_t b = (i >= 3 ? i - 3 : 0);
+
+	while (b < i && (s[b] & 0xc0) == 0x80)
+		b++;
+	return b + utf8_check_scalar(s + b, size - b);
+}
+
+
+// Bytes that start a code point: everything but 10xxxxxx
+static size_t utf8_count_scalar(const unsigned char *s, size_t size)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < size; i++)
+		count += ((signed char)s[i] > -65);
+	return count;
+}
+
+
+static size_t utf8_skip_scalar(const unsigned char *s, size_t size, size_t n)
+{
+	for (size_t i = 0; i < size; i++) {
+		if ((signed char)s[i] > -65 && n-- == 0)
+			return i;
+	}
+	return STR_NPOS;
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+STR_TARGET("sse2")
+static size_t ascii_span_sse2(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16) {
+		int m = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+		if (m)
+			return i + (size_t)__builtin_ctz((unsigned int)m);
+	}
+	return i + ascii_span_scalar(s + i, size - i);
+}
+
+
+STR_TARGET("avx2")
+static size_t ascii_span_avx2(const unsigned char *s, size_t size)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32) {
+		uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(s + i)));
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+	return i + ascii_span_scalar(s + i, size - i);
+}
+
+
+/*
+ * Counted like count_byte_sse2(): a signed compare against -65 is -1 for
+ * every byte that starts a code point.
+ */
+STR_TARGET("sse2")
+static size_t utf8_count_sse2(const unsigned char *s, size_t size)
+{
+	const __m128i cont = _mm_set1_epi8(-65);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i total = zero;
+	size_t i = 0;
+
+	while (i + 16 <= size) {
+		__m128i acc = zero;
+		for (size_t k = 0; k < 255 && i + 16 <= size; k++, i += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+			acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(x, cont));
+		}
+		total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+	}
+
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, total);
+	return (size_t)(lanes[0] + lanes[1]) + utf8_count_scalar(s + i, size - i);
+}
+
+
+STR_TARGET("avx2")
+static size_t utf8_count_avx2(const unsigned char *s, size_t size)
+{
+	const __m256i cont = _mm256_set1_epi8(-65);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i total = zero;
+	size_t i = 0;
+
+	while (i + 64 <= size) {
+		__m256i acc0 = zero;
+		__m256i acc1 = zero;
+		for (size_t k = 0; k < 255 && i + 64 <= size; k++, i += 64) {
+			__m256i x0 = _mm256_loadu_si256((const __m256i *)(s + i));
+			__m256i x1 = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+			acc0 = _mm256_sub_epi8(acc0, _mm256_cmpgt_epi8(x0, cont));
+			acc1 = _mm256_sub_epi8(acc1, _mm256_cmpgt_epi8(x1, cont));
+		}
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(acc0, zero));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(acc1, zero));
+	}
+
+	__m128i t = _mm_add_epi64(_mm256_castsi256_si128(total),
+				  _mm256_extracti128_si256(total, 1));
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, t);
+	return (size_t)(lanes[0] + lanes[1]) + utf8_count_sse2(s + i, size - i);
+}
+
+
+/*
+ * Whole blocks are skipped by the popcount of their start byte mask; in
+ * the block that holds the code point, the lower set bits are cleared
+ * until it is the lowest. Every AVX2 CPU has popcnt.
+ */
+STR_TARGET("avx2,popcnt")
+static size_t utf8_skip_avx2(const unsigned char *s, size_t size, size_t n)
+{
+	const __m256i cont = _mm256_set1_epi8(-65);
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(x, cont));
+		size_t c = (size_t)__builtin_popcount(m);
+
+		if (n < c) {
+			while (n--)
+				m &= m - 1;
+			return i + (size_t)__builtin_ctz(m);
+		}
+		n -= c;
+	}
+
+	size_t r = utf8_skip_scalar(s + i, size - i, n);
+	return (r == STR_NPOS ? STR_NPOS : i + r);
+}
+
+
+/*
+ * Lookup table validation after Keiser and Lemire, "Validating UTF-8 In
+ * Less Than One Instruction Per Byte". Every byte pair is classified by
+ * the high and the low nibble of the first byte and the high nibble of
+ * the second; a bit that survives the AND of the three lookups is an
+ * error, except for TWO_CONTS, which marks the 3rd and 4th bytes of long
+ * sequences and is checked against the leads two and three bytes back.
+ * SSE2 lacks the byte shuffle and keeps the scalar loop.
+ */
+#define U8_TOO_SHORT	0x01	/* lead not followed by a continuation */
+#define U8_TOO_LONG	0x02	/* continuation after ASCII */
+#define U8_OVERLONG_3	0x04
+#define U8_TOO_LARGE	0x08
+#define U8_SURROGATE	0x10
+#define U8_OVERLONG_2	0x20
+#define U8_TOO_LARGE_1000 0x40
+#define U8_OVERLONG_4	0x40
+#define U8_TWO_CONTS	0x80	/* two continuations in a row */
+#define U8_CARRY	(U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+static const unsigned char utf8_byte1_high[16] = {
+	// ASCII
+	U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+	U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+	// Continuation
+	U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+	// 2, 2, 3 and 4 byte leads
+	U8_TOO_SHORT | U8_OVERLONG_2,
+	U8_TOO_SHORT,
+	U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+	U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+};
+
+static const unsigned char utf8_byte1_low[16] = {
+	U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+	U8_CARRY | U8_OVERLONG_2,
+	U8_CARRY,
+	U8_CARRY,
+	U8_CARRY | U8_TOO_LARGE,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+	U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+};
+
+static const unsigned char utf8_byte2_high[16] = {
+	// ASCII
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+	// 0x80..0x8f, 0x90..0x9f, 0xa0..0xbf
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 |
+		U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+	U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+	// Leads
+	U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+};
+
+
+struct utf8_avx2 {
+	__m256i	byte1_high;
+	__m256i	byte1_low;
+	__m256i	byte2_high;
+};
+
+struct utf8_avx512 {
+	__m512i	byte1_high;
+	__m512i	byte1_low;
+	__m512i	byte2_high;
+};
+
+
+// The bytes of @x moved up by @n, with the last @n of @p shifted in
+#define UTF8_PREV_AVX2(x, p, n) \
+	_mm256_alignr_epi8((x), _mm256_permute2x128_si256((p), (x), 0x21), 16 - (n))
+
+#define UTF8_PREV_AVX512(x, p, n) \
+	_mm512_alignr_epi8((x), _mm512_permutex2var_epi64((p), \
+		_mm512_setr_epi64(6, 7, 8, 9, 10, 11, 12, 13), (x)), 16 - (n))
+
+
+// Nonzero bytes where block @x, preceded by @prev, is not valid UTF-8
+STR_TARGET("avx2")
+static inline __m256i utf8_errors_avx2(__m256i x, __m256i prev, const struct utf8_avx2 *t)
+{
+	const __m256i nib = _mm256_set1_epi8(0x0f);
+	__m256i p1 = UTF8_PREV_AVX2(x, prev, 1);
+	__m256i p2 = UTF8_PREV_AVX2(x, prev, 2);
+	__m256i p3 = UTF8_PREV_AVX2(x, prev, 3);
+
+	__m256i sc = _mm256_shuffle_epi8(t->byte1_high,
+					 _mm256_and_si256(_mm256_srli_epi16(p1, 4), nib));
+	sc = _mm256_and_si256(sc, _mm256_shuffle_epi8(t->byte1_low, _mm256_and_si256(p1, nib)));
+	sc = _mm256_and_si256(sc, _mm256_shuffle_epi8(t->byte2_high,
+						      _mm256_and_si256(_mm256_srli_epi16(x, 4), nib)));
+
+	// 0x80 where the byte has to be the 3rd or 4th of a sequence
+	__m256i third = _mm256_subs_epu8(p2, _mm256_set1_epi8((char)(0xe0 - 0x80)));
+	__m256i fourth = _mm256_subs_epu8(p3, _mm256_set1_epi8((char)(0xf0 - 0x80)));
+	__m256i must = _mm256_and_si256(_mm256_or_si256(third, fourth),
+					_mm256_set1_epi8((char)0x80));
+	return _mm256_xor_si256(must, sc);
+}
+
+
+STR_TARGET("avx2")
+static size_t utf8_check_avx2(const unsigned char *s, size_t size)
+{
+	// Nonzero when a sequence is still open at the end of a block
+	const __m256i open_max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+						  -1, -1, -1, -1, -1, -1, -1, -1,
+						  -1, -1, -1, -1, -1, -1, -1, -1,
+						  -1, -1, -1, -1, -1, (char)0xef,
+						  (char)0xdf, (char)0xbf);
+	struct utf8_avx2 t;
+	__m256i prev = _mm256_setzero_si256();
+	__m256i open = _mm256_setzero_si256();
+	size_t i = 0;
+
+	t.byte1_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte1_high));
+	t.byte1_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte1_low));
+	t.byte2_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)utf8_byte2_high));
+
+	while (i < size) {
+		__m256i x;
+		size_t n = 32;
+
+		if (size - i >= 32) {
+			x = _mm256_loadu_si256((const __m256i *)(s + i));
+		} else {
+			// Zero padding, so a sequence cut off by the end shows up
+			unsigned char buf[32] = { 0 };
+			n = size - i;
+			memcpy(buf, s + i, n);
+			x = _mm256_loadu_si256((const __m256i *)buf);
+		}
+
+		__m256i err = open;
+		if (_mm256_movemask_epi8(x))
+			err = utf8_errors_avx2(x, prev, &t);
+		if (!_mm256_testz_si256(err, err))
+			return utf8_check_resume(s, i, size);
+
+		open = _mm256_subs_epu8(x, open_max);
+		prev = x;
+		i += n;
+	}
+	if (!_mm256_testz_si256(open, open))
+		return utf8_check_resume(s, size, size);
+	return size;
+}
+
+
+STR_TARGET("avx512bw")
+static inline __mmask64 utf8_errors_avx512(__m512i x, __m512i prev, const struct utf8_avx512 *t)
+{
+	const __m512i nib = _mm512_set1_epi8(0x0f);
+	__m512i p1 = UTF8_PREV_AVX512(x, prev, 1);
+	__m512i p2 = UTF8_PREV_AVX512(x, prev, 2);
+	__m512i p3 = UTF8_PREV_AVX512(x, prev, 3);
+
+	__m512i sc = _mm512_shuffle_epi8(t->byte1_high,
+					 _mm512_and_si512(_mm512_srli_epi16(p1, 4), nib));
+	sc = _mm512_and_si512(sc, _mm512_shuffle_epi8(t->byte1_low, _mm512_and_si512(p1, nib)));
+	sc = _mm512_and_si512(sc, _mm512_shuffle_epi8(t->byte2_high,
+						      _mm512_and_si512(_mm512_srli_epi16(x, 4), nib)));
+
+	__m512i third = _mm512_subs_epu8(p2, _mm512_set1_epi8((char)(0xe0 - 0x80)));
+	__m512i fourth = _mm512_subs_epu8(p3, _mm512_set1_epi8((char)(0xf0 - 0x80)));
+	__m512i must = _mm512_and_si512(_mm512_or_si512(third, fourth),
+					_mm512_set1_epi8((char)0x80));
+	__m512i err = _mm512_xor_si512(must, sc);
+	return _mm512_test_epi8_mask(err, err);
+}
+
+
+STR_TARGET("avx512bw")
+static size_t utf8_check_avx512bw(const unsigned char *s, size_t size)
+{
+	// Bytes that still expect continuations in the last three positions
+	const __m512i open_max = _mm512_mask_blend_epi8(0xe000000000000000ull,
+		_mm512_set1_epi8(-1),
+		_mm512_set_epi64((long long)0xbfdfef0000000000ull, 0, 0, 0, 0, 0, 0, 0));
+	struct utf8_avx512 t;
+	__m512i prev = _mm512_setzero_si512();
+	__mmask64 open = 0;
+	size_t i = 0;
+
+	t.byte1_high = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)utf8_byte1_high));
+	t.byte1_low = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)utf8_byte1_low));
+	t.byte2_high = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)utf8_byte2_high));
+
+	while (i < size) {
+		size_t n = (size - i >= 64 ? 64 : size - i);
+		__m512i x = _mm512_maskz_loadu_epi8(~0ull >> (64 - n), s + i);
+
+		__mmask64 err = open;
+		if (_mm512_movepi8_mask(x))
+			err = utf8_errors_avx512(x, prev, &t);
+		if (err)
+			return utf8_check_resume(s, i, size);
+
+		__m512i o = _mm512_subs_epu8(x, open_max);
+		open = _mm512_test_epi8_mask(o, o);
+		prev = x;
+		i += n;
+	}
+	if (open)
+		return utf8_check_resume(s, size, size);
+	return size;
+}
+#endif
+
+
+/*	HEX AND BASE64	*/
+const char str_base64_digits[65] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// A table: random digits defeat the branches of a range check
+const unsigned char str_base64_values[256] = {
+	['+'] = 62, ['/'] = 63,
+	['0'] = 52, 53, 54, 55, 56, 57, 58, 59, 60, 61,
+	['A'] = 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+		18, 19, 20, 21, 22, 23, 24, 25,
+	['a'] = 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41,
+		42, 43, 44, 45, 46, 47, 48, 49, 50, 51,
+};
+
+// '+', '/', '0'..'9' | 'A'..'Z', 'a'..'z'
+const struct Str_charset str_base64_set = {
+	{ 0x03ff880000000000ull, 0x07fffffe07fffffeull, 0, 0 }
+};
+
+// '0'..'9' | 'A'..'F', 'a'..'f'
+const struct Str_charset str_hex_set = {
+	{ 0x03ff000000000000ull, 0x0000007e0000007eull, 0, 0 }
+};
+
+
+static void hex_encode_scalar(const unsigned char *src, size_t n, unsigned char *dst,
+			      const char *digits)
+{
+	for (size_t i = 0; i < n; i++) {
+		dst[2 * i] = (unsigned char)digits[src[i] >> 4];
+		dst[2 * i + 1] = (unsigned char)digits[src[i] & 0x0f];
+	}
+}
+
+
+// Byte i is written after digits 2i and 2i + 1 were read
+static void hex_decode_scalar(unsigned char *s, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		s[i] = (unsigned char)(str_hex_value(s[2 * i]) << 4 | str_hex_value(s[2 * i + 1]));
+}
+
+
+static void base64_encode_scalar(const unsigned char *src, size_t n, unsigned char *dst)
+{
+	for (size_t i = 0; i + 3 <= n; i += 3, dst += 4) {
+		uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+		dst[0] = (unsigned char)str_base64_digits[v >> 18];
+		dst[1] = (unsigned char)str_base64_digits[(v >> 12) & 63];
+		dst[2] = (unsigned char)str_base64_digits[(v >> 6) & 63];
+		dst[3] = (unsigned char)str_base64_digits[v & 63];
+	}
+}
+
+
+static void base64_decode_scalar(unsigned char *s, size_t n)
+{
+	unsigned char *dst = s;
+
+	for (size_t i = 0; i + 4 <= n; i += 4, dst += 3) {
+		uint32_t v = (uint32_t)str_base64_values[s[i]] << 18 |
+			     (uint32_t)str_base64_values[s[i + 1]] << 12 |
+			     (uint32_t)str_base64_values[s[i + 2]] << 6 | str_base64_values[s[i + 3]];
+		dst[0] = (unsigned char)(v >> 16);
+		dst[1] = (unsigned char)(v >> 8);
+		dst[2] = (unsigned char)v;
+	}
+}
+
+
+#ifdef STR_HAVE_X86_SIMD
+/*
+ * Without a byte shuffle the digit is built arithmetically: the nibble
+ * plus '0', plus the gap up to the letters for 10..15.
+ */
+STR_TARGET("sse2") STR_INLINE
+__m128i hex_digits_sse2(__m128i nib, __m128i gap)
+{
+	__m128i letter = _mm_cmpgt_epi8(nib, _mm_set1_epi8(9));
+	return _mm_add_epi8(_mm_add_epi8(nib, _mm_set1_epi8('0')), _mm_and_si128(letter, gap));
+}
+
+
+STR_TARGET("sse2")
+static void hex_encode_sse2(const unsigned char *src, size_t n, unsigned char *dst,
+			    const char *digits)
+{
+	const __m128i low = _mm_set1_epi8(0x0f);
+	const __m128i gap = _mm_set1_epi8((char)(digits[10] - '0' - 10));
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i hi = hex_digits_sse2(_mm_and_si128(_mm_srli_epi16(x, 4), low), gap);
+		__m128i lo = hex_digits_sse2(_mm_and_si128(x, low), gap);
+		_mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+	hex_encode_scalar(src + i, n - i, dst + 2 * i, digits);
+}
+
+
+// Digit values of 16 bytes of hex, see str_hex_value()
+STR_TARGET("sse2") STR_INLINE
+__m128i hex_values_sse2(__m128i x)
+{
+	__m128i letter = _mm_cmpgt_epi8(x, _mm_set1_epi8(0x40));
+	return _mm_add_epi8(_mm_and_si128(x, _mm_set1_epi8(0x0f)),
+			    _mm_and_si128(letter, _mm_set1_epi8(9)));
+}
+
+
+// Each 16-bit lane holds two digit values, the high nibble in its low byte
+STR_TARGET("sse2") STR_INLINE
+__m128i hex_pairs_sse2(__m128i v)
+{
+	return _mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, 4), _mm_set1_epi16(0xff)),
+			    _mm_srli_epi16(v, 8));
+}
+
+
+/*
+ * The 16 bytes decoded from 32 digits land at or before the digits, so
+ * decoding in place only overwrites what was already loaded.
+ */
+STR_TARGET("sse2")
+static void hex_decode_sse2(unsigned char *s, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i a = hex_values_sse2(_mm_loadu_si128((const __m128i *)(s + 2 * i)));
+		__m128i b = hex_values_sse2(_mm_loadu_si128((const __m128i *)(s + 2 * i + 16)));
+		_mm_storeu_si128((__m128i *)(s + i),
+				 _mm_packus_epi16(hex_pairs_sse2(a), hex_pairs_sse2(b)));
+	}
+	for (; i < n; i++)
+		s[i] = (unsigned char)(str_hex_value(s[2 * i]) << 4 | str_hex_value(s[2 * i + 1]));
+}
+
+
+STR_TARGET("avx2")
+static void hex_encode_avx2(const unsigned char *src, size_t n, unsigned char *dst,
+			    const char *digits)
+{
+	const __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)digits));
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+		__m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, low));
+		// The unpacks work per lane: bytes 0-7 and 16-23, then 8-15 and 24-31
+		__m256i a = _mm256_unpacklo_epi8(hi, lo);
+		__m256i b = _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	hex_encode_sse2(src + i, n - i, dst + 2 * i, digits);
+}
+
+
+// As hex_decode_sse2(), with pmaddubsw joining the digit pairs
+STR_TARGET("avx2")
+static void hex_decode_avx2(unsigned char *s, size_t n)
+{
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	const __m256i alpha = _mm256_set1_epi8(0x40);
+	const __m256i nine = _mm256_set1_epi8(9);
+	const __m256i weights = _mm256_set1_epi16(0x0110);
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(s + 2 * i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(s + 2 * i + 32));
+		a = _mm256_add_epi8(_mm256_and_si256(a, low),
+				    _mm256_and_si256(_mm256_cmpgt_epi8(a, alpha), nine));
+		b = _mm256_add_epi8(_mm256_and_si256(b, low),
+				    _mm256_and_si256(_mm256_cmpgt_epi8(b, alpha), nine));
+		__m256i x = _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights),
+						_mm256_maddubs_epi16(b, weights));
+		_mm256_storeu_si256((__m256i *)(s + i), _mm256_permute4x64_epi64(x, 0xd8));
+	}
+	for (; i < n; i++)
+		s[i] = (unsigned char)(str_hex_value(s[2 * i]) << 4 | str_hex_value(s[2 * i + 1]));
+}
+
+
+/*
+ * Base64 after Muła and Lemire, "Faster Base64 Encoding and Decoding
+ * Using AVX2 Instructions". Encoding spreads each 3 byte group over a
+ * 32-bit lane, moves the four 6-bit fields into their own bytes with two
+ * multiplies and maps them to digits with a shuffle of per-range offsets.
+ * Each lane takes 12 input bytes, so the loads overlap by 4 bytes and
+ * read 4 bytes past the 24 encoded per round. SSE2 lacks the byte shuffle
+ * and keeps the scalar loops.
+ */
+STR_TARGET("avx2")
+static void base64_encode_avx2(const unsigned char *src, size_t n, unsigned char *dst)
+{
+	const __m256i spread = _mm256_setr_epi8(
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+		1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	// Offsets to ASCII for the fields 26..51, 52..61, 62, 63 and 0..25
+	const __m256i offsets = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	size_t i = 0;
+
+	for (; i + 28 <= n; i += 24, dst += 32) {
+		__m256i x = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + i))),
+			_mm_loadu_si128((const __m128i *)(src + i + 12)), 1);
+		x = _mm256_shuffle_epi8(x, spread);
+
+		__m256i t0 = _mm256_and_si256(x, _mm256_set1_epi32(0x0fc0fc00));
+		__m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		__m256i t2 = _mm256_and_si256(x, _mm256_set1_epi32(0x003f03f0));
+		__m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		__m256i fields = _mm256_or_si256(t1, t3);
+
+		// 0 for 0..51, 1..12 for 52..63, then 13 for 0..25
+		__m256i range = _mm256_subs_epu8(fields, _mm256_set1_epi8(51));
+		__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), fields);
+		range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+		_mm256_storeu_si256((__m256i *)dst,
+				    _mm256_add_epi8(fields, _mm256_shuffle_epi8(offsets, range)));
+	}
+	base64_encode_scalar(src + i, n - i, dst);
+}
+
+
+/*
+ * Decoding adds an offset picked by the digit's high nibble, '/' sharing
+ * nibble 2 with '+' and getting its own slot, then joins the fields with
+ * pmaddubsw and pmaddwd and packs the 24 bytes of each round together.
+ * The 32 byte store ends before the next round's load.
+ */
+STR_TARGET("avx2")
+static void base64_decode_avx2(unsigned char *s, size_t n)
+{
+	const __m256i roll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	size_t i = 0, o = 0;
+
+	for (; i + 32 <= n; i += 32, o += 24) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), _mm256_set1_epi8(0x0f));
+		__m256i slash = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('/'));
+		x = _mm256_add_epi8(x, _mm256_shuffle_epi8(roll, _mm256_add_epi8(slash, hi)));
+
+		x = _mm256_maddubs_epi16(x, _mm256_set1_epi32(0x01400140));
+		x = _mm256_madd_epi16(x, _mm256_set1_epi32(0x00011000));
+		x = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(x, pack), lanes);
+		_mm256_storeu_si256((__m256i *)(s + o), x);
+	}
+	if (i < n) {
+		// Move the last digits next to the output to decode them in place
+		memmove(s + o, s + i, n - i);
+		base64_decode_scalar(s + o, n - i);
+	}
+}
+#endif
+
+
+/*	DISPATCH	*/
+static struct str_kernels kernels;
+static enum str_simd_level active_level;
+static enum str_simd_level cpu_level;
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+
+static void kernels_select(enum str_simd_level level)
+{
+	kernels.find = find_scalar;
+	kernels.rfind_bytes = rfind_bytes_scalar;
+	kernels.find_bytes = find_bytes_scalar;
+	kernels.count_byte = count_byte_scalar;
+	kernels.rfind = rfind_scalar;
+	kernels.case_flip = case_flip_scalar;
+	kernels.title_case = title_case_scalar;
+	kernels.reverse = reverse_scalar;
+	kernels.translate = translate_scalar;
+	kernels.ws_span = ws_span_scalar;
+	kernels.ws_rspan = ws_rspan_scalar;
+	kernels.squeeze_ws = squeeze_ws_scalar;
+	kernels.span = span_scalar;
+	kernels.remove_set = remove_set_scalar;
+	kernels.set_mask = set_mask_scalar;
+	kernels.utf8_check = utf8_check_scalar;
+	kernels.ascii_span = ascii_span_scalar;
+	kernels.utf8_count = utf8_count_scalar;
+	kernels.utf8_skip = utf8_skip_scalar;
+	kernels.hex_encode = hex_encode_scalar;
+	kernels.hex_decode = hex_decode_scalar;
+	kernels.base64_encode = base64_encode_scalar;
+	kernels.base64_decode = base64_decode_scalar;
+
+#ifdef STR_HAVE_X86_SIMD
+	if (level >= STR_SIMD_SSE2) {
+		kernels.find = find_sse2;
+		kernels.rfind_bytes = rfind_bytes_sse2;
+		kernels.find_bytes = find_bytes_sse2;
+		kernels.count_byte = count_byte_sse2;
+		kernels.rfind = rfind_sse2;
+		kernels.case_flip = case_flip_sse2;
+		kernels.reverse = reverse_sse2;
+		kernels.ws_span = ws_span_sse2;
+		kernels.ws_rspan = ws_rspan_sse2;
+		kernels.squeeze_ws = squeeze_ws_sse2;
+		kernels.ascii_span = ascii_span_sse2;
+		kernels.utf8_count = utf8_count_sse2;
+		kernels.hex_encode = hex_encode_sse2;
+		kernels.hex_decode = hex_decode_sse2;
+	}
+	if (level >= STR_SIMD_AVX2) {
+		kernels.find = find_avx2;
+		kernels.rfind_bytes = rfind_bytes_avx2;
+		kernels.find_bytes = find_bytes_avx2;
+		kernels.count_byte = count_byte_avx2;
+		kernels.rfind = rfind_avx2;
+		kernels.case_flip = case_flip_avx2;
+		kernels.title_case = title_case_avx2;
+		kernels.reverse = reverse_avx2;
+		kernels.translate = translate_avx2;
+		kernels.ws_span = ws_span_avx2;
+		kernels.ws_rspan = ws_rspan_avx2;
+		kernels.squeeze_ws = squeeze_ws_avx2;
+		kernels.span = span_avx2;
+		kernels.remove_set = remove_set_avx2;
+		kernels.set_mask = set_mask_avx2;
+		kernels.utf8_check = utf8_check_avx2;
+		kernels.ascii_span = ascii_span_avx2;
+		kernels.utf8_count = utf8_count_avx2;
+		kernels.utf8_skip = utf8_skip_avx2;
+		kernels.hex_encode = hex_encode_avx2;
+		kernels.hex_decode = hex_decode_avx2;
+		kernels.base64_encode = base64_encode_avx2;
+		kernels.base64_decode = base64_decode_avx2;
+	}
+	if (level >= STR_SIMD_AVX512BW) {
+		kernels.case_flip = case_flip_avx512bw;
+		kernels.title_case = title_case_avx512bw;
+		kernels.reverse = reverse_avx512bw;
+		kernels.translate = translate_avx512bw;
+		kernels.squeeze_ws = squeeze_ws_avx512bw;
+		kernels.span = span_avx512bw;
+		kernels.remove_set = remove_set_avx512bw;
+		kernels.set_mask = set_mask_avx512bw;
+		kernels.utf8_check = utf8_check_avx512bw;
+	}
+#endif
+	active_level = level;
+}
+
+
+static void dispatch_init(void)
+{
+	cpu_level = STR_SIMD_SCALAR;
+
+#ifdef STR_HAVE_X86_SIMD
+	compact_init();
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		cpu_level = STR_SIMD_SSE2;
+	if (__builtin_cpu_supports("avx2"))
+		cpu_level = STR_SIMD_AVX2;
+	if (cpu_level == STR_SIMD_AVX2 && __builtin_cpu_supports("avx512bw"))
+		cpu_level = STR_SIMD_AVX512BW;
+#endif
+	kernels_select(cpu_level);
+}
+
+
+const struct str_kernels *str_kernels_get(void)
+{
+	pthread_once(&dispatch_once, dispatch_init);
+	return &kernels;
+}
+
+
+enum str_simd_level str_simd_get_level(void)
+{
+	pthread_once(&dispatch_once, dispatch_init);
+	return active_level;
+}
+
+
+int str_simd_set_level(enum str_simd_level level)
+{
+	pthread_once(&dispatch_once, dispatch_init);
+	if (level > cpu_level)
+		return -ENOTSUP;
+
+	kernels_select(level);
+	return 0;
+}
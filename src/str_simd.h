@@ -0,0 +1,503 @@
+/*
+ * str_simd.h - Internal SIMD kernels and CPU dispatch for strutil.
+ *
+ * Nothing in here is part of the public API. The kernels work on raw byte
+ * ranges with known lengths and never look at the terminating NUL; the
+ * public functions in strutil.c take the Str lock and call into them.
+ *
+ * Kernels are picked once, on first use, from the best instruction set the
+ * CPU supports (see str_simd_set_level() to override that choice).
+ */
+
+
+#ifndef _STR_SIMD_H_
+#define _STR_SIMD_H_
+
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "strutil.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  #define STR_HAVE_X86_SIMD 1
+  #define STR_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+/*
+ * Precomputed state of the Two-Way string matching algorithm. Searching
+ * with it takes linear time and constant extra space for any input, which
+ * makes it the fallback when the SIMD candidate filter degenerates.
+ */
+struct str_twoway {
+	size_t	ms;		/* critical factorization position */
+	size_t	period;
+	size_t	mem0;		/* nonzero when the needle is periodic */
+	bool	icase;		/* compare ASCII case folded bytes */
+	size_t	shift[256];	/* bad character shift on the needle's last byte */
+};
+
+
+/*
+ * A needle prepared for searching. Compiled patterns own a copy of the
+ * needle and carry the Horspool and Two-Way tables; the ad hoc patterns
+ * built on the stack by str_find() and friends only point at the caller's
+ * bytes and leave the tables unset (compiled == false).
+ */
+struct Str_pattern {
+	const unsigned char *needle;
+	size_t	size;
+	size_t	anchor;		/* offset of the second filter byte */
+	size_t	ranchor;	/* the same for the backward search */
+	unsigned int flags;
+	bool	ww_left;	/* whole word: no word byte may precede */
+	bool	ww_right;	/* whole word: no word byte may follow */
+	bool	icase;		/* ASCII letters match either case */
+	bool	compiled;
+	size_t	skip[256];	/* Horspool shift per byte */
+	struct str_twoway tw;
+};
+
+
+/*
+ * A prepared byte map, see str_table_compile(). A row is the 16 bytes
+ * that share a high nibble; the SIMD kernels only visit the rows the map
+ * changes, with one 16-byte shuffle each, so the usual tables touching a
+ * handful of bytes cost a few instructions per vector.
+ */
+struct Str_table {
+	unsigned char map[256];
+	unsigned int nrows;
+	unsigned char rows[16];		/* high nibbles of the changed rows */
+	unsigned char delta[16][16];	/* map[b] ^ b, by low nibble, per changed row */
+};
+
+
+/*
+ * A byte set with the nibble tables of the SIMD membership test worked
+ * out in advance, for the set_mask kernel.
+ */
+struct str_set_prepared {
+	struct Str_charset bits;
+	unsigned char lo[16];
+	unsigned char hi[16];
+};
+
+
+// Flags that change what a pattern matches
+#define STR_SEARCH_FLAGS	(STR_WHOLE_WORD | STR_ICASE)
+
+
+// ASCII lower case of every byte, all other bytes map to themselves
+extern const unsigned char str_fold_table[256];
+
+
+static inline unsigned char str_fold(unsigned char c)
+{
+	return str_fold_table[c];
+}
+
+
+// Case insensitive equality of two byte ranges
+static inline bool str_icase_eq(const unsigned char *a, const unsigned char *b,
+				size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (str_fold_table[a[i]] != str_fold_table[b[i]])
+			return false;
+	}
+	return true;
+}
+
+
+// Default word boundaries of str_to_title_case()
+extern const struct Str_charset str_title_boundaries;
+
+
+static inline bool str_charset_has(const struct Str_charset *set, unsigned char c)
+{
+	return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+
+/*
+ * Bytes that make up words for STR_WHOLE_WORD: ASCII letters, digits,
+ * '_' and every byte of a multibyte UTF-8 sequence.
+ */
+static inline bool str_is_word_byte(unsigned char c)
+{
+	return ((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') ||
+		c == '_' || c >= 0x80);
+}
+
+
+/*
+ * Whole word test for a match at @pos of @hay. A side is only checked
+ * when the needle has a word byte there, so "-x" may follow a letter.
+ */
+static inline bool str_ww_ok(const unsigned char *hay, size_t hay_size,
+			     size_t pos, const struct Str_pattern *pat)
+{
+	if (pat->ww_left && pos > 0 && str_is_word_byte(hay[pos - 1]))
+		return false;
+	if (pat->ww_right && pos + pat->size < hay_size &&
+	    str_is_word_byte(hay[pos + pat->size]))
+		return false;
+	return true;
+}
+
+
+// Code point str_utf8_decode() reports for an ill-formed sequence
+#define STR_UTF8_BAD	0xffffffffu
+
+
+/*
+ * Decode the UTF-8 sequence at @s, which has @size > 0 bytes left, into
+ * *cp. For an ill-formed sequence *cp is STR_UTF8_BAD and the length is
+ * that of its maximal subpart: the bytes that still fit some valid
+ * sequence, or just the first byte.
+ *
+ * Return: Number of bytes used, at least 1.
+ */
+static inline size_t str_utf8_decode(const unsigned char *s, size_t size, uint32_t *cp)
+{
+	unsigned char c = s[0];
+	unsigned char lo = 0x80, hi = 0xbf;
+	uint32_t v;
+	size_t n;
+
+	if (c < 0x80) {
+		*cp = c;
+		return 1;
+	} else if (c < 0xc2) {
+		// Continuation byte, or the lead of an overlong 2 byte form
+		*cp = STR_UTF8_BAD;
+		return 1;
+	} else if (c < 0xe0) {
+		n = 2;
+		v = c & 0x1f;
+	} else if (c < 0xf0) {
+		n = 3;
+		v = c & 0x0f;
+		if (c == 0xe0)
+			lo = 0xa0;	/* overlong */
+		else if (c == 0xed)
+			hi = 0x9f;	/* surrogates */
+	} else if (c < 0xf5) {
+		n = 4;
+		v = c & 0x07;
+		if (c == 0xf0)
+			lo = 0x90;	/* overlong */
+		else if (c == 0xf4)
+			hi = 0x8f;	/* above U+10FFFF */
+	} else {
+		*cp = STR_UTF8_BAD;
+		return 1;
+	}
+
+	for (size_t i = 1; i < n; i++) {
+		if (i >= size || s[i] < lo || s[i] > hi) {
+			*cp = STR_UTF8_BAD;
+			return i;
+		}
+		v = v << 6 | (s[i] & 0x3f);
+		lo = 0x80;
+		hi = 0xbf;
+	}
+	*cp = v;
+	return n;
+}
+
+
+// Write @cp, at most U+10FFFF, as UTF-8; returns the number of bytes
+static inline size_t str_utf8_encode(uint32_t cp, unsigned char *out)
+{
+	if (cp < 0x80) {
+		out[0] = (unsigned char)cp;
+		return 1;
+	} else if (cp < 0x800) {
+		out[0] = (unsigned char)(0xc0 | cp >> 6);
+		out[1] = (unsigned char)(0x80 | (cp & 0x3f));
+		return 2;
+	} else if (cp < 0x10000) {
+		out[0] = (unsigned char)(0xe0 | cp >> 12);
+		out[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+		out[2] = (unsigned char)(0x80 | (cp & 0x3f));
+		return 3;
+	}
+	out[0] = (unsigned char)(0xf0 | cp >> 18);
+	out[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3f));
+	out[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+	out[3] = (unsigned char)(0x80 | (cp & 0x3f));
+	return 4;
+}
+
+
+// Code points between the samples of a Str_index
+#define STR_INDEX_STRIDE	256
+
+/*
+ * offset[k] is the byte offset of code point k * STR_INDEX_STRIDE, for
+ * the first @count samples. Once @complete, there are no more and
+ * @length holds the number of code points.
+ */
+struct Str_index {
+	size_t	*offset;
+	size_t	count;
+	size_t	alloc;
+	bool	complete;
+	size_t	length;
+};
+
+
+void str_index_free(struct Str_index *ix);
+
+
+// Forget the samples, but keep the memory for the next index
+static inline void str_index_reset(struct Str *self)
+{
+	if (self->index) {
+		self->index->count = 0;
+		self->index->complete = false;
+	}
+}
+
+
+// Buffer management shared by the source files, see strutil.c
+int str_reserve(struct Str *self, size_t size);
+void str_shrink(struct Str *self);
+
+
+/*
+ * Drop everything cached about the data of @self. Every function that
+ * changes the data calls this, or str_index_reset() when the UTF-8
+ * state cannot change. The caller must hold self->lock.
+ */
+static inline void str_data_changed(struct Str *self)
+{
+	self->utf8 = STR_UTF8_UNKNOWN;
+	str_index_reset(self);
+}
+
+
+// The base64 alphabet of RFC 4648, without the '=' padding
+extern const char str_base64_digits[65];
+extern const struct Str_charset str_base64_set;
+extern const struct Str_charset str_hex_set;
+
+
+// Value of a digit in str_base64_digits, 0 for other bytes
+extern const unsigned char str_base64_values[256];
+
+
+// Value of a hex digit: 'A'..'F' and 'a'..'f' have bit 0x40 set
+static inline unsigned int str_hex_value(unsigned char c)
+{
+	return (c & 0x0fu) + (c >> 6) * 9u;
+}
+
+
+/*
+ * Unicode case mapping tables, generated into str_case_tables.c by
+ * tools/gen_case_tables.py. The record of code point cp is
+ *
+ *	str_case_records[str_case_stage2[str_case_stage1[cp >> 7]][cp & 127]]
+ *
+ * for cp below str_case_limit, and maps to itself above. Each record
+ * holds, per STR_CASE_* kind, what to add to cp, or STR_CASE_SPECIAL
+ * when the mapping has several code points; those are listed in
+ * str_case_special, sorted by code point and kind.
+ */
+#define STR_CASE_UPPER		0
+#define STR_CASE_LOWER		1
+#define STR_CASE_TITLE		2
+#define STR_CASE_SHIFT		7
+#define STR_CASE_SPECIAL	0x200000
+
+struct str_case_special {
+	uint32_t cp;
+	unsigned int kind;
+	uint32_t map[3];	/* zero padded */
+};
+
+extern const uint32_t str_case_limit;
+extern const uint8_t str_case_stage1[];
+extern const uint8_t str_case_stage2[][1 << STR_CASE_SHIFT];
+extern const int32_t str_case_records[][3];
+extern const size_t str_case_nspecial;
+extern const struct str_case_special str_case_special[];
+
+
+/*
+ * Sorted, disjoint ranges of the code points that extend the grapheme
+ * cluster before them, generated into str_grapheme_tables.c by
+ * tools/gen_grapheme_tables.py.
+ */
+extern const size_t str_extend_nranges;
+extern const uint32_t str_extend_ranges[][2];
+
+
+// Largest byte set the rfind_bytes kernel accepts
+#define STR_SMALL_SET_MAX	8
+
+
+/*
+ * Kernel table, filled in by the dispatcher. The find kernel checks every
+ * position from @start on with a two byte filter, on the needle's first
+ * byte and on the byte at pat->anchor (normally the last one), plus the
+ * whole word test; it returns the offset, or STR_NPOS with *bail set to
+ * the offset from which a worst-case safe search has to continue (STR_NPOS
+ * in *bail means there is definitely no match). It requires
+ * 2 <= pat->size <= hay_size.
+ *
+ * rfind_bytes returns the last offset below @end holding one of the
+ * 1..STR_SMALL_SET_MAX bytes in @set, or STR_NPOS; find_bytes the first
+ * such offset from @start on, below @size.
+ *
+ * rfind is the backward counterpart of find: it checks the match offsets
+ * from @last down to 0, filtering on the needle's last byte and on the
+ * byte at pat->ranchor, and ignores pat->flags. When it gives up, *bail is
+ * the number of offsets (0 .. *bail - 1) still left to search.
+ *
+ * count_byte returns how many of the @size bytes at @hay equal @c.
+ *
+ * case_flip toggles the ASCII case bit (0x20) of every byte in the range
+ * @first .. @first + 25: 'a' upper-cases, 'A' lower-cases.
+ *
+ * title_case upper-cases every ASCII letter that follows a byte in @set,
+ * or starts the range when @start is set, and lower-cases all other
+ * letters. It returns whether the last byte is in @set, which is the
+ * @start for the bytes after it.
+ *
+ * reverse reverses the @size bytes at @s in place.
+ *
+ * translate replaces every byte b of the range with t->map[b].
+ *
+ * ws_span and ws_rspan count the whitespace bytes (' ', '\t' .. '\r') at
+ * the start and at the end of the range. squeeze_ws turns every run of
+ * whitespace into a single ' ', in place, and returns the new size.
+ *
+ * span returns the first offset whose membership in @set differs from
+ * @in, or @size. remove_set drops the bytes in @set, in place, and
+ * returns the new size. set_mask has bit i set for every byte s[i] of the
+ * first @n, 1..64, that is not in the prepared @set.
+ *
+ * utf8_check returns the offset of the first ill-formed UTF-8 sequence,
+ * or @size when there is none. ascii_span returns the offset of the first
+ * byte with the high bit set, or @size.
+ *
+ * utf8_count counts the bytes that are not UTF-8 continuation bytes, the
+ * code points of valid text. utf8_skip returns the offset of the one
+ * with index @n among them, or STR_NPOS when there are not that many.
+ *
+ * hex_encode writes the two digits of each of the @n bytes at @src to
+ * @dst, taken from the 16 @digits. base64_encode turns @n bytes, a
+ * multiple of 3, into 4 * @n / 3 digits. The decoders work in place and
+ * trust their input: hex_decode turns the 2 * @n hex digits at @s into
+ * @n bytes, base64_decode the @n base64 digits, a multiple of 4, into
+ * 3 * @n / 4 bytes.
+ */
+struct str_kernels {
+	size_t (*find)(const unsigned char *hay, size_t hay_size, size_t start,
+		       const struct Str_pattern *pat, size_t *bail);
+	size_t (*rfind_bytes)(const unsigned char *hay, size_t end,
+			      const unsigned char *set, size_t nset);
+	size_t (*find_bytes)(const unsigned char *hay, size_t size, size_t start,
+			     const unsigned char *set, size_t nset);
+	size_t (*count_byte)(const unsigned char *hay, size_t size, unsigned char c);
+	size_t (*rfind)(const unsigned char *hay, size_t hay_size, size_t last,
+			const struct Str_pattern *pat, size_t *bail);
+	void (*case_flip)(unsigned char *s, size_t size, unsigned char first);
+	bool (*title_case)(unsigned char *s, size_t size, const struct Str_charset *set,
+			   bool start);
+	void (*reverse)(unsigned char *s, size_t size);
+	void (*translate)(unsigned char *s, size_t size, const struct Str_table *t);
+	size_t (*ws_span)(const unsigned char *s, size_t size);
+	size_t (*ws_rspan)(const unsigned char *s, size_t size);
+	size_t (*squeeze_ws)(unsigned char *s, size_t size);
+	size_t (*span)(const unsigned char *s, size_t size, const struct Str_charset *set,
+		       bool in);
+	size_t (*remove_set)(unsigned char *s, size_t size, const struct Str_charset *set);
+	uint64_t (*set_mask)(const unsigned char *s, size_t n,
+			     const struct str_set_prepared *set);
+	size_t (*utf8_check)(const unsigned char *s, size_t size);
+	size_t (*ascii_span)(const unsigned char *s, size_t size);
+	size_t (*utf8_count)(const unsigned char *s, size_t size);
+	size_t (*utf8_skip)(const unsigned char *s, size_t size, size_t n);
+	void (*hex_encode)(const unsigned char *src, size_t n, unsigned char *dst,
+			   const char *digits);
+	void (*hex_decode)(unsigned char *s, size_t n);
+	void (*base64_encode)(const unsigned char *src, size_t n, unsigned char *dst);
+	void (*base64_decode)(unsigned char *s, size_t n);
+};
+
+
+const struct str_kernels *str_kernels_get(void);
+
+void str_twoway_prepare(struct str_twoway *tw, const unsigned char *needle,
+			size_t needle_size, bool icase);
+
+size_t str_twoway_search(const struct str_twoway *tw,
+			 const unsigned char *hay, size_t hay_size,
+			 const unsigned char *needle, size_t needle_size);
+
+/*
+ * Same as str_twoway_search(), but on @hay read back to front: @needle
+ * and @tw have to be the reversed needle, and the result is an offset in
+ * the reversed haystack.
+ */
+size_t str_twoway_rsearch(const struct str_twoway *tw,
+			  const unsigned char *hay, size_t hay_size,
+			  const unsigned char *needle, size_t needle_size);
+
+/*
+ * str_pattern_init - Prepare an ad hoc pattern that borrows @needle.
+ *
+ * Only the cheap parts (anchor, flags) are set up, so this is meant for
+ * single searches; str_pattern_compile() builds the full tables.
+ */
+void str_pattern_init(struct Str_pattern *pat, const char *needle,
+		      size_t size, unsigned int flags);
+
+/*
+ * str_pattern_find - Find the first match of @pat in a buffer.
+ *
+ * Return: Offset of the match in @hay, or STR_NPOS if there is none.
+ */
+size_t str_pattern_find(const struct Str_pattern *pat, const char *hay,
+			size_t hay_size);
+
+/*
+ * str_pattern_find_from - Find the first match of @pat at or after @start.
+ *
+ * Unlike searching hay + start, the bytes before @start still count as
+ * context for the whole word test.
+ *
+ * Return: Offset of the match in @hay, or STR_NPOS if there is none.
+ */
+size_t str_pattern_find_from(const struct Str_pattern *pat, const char *hay,
+			     size_t hay_size, size_t start);
+
+/*
+ * str_pattern_rfind - Find the last match of @pat starting at or before
+ * @last. Whole word and case flags are not supported here.
+ *
+ * Return: Offset of the match in @hay, or STR_NPOS if there is none.
+ */
+size_t str_pattern_rfind(const struct Str_pattern *pat, const char *hay,
+			 size_t hay_size, size_t last);
+
+// Fills in @t for the 256 entry @map
+void str_table_prepare(struct Str_table *t, const unsigned char *map);
+
+// Fills in @p for @set
+void str_set_prepare(struct str_set_prepared *p, const struct Str_charset *set);
+
+/*
+ * str_mem_find - Find the first occurrence of a byte string in a buffer.
+ *
+ * Return: Offset of the match in @hay, or STR_NPOS if there is none.
+ */
+size_t str_mem_find(const char *hay, size_t hay_size,
+		    const char *needle, size_t needle_size);
+#endif
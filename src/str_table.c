@@ -0,0 +1,49 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+void str_table_prepare(struct Str_table *t, const unsigned char *map)
+{
+	memcpy(t->map, map, 256);
+	t->nrows = 0;
+
+	for (unsigned int h = 0; h < 16; h++) {
+		unsigned char delta[16];
+		bool changed = false;
+
+		for (unsigned int l = 0; l < 16; l++) {
+			unsigned int b = h << 4 | l;
+			delta[l] = (unsigned char)(map[b] ^ b);
+			changed |= delta[l] != 0;
+		}
+		if (changed) {
+			t->rows[t->nrows] = (unsigned char)h;
+			memcpy(t->delta[t->nrows], delta, 16);
+			t->nrows++;
+		}
+	}
+}
+
+
+struct Str_table *str_table_compile(const uint8_t table[256])
+{
+	if (!table) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct Str_table *t = (struct Str_table *)malloc(sizeof(struct Str_table));
+	if (!t)
+		return NULL;
+
+	str_table_prepare(t, table);
+	return t;
+}
+
+
+void str_table_free(struct Str_table *table)
+{
+	free(table);
+}
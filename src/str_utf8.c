@@ -0,0 +1,665 @@
+#include "str_simd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+
+
+// U+FFFD REPLACEMENT CHARACTER
+static const unsigned char utf8_replacement[3] = { 0xef, 0xbf, 0xbd };
+
+
+bool str_utf8_validate(struct Str *self)
+{
+	if (!self)
+		return false;
+
+	pthread_mutex_lock(&self->lock);
+	if (self->utf8 == STR_UTF8_UNKNOWN) {
+		const struct str_kernels *k = str_kernels_get();
+		size_t size = (self->data ? self->size : 0);
+		bool valid = k->utf8_check((const unsigned char *)self->data, size) == size;
+		self->utf8 = (valid ? STR_UTF8_VALID : STR_UTF8_INVALID);
+	}
+	bool ret = (self->utf8 == STR_UTF8_VALID);
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+/*
+ * Walk the ill-formed sequences of @s from @first, the first of them.
+ * Valid stretches in between are skipped with the kernel. With @out the
+ * repaired text from @first on is written there. Returns the number of
+ * replacements; *grow is what they add to the size.
+ */
+static size_t utf8_repair_pass(const struct str_kernels *k, const unsigned char *s,
+			       size_t size, size_t first, unsigned char *out, size_t *grow)
+{
+	size_t count = 0;
+	size_t i = first;
+	uint32_t cp;
+
+	*grow = 0;
+	while (i < size) {
+		size_t n = str_utf8_decode(s + i, size - i, &cp);
+		size_t ok = n + k->utf8_check(s + i + n, size - i - n);
+
+		count++;
+		*grow += 3 - n;
+		if (out) {
+			memcpy(out, utf8_replacement, 3);
+			memcpy(out + 3, s + i + n, ok - n);
+			out += 3 + ok - n;
+		}
+		i += ok;
+	}
+	return count;
+}
+
+
+int str_utf8_repair(struct Str *self)
+{
+	if (!self)
+		return -1;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data || self->utf8 == STR_UTF8_VALID) {
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	const struct str_kernels *k = str_kernels_get();
+	const unsigned char *s = (const unsigned char *)self->data;
+	size_t first = k->utf8_check(s, self->size);
+	if (first == self->size) {
+		self->utf8 = STR_UTF8_VALID;
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	// A replacement is never shorter than the bytes it stands for
+	size_t grow;
+	size_t count = utf8_repair_pass(k, s, self->size, first, NULL, &grow);
+	if (grow > MAX_STRING_SIZE - self->size) {
+		pthread_mutex_unlock(&self->lock);
+		return -E2BIG;
+	}
+
+	size_t new_size = self->size + grow;
+	char *buf = (char *)malloc(new_size + 1);
+	if (!buf) {
+		pthread_mutex_unlock(&self->lock);
+		return -ENOMEM;
+	}
+
+	memcpy(buf, s, first);
+	utf8_repair_pass(k, s, self->size, first, (unsigned char *)buf + first, &grow);
+	buf[new_size] = '\0';
+
+	free(self->data);
+	self->data = buf;
+	self->size = new_size;
+	self->capacity = new_size;
+	self->utf8 = STR_UTF8_VALID;
+	str_index_reset(self);
+
+	pthread_mutex_unlock(&self->lock);
+	return (count > INT_MAX ? INT_MAX : (int)count);
+}
+
+
+/*	CASE MAPPING	*/
+
+// Most bytes one character maps to: three code points of four bytes
+#define CASE_MAX_OUT	12
+
+struct case_ctx {
+	const struct str_kernels *k;
+	unsigned int kind;		/* STR_CASE_* */
+	bool turkic;
+	unsigned char stop[2];		/* ASCII letters with Turkic rules */
+	size_t nstop;
+};
+
+
+// The @kind mapping of @cp, up to three code points; returns how many
+static size_t case_lookup(uint32_t cp, unsigned int kind, uint32_t map[3])
+{
+	int32_t d = 0;
+
+	if (cp < str_case_limit) {
+		uint8_t blk = str_case_stage1[cp >> STR_CASE_SHIFT];
+		uint8_t rec = str_case_stage2[blk][cp & ((1u << STR_CASE_SHIFT) - 1)];
+		d = str_case_records[rec][kind];
+	}
+	if (d != STR_CASE_SPECIAL) {
+		map[0] = (uint32_t)((int32_t)cp + d);
+		return 1;
+	}
+
+	size_t lo = 0, hi = str_case_nspecial;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		const struct str_case_special *sp = &str_case_special[mid];
+		if (sp->cp < cp || (sp->cp == cp && sp->kind < kind))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	const struct str_case_special *sp = &str_case_special[lo];
+	size_t n = 0;
+	while (n < 3 && sp->map[n])
+		map[n] = sp->map[n], n++;
+	return n;
+}
+
+
+/*
+ * Map the character at @s, with @size bytes left, into @out. Title case
+ * picks the title or the lower case mapping by *start, and clears it.
+ * Returns the bytes used; *out_size is set to the bytes written.
+ */
+static size_t case_char(const struct case_ctx *c, const unsigned char *s, size_t size,
+			bool *start, unsigned char *out, size_t *out_size)
+{
+	uint32_t cp, map[3];
+	size_t used = str_utf8_decode(s, size, &cp);
+	unsigned int kind = c->kind;
+
+	if (kind == STR_CASE_TITLE)
+		kind = (*start ? STR_CASE_TITLE : STR_CASE_LOWER);
+	*start = false;
+
+	if (cp == STR_UTF8_BAD) {
+		memcpy(out, s, used);
+		*out_size = used;
+		return used;
+	}
+
+	size_t n = 1;
+	if (c->turkic && kind != STR_CASE_LOWER && cp == 'i') {
+		map[0] = 0x130;
+	} else if (c->turkic && kind == STR_CASE_LOWER && cp == 0x130) {
+		map[0] = 'i';
+	} else if (c->turkic && kind == STR_CASE_LOWER && cp == 'I') {
+		// The dot of I + U+0307 goes into the i
+		if (size >= 3 && s[1] == 0xcc && s[2] == 0x87) {
+			map[0] = 'i';
+			used = 3;
+		} else {
+			map[0] = 0x131;
+		}
+	} else {
+		n = case_lookup(cp, kind, map);
+	}
+
+	size_t w = 0;
+	for (size_t i = 0; i < n; i++)
+		w += str_utf8_encode(map[i], out + w);
+	*out_size = w;
+	return used;
+}
+
+
+/*
+ * Map an ASCII run from @src to @dst, which may be the same. With no @dst
+ * only the title case state is carried over.
+ */
+static void case_ascii(const struct case_ctx *c, unsigned char *dst,
+		       const unsigned char *src, size_t n, bool *start)
+{
+	if (!n)
+		return;
+	if (!dst) {
+		if (c->kind == STR_CASE_TITLE)
+			*start = str_charset_has(&str_title_boundaries, src[n - 1]);
+		return;
+	}
+
+	if (dst != src)
+		memcpy(dst, src, n);
+	if (c->kind == STR_CASE_UPPER)
+		c->k->case_flip(dst, n, 'a');
+	else if (c->kind == STR_CASE_LOWER)
+		c->k->case_flip(dst, n, 'A');
+	else
+		*start = c->k->title_case(dst, n, &str_title_boundaries, *start);
+}
+
+
+/*
+ * A walk over s[pos..size) that writes the mapped text to out[total..].
+ * With @out == @s the text is mapped in place, which ends before the
+ * first character whose mapping has another length; @pos tells where.
+ * Otherwise @out is a malloc'ed buffer of @cap bytes that grows as
+ * needed, and @err is set when it cannot.
+ */
+struct case_walk {
+	const struct case_ctx *c;
+	const unsigned char *s;
+	size_t size;
+	size_t pos;
+	unsigned char *out;
+	size_t total;
+	size_t cap;
+	int err;
+	bool start;
+};
+
+
+static bool case_walk_reserve(struct case_walk *cw, size_t n)
+{
+	if (cw->out == cw->s || (cw->out && n <= cw->cap - cw->total))
+		return true;
+
+	size_t left = cw->size - cw->pos;
+	size_t cap = cw->total + n + left + left / 8 + CASE_MAX_OUT;
+	if (cap < cw->cap + cw->cap / 2)
+		cap = cw->cap + cw->cap / 2;
+	if (cap > MAX_STRING_SIZE) {
+		if (cw->total + n > MAX_STRING_SIZE) {
+			cw->err = -E2BIG;
+			return false;
+		}
+		cap = MAX_STRING_SIZE;
+	}
+
+	unsigned char *p = (unsigned char *)realloc(cw->out, cap + 1);
+	if (!p) {
+		cw->err = -ENOMEM;
+		return false;
+	}
+	cw->out = p;
+	cw->cap = cap;
+	return true;
+}
+
+
+// One character past the ASCII kernels; false where the walk has to end
+static bool case_walk_char(struct case_walk *cw)
+{
+	unsigned char buf[CASE_MAX_OUT];
+	bool start = cw->start;
+	size_t w;
+	size_t used = case_char(cw->c, cw->s + cw->pos, cw->size - cw->pos, &start, buf, &w);
+
+	if (cw->out == cw->s && w != used)
+		return false;
+	if (!case_walk_reserve(cw, w))
+		return false;
+	memcpy(cw->out + cw->total, buf, w);
+	cw->start = start;
+	cw->total += w;
+	cw->pos += used;
+	return true;
+}
+
+
+static bool case_walk_ascii(struct case_walk *cw, size_t end)
+{
+	size_t n = end - cw->pos;
+
+	if (!case_walk_reserve(cw, n))
+		return false;
+	case_ascii(cw->c, cw->out + cw->total, cw->s + cw->pos, n, &cw->start);
+	cw->total += n;
+	cw->pos = end;
+	return true;
+}
+
+
+static void case_walk(struct case_walk *cw)
+{
+	const struct case_ctx *c = cw->c;
+	const unsigned char *s = cw->s;
+
+	while (cw->pos < cw->size) {
+		size_t end = cw->pos + c->k->ascii_span(s + cw->pos, cw->size - cw->pos);
+
+		// The letters with Turkic rules split the ASCII run
+		while (c->nstop && cw->pos < end) {
+			size_t t = c->k->find_bytes(s, end, cw->pos, c->stop, c->nstop);
+			if (t == STR_NPOS)
+				break;
+			if (!case_walk_ascii(cw, t) || !case_walk_char(cw))
+				return;
+		}
+		if (cw->pos < end && !case_walk_ascii(cw, end))
+			return;
+
+		// Characters outside ASCII often come in a row
+		while (cw->pos < cw->size && s[cw->pos] >= 0x80) {
+			if (!case_walk_char(cw))
+				return;
+		}
+	}
+}
+
+
+static int utf8_case(struct Str *self, unsigned int kind, unsigned int flags)
+{
+	if (!self || !self->data)
+		return -1;
+	else if (flags & ~STR_TURKIC)
+		return -EINVAL;
+
+	struct case_ctx c = { .kind = kind, .turkic = (flags & STR_TURKIC) != 0 };
+	if (c.turkic) {
+		if (kind != STR_CASE_LOWER)
+			c.stop[c.nstop++] = 'i';
+		if (kind != STR_CASE_UPPER)
+			c.stop[c.nstop++] = 'I';
+	}
+
+	pthread_mutex_lock(&self->lock);
+	c.k = str_kernels_get();
+
+	/*
+	 * Well-formed characters map to well-formed ones and ill-formed
+	 * bytes are copied, so self->utf8 stays right.
+	 */
+	unsigned char *s = (unsigned char *)self->data;
+	struct case_walk cw = { .c = &c, .s = s, .size = self->size, .out = s, .start = true };
+	case_walk(&cw);
+	if (cw.pos == cw.size) {
+		pthread_mutex_unlock(&self->lock);
+		return 0;
+	}
+
+	// The rest goes to a new buffer, after a copy of what is done
+	size_t head = cw.pos;
+	cw.out = NULL;
+	cw.cap = 0;
+	if (case_walk_reserve(&cw, head)) {
+		memcpy(cw.out, s, head);
+		cw.total = head;
+		case_walk(&cw);
+	}
+	if (cw.err) {
+		free(cw.out);
+		pthread_mutex_unlock(&self->lock);
+		return cw.err;
+	}
+
+	cw.out[cw.total] = '\0';
+	free(self->data);
+	self->data = (char *)cw.out;
+	self->size = cw.total;
+	self->capacity = cw.cap;
+	str_index_reset(self);
+
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+int str_utf8_to_upper(struct Str *self, unsigned int flags)
+{
+	return utf8_case(self, STR_CASE_UPPER, flags);
+}
+
+
+int str_utf8_to_lower(struct Str *self, unsigned int flags)
+{
+	return utf8_case(self, STR_CASE_LOWER, flags);
+}
+
+
+int str_utf8_to_title_case(struct Str *self, unsigned int flags)
+{
+	return utf8_case(self, STR_CASE_TITLE, flags);
+}
+
+
+/*	POSITIONS	*/
+
+void str_index_free(struct Str_index *ix)
+{
+	if (ix) {
+		free(ix->offset);
+		free(ix);
+	}
+}
+
+
+void str_touch(struct Str *self)
+{
+	if (!self)
+		return;
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	pthread_mutex_unlock(&self->lock);
+}
+
+
+size_t str_utf8_length(struct Str *self)
+{
+	if (!self)
+		return 0;
+
+	pthread_mutex_lock(&self->lock);
+	size_t n = 0;
+	if (self->data) {
+		if (self->index && self->index->complete)
+			n = self->index->length;
+		else
+			n = str_kernels_get()->utf8_count((const unsigned char *)self->data,
+							   self->size);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return n;
+}
+
+
+/*
+ * Add samples until there is one for code point @k * STR_INDEX_STRIDE or
+ * the text ends. Returns false when out of memory, leaving the samples
+ * taken so far.
+ */
+static bool index_extend(struct Str *self, const struct str_kernels *k, size_t want)
+{
+	struct Str_index *ix = self->index;
+	const unsigned char *s = (const unsigned char *)self->data;
+	size_t size = self->size;
+
+	while (ix->count <= want && !ix->complete) {
+		size_t off;
+		if (ix->count == 0) {
+			off = k->utf8_skip(s, size, 0);
+		} else {
+			size_t last = ix->offset[ix->count - 1];
+			off = k->utf8_skip(s + last, size - last, STR_INDEX_STRIDE);
+			if (off != STR_NPOS)
+				off += last;
+		}
+
+		if (off == STR_NPOS) {
+			size_t last = (ix->count ? ix->offset[ix->count - 1] : size);
+			ix->length = (ix->count ? (ix->count - 1) * STR_INDEX_STRIDE : 0) +
+				     k->utf8_count(s + last, size - last);
+			ix->complete = true;
+			break;
+		}
+
+		if (ix->count == ix->alloc) {
+			size_t alloc = (ix->alloc ? 2 * ix->alloc : 16);
+			size_t *p = (size_t *)realloc(ix->offset, alloc * sizeof(*p));
+			if (!p)
+				return false;
+			ix->offset = p;
+			ix->alloc = alloc;
+		}
+		ix->offset[ix->count++] = off;
+	}
+	return true;
+}
+
+
+size_t str_utf8_offset(struct Str *self, size_t index)
+{
+	if (!self)
+		return STR_NPOS;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return STR_NPOS;
+	}
+
+	const struct str_kernels *k = str_kernels_get();
+	const unsigned char *s = (const unsigned char *)self->data;
+	size_t size = self->size;
+	size_t want = index / STR_INDEX_STRIDE;
+	size_t base = 0, skip = index;
+
+	if (!self->index)
+		self->index = (struct Str_index *)calloc(1, sizeof(struct Str_index));
+
+	// Without memory for the index the scan starts further back
+	struct Str_index *ix = self->index;
+	if (ix) {
+		index_extend(self, k, want);
+		if (ix->count) {
+			size_t sample = (want < ix->count ? want : ix->count - 1);
+			base = ix->offset[sample];
+			skip = index - sample * STR_INDEX_STRIDE;
+		}
+	}
+
+	size_t off = k->utf8_skip(s + base, size - base, skip);
+	if (off != STR_NPOS)
+		off += base;
+	else if (k->utf8_count(s + base, size - base) == skip)
+		off = size;
+
+	pthread_mutex_unlock(&self->lock);
+	return off;
+}
+
+
+/*	REVERSE	*/
+
+#define CP_ZWJ		0x200d
+#define CP_RI_FIRST	0x1f1e6		/* regional indicators, letters A..Z */
+#define CP_RI_LAST	0x1f1ff
+
+
+static bool is_extend(uint32_t cp)
+{
+	if (cp < str_extend_ranges[0][0])
+		return false;
+
+	size_t lo = 0, hi = str_extend_nranges;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (str_extend_ranges[mid][1] < cp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < str_extend_nranges && str_extend_ranges[lo][0] <= cp;
+}
+
+
+static bool is_ri(uint32_t cp)
+{
+	return cp >= CP_RI_FIRST && cp <= CP_RI_LAST;
+}
+
+
+/*
+ * End of the cluster whose base character, @base, ends at @i: the marks
+ * and joined characters after it.
+ */
+static size_t cluster_end(const unsigned char *s, size_t i, size_t size, uint32_t base)
+{
+	uint32_t prev = base;
+	size_t ri = is_ri(base);
+
+	while (i < size && s[i] >= 0x80) {
+		uint32_t cp;
+		size_t n = str_utf8_decode(s + i, size - i, &cp);
+
+		if (cp == STR_UTF8_BAD)
+			break;
+		if (is_ri(cp) && ri % 2 == 1)
+			ri++;
+		else if (!is_extend(cp) && cp != CP_ZWJ && prev != CP_ZWJ)
+			break;
+		prev = cp;
+		i += n;
+	}
+	return i;
+}
+
+
+static void reverse_bytes(unsigned char *s, size_t size)
+{
+	for (size_t i = 0, j = size; i + 1 < j; i++, j--) {
+		unsigned char t = s[i];
+		s[i] = s[j - 1];
+		s[j - 1] = t;
+	}
+}
+
+
+int str_utf8_reverse(struct Str *self)
+{
+	if (!self || !self->data)
+		return -1;
+
+	pthread_mutex_lock(&self->lock);
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *s = (unsigned char *)self->data;
+	size_t size = self->size;
+	size_t i = 0;
+
+	/*
+	 * Reverse the bytes of every multibyte unit (a character, a cluster,
+	 * CR LF) in place first, so that reversing the whole string turns
+	 * them back the right way round.
+	 */
+	while (i < size) {
+		size_t end = i + k->ascii_span(s + i, size - i);
+		size_t p = i;
+
+		while ((p = k->find_bytes(s, end, p, (const unsigned char *)"\r", 1)) != STR_NPOS) {
+			if (p + 1 < end && s[p + 1] == '\n') {
+				s[p] = '\n';
+				s[p + 1] = '\r';
+			}
+			p++;
+		}
+		if (end == size)
+			break;
+
+		// Marks on an ASCII base, but not on controls
+		size_t start = end;
+		uint32_t base;
+		size_t n = str_utf8_decode(s + end, size - end, &base);
+		i = end + n;
+		if (base != STR_UTF8_BAD) {
+			if (end > 0 && s[end - 1] >= 0x20 && s[end - 1] < 0x7f &&
+			    (is_extend(base) || base == CP_ZWJ)) {
+				start = end - 1;
+				base = s[start];
+				i = end;
+			}
+			i = cluster_end(s, i, size, base);
+		}
+		reverse_bytes(s + start, i - start);
+	}
+
+	k->reverse(s, size);
+
+	// Valid text stays valid, the index is stale either way
+	if (self->utf8 != STR_UTF8_VALID)
+		self->utf8 = STR_UTF8_UNKNOWN;
+	str_index_reset(self);
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
@@ -1,13 +1,76 @@
 #include "strutil.h"
+#include "str_simd.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <errno.h>
 #include <ctype.h>
+#include <limits.h>
 
 const size_t MAX_STRING_SIZE  = ((SIZE_MAX / 100) * 95);
 
+
+/*
+ * Make room for @size bytes of data plus the terminator. Existing spare
+ * capacity is reused; otherwise the buffer is grown to exactly @size.
+ * The caller must hold self->lock.
+ */
+int str_reserve(struct Str *self, size_t size)
+{
+	if (size > MAX_STRING_SIZE)
+		return -E2BIG;
+
+	if (self->data && size <= self->capacity)
+		return 0;
+
+	char *p = (char *)realloc(self->data, size + 1);
+	if (!p)
+		return -ENOMEM;
+
+	if (!self->data)
+		p[0] = '\0';
+
+	self->data = p;
+	self->capacity = size;
+	return 0;
+}
+
+
+/*
+ * Release spare capacity after data was removed. A failed realloc leaves
+ * the (still valid) larger buffer in place. The caller must hold self->lock.
+ */
+void str_shrink(struct Str *self)
+{
+	if (!self->data || self->capacity == self->size)
+		return;
+
+	char *p = (char *)realloc(self->data, self->size + 1);
+	if (p) {
+		self->data = p;
+		self->capacity = self->size;
+	}
+}
+
+
+/*
+ * Next match of @pat in self->data at or after @from, or NULL. Only the
+ * bytes up to the cached size are searched, the terminator is never
+ * needed. The byte before @from is looked at by whole word patterns, so
+ * callers editing in place must not have overwritten it yet. The caller
+ * must hold self->lock.
+ */
+static char *str_find_from(const struct Str *self, const char *from,
+			   const struct Str_pattern *pat)
+{
+	size_t pos = str_pattern_find_from(pat, self->data, self->size,
+					   (size_t)(from - self->data));
+
+	return (pos == STR_NPOS ? NULL : self->data + pos);
+}
+
+
 struct Str *str_init(void)
 {
 	struct Str *tmp = (struct Str *)calloc(1, sizeof(struct Str));
@@ -26,31 +89,24 @@ int str_add(struct Str *self, const char *_data)
 		return -EINVAL;
 
 	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
 	size_t size = strlen(_data);
+	size_t old_size = (self->data ? self->size : 0);
 
-	if (self->data != NULL) {
-		size += strlen(self->data);
+	if (size > MAX_STRING_SIZE - old_size) {
+		pthread_mutex_unlock(&self->lock);
+		return -E2BIG;
+	}
 
-		char *p = (char *)realloc(self->data, (size + 1));
-		if (p) {
-			self->data = p;
-		} else {
-			pthread_mutex_unlock(&self->lock);
-			return -ENOMEM;
-		}
-		strcat(self->data, _data);
-	} else {
-		self->data = (char *)malloc((size + 1) * sizeof(char));
-		if (!self->data) {
-			pthread_mutex_unlock(&self->lock);
-			return -1;
-		}
-		strcpy(self->data, _data);
-		if (strlen(self->data) != strlen(_data)) {
-			pthread_mutex_unlock(&self->lock);
-			return -1;
-		}
+	int ret = str_reserve(self, old_size + size);
+	if (ret) {
+		pthread_mutex_unlock(&self->lock);
+		return ret;
 	}
+
+	memcpy(self->data + old_size, _data, size + 1);
+	self->size = old_size + size;
+
 	pthread_mutex_unlock(&self->lock);
 	return 0;
 }
@@ -65,7 +121,10 @@ int str_input(struct Str *self)
 	}
 	
 	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
 	self->data = get_dyn_input(MAX_STRING_SIZE);
+	self->size = (self->data ? strlen(self->data) : 0);
+	self->capacity = self->size;
 	pthread_mutex_unlock(&self->lock);
 	return (self->data ? 0 : -1);
 }
@@ -78,6 +137,7 @@ int str_add_input(struct Str *self)
 	} 
 
 	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
 
 	if (!self->data) {
 		self->data = get_dyn_input(MAX_STRING_SIZE);
@@ -86,12 +146,13 @@ int str_add_input(struct Str *self)
 			pthread_mutex_unlock(&self->lock);
 			return -2;
 		}
+		self->size = strlen(self->data);
+		self->capacity = self->size;
 		pthread_mutex_unlock(&self->lock);
 		return 0;
 	}
 
-	char *self_data_ptr = self->data;
-	size_t self_data_size = strlen(self_data_ptr);
+	size_t self_data_size = self->size;
 
 	char *buf = get_dyn_input(MAX_STRING_SIZE - self_data_size);
 	if (!buf) {
@@ -99,52 +160,135 @@ int str_add_input(struct Str *self)
 		return -1;
 	}
 
-	char *new_data = (char *)realloc(self_data_ptr, (self_data_size + strlen(buf) + 1));
-	if (!new_data) {
+	size_t buf_size = strlen(buf);
+	if (str_reserve(self, self_data_size + buf_size)) {
+		free(buf);
 		pthread_mutex_unlock(&self->lock);
 		return -1;
 	}
 
-	self_data_ptr = new_data;
-	strncat(self_data_ptr, buf, strlen(buf));
+	memcpy(self->data + self_data_size, buf, buf_size + 1);
+	self->size = self_data_size + buf_size;
 
 	free(buf);
-	self->data = self_data_ptr;
 	pthread_mutex_unlock(&self->lock);
 	return 0;
 }
 
 
-int str_pop_back(struct Str *self, char sep)
+/*
+ * Cut the string after the first @keep bytes, or fail with -EINVAL when
+ * the separator was not found (@keep == STR_NPOS). Unlocks self->lock.
+ */
+static int pop_back_unlock(struct Str *self, size_t keep)
 {
-	if (self == NULL) {
-		return -1;
-	} else if (self->data == NULL) {
-		return -1;
-	} else if (strlen(self->data) == 0) {
-		return -1;
+	if (keep == STR_NPOS) {
+		pthread_mutex_unlock(&self->lock);
+		return -EINVAL;
 	}
 
-	pthread_mutex_lock(&self->lock);
+	self->data[keep] = '\0';
+	self->size = keep;
 
-	char *p = strrchr(self->data, sep);
-	if (!p) {
+	str_shrink(self); // Trim memory
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+/*
+ * Lock @self and check that there is something to pop. Returns with the
+ * lock held only on success.
+ */
+static int pop_back_lock(struct Str *self)
+{
+	if (self == NULL)
+		return -1;
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (self->data == NULL || self->size == 0) {
 		pthread_mutex_unlock(&self->lock);
-		return -EINVAL;
+		return -1;
 	}
+	return 0;
+}
 
-	p++;
-	*p = '\0';
 
-	char *self_data_ptr = (char *)realloc(self->data, strlen(self->data) + 1); // Trim memory
-	if (!self_data_ptr) {
-		pthread_mutex_unlock(&self->lock);
+int str_pop_back(struct Str *self, char sep)
+{
+	if (pop_back_lock(self))
 		return -1;
+
+	// Scan back from the cached end, the separator is usually close to it
+	unsigned char set = (unsigned char)sep;
+	size_t pos = str_kernels_get()->rfind_bytes((const unsigned char *)self->data,
+						    self->size, &set, 1);
+
+	return pop_back_unlock(self, (pos == STR_NPOS ? pos : pos + 1));
+}
+
+
+int str_pop_back_any(struct Str *self, const char *set)
+{
+	if (!set || !*set)
+		return (self ? -EINVAL : -1);
+
+	size_t nset = strlen(set);
+	if (pop_back_lock(self))
+		return -1;
+
+	const unsigned char *h = (const unsigned char *)self->data;
+	size_t pos = STR_NPOS;
+	if (nset <= STR_SMALL_SET_MAX) {
+		pos = str_kernels_get()->rfind_bytes(h, self->size,
+						     (const unsigned char *)set, nset);
+	} else {
+		bool in_set[256] = { false };
+		for (const unsigned char *p = (const unsigned char *)set; *p; p++)
+			in_set[*p] = true;
+		for (size_t i = self->size; i-- > 0;) {
+			if (in_set[h[i]]) {
+				pos = i;
+				break;
+			}
+		}
 	}
-	
-	self->data = self_data_ptr;
+
+	return pop_back_unlock(self, (pos == STR_NPOS ? pos : pos + 1));
+}
+
+
+int str_pop_back_str(struct Str *self, const char *sep)
+{
+	if (!sep || !*sep)
+		return (self ? -EINVAL : -1);
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, sep, strlen(sep), 0);
+	if (pop_back_lock(self))
+		return -1;
+
+	size_t pos = str_pattern_rfind(&pat, self->data, self->size, STR_NPOS);
+
+	return pop_back_unlock(self, (pos == STR_NPOS ? pos : pos + pat.size));
+}
+
+
+size_t str_rfind(struct Str *self, const char *needle, size_t len, size_t pos)
+{
+	if (!self || !needle)
+		return STR_NPOS;
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, needle, len, 0);
+
+	pthread_mutex_lock(&self->lock);
+	size_t ret = STR_NPOS;
+	if (self->data)
+		ret = str_pattern_rfind(&pat, self->data, self->size, pos);
 	pthread_mutex_unlock(&self->lock);
-	return 0;
+	return ret;
 }
 
 
@@ -165,7 +309,7 @@ void str_print(struct Str *self)
 size_t str_get_size(const struct Str *self)
 {
 	if (self) {
-    		return (self->data ? strlen(self->data) : 0);
+    		return (self->data ? self->size : 0);
 	} else {
 		return 0;
 	}
@@ -188,10 +332,13 @@ void str_clear(struct Str *self)
 {
 	if (self){
 		pthread_mutex_lock(&self->lock);
+		str_data_changed(self);
 		if (self->data) {
 			free(self->data);
 			self->data = NULL;
 		}
+		self->size = 0;
+		self->capacity = 0;
 		pthread_mutex_unlock(&self->lock);
 	}
 }
@@ -204,6 +351,10 @@ void str_free(struct Str *self)
 			free(self->data);
 			self->data = NULL;
 		}
+		str_index_free(self->index);
+		self->index = NULL;
+		self->size = 0;
+		self->capacity = 0;
 		if (self->is_dynamic) {
 			pthread_mutex_destroy(&self->lock);
 			free(self);
@@ -270,7 +421,8 @@ int str_rem_word(struct Str *self, const char *needle)
 	} 
         
 	pthread_mutex_lock(&self->lock);
-        size_t self_data_size = strlen(self->data);
+	str_data_changed(self);
+        size_t self_data_size = self->size;
         size_t needle_size = strlen(needle);
         
         if (needle_size > self_data_size) {
@@ -279,7 +431,9 @@ int str_rem_word(struct Str *self, const char *needle)
 	}
             
         char *L = NULL;
-        L = strstr(self->data, needle);
+        struct Str_pattern pat;
+        str_pattern_init(&pat, needle, needle_size, 0);
+        L = str_find_from(self, self->data, &pat);
         if(!L) {
 		pthread_mutex_unlock(&self->lock);
         	return -EINVAL;
@@ -287,17 +441,9 @@ int str_rem_word(struct Str *self, const char *needle)
 
         memmove(L, L + needle_size, self_data_size - (L - self->data) - needle_size + 1);
 	self->data[self_data_size - needle_size] = '\0';
-        
-        char *buf = (char*)realloc(self->data, 
-                ((self_data_size - needle_size)) +1);
-        
-	if (!buf) {	// realloc başarısız oldu; ancak kelime diziden kaldırıldı ve sonuna NULL eklendi
-		pthread_mutex_unlock(&self->lock);
-		return -1;
-	}
+	self->size = self_data_size - needle_size;
 
-        if (buf)
-        	self->data = buf;
+	str_shrink(self);
 
 	pthread_mutex_unlock(&self->lock);
 	return 0;
@@ -313,12 +459,15 @@ int str_swap_word(struct Str *self, const char *word1, const char *word2)
 	}
 
 	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
 
-	size_t self_data_size = strlen(self->data);
+	size_t self_data_size = self->size;
 	size_t word1_size = strlen(word1);
 	size_t word2_size = strlen(word2);
 
-	char *L = strstr(self->data, word1);
+	struct Str_pattern pat;
+	str_pattern_init(&pat, word1, word1_size, 0);
+	char *L = str_find_from(self, self->data, &pat);
 	if (!L) {
 		pthread_mutex_unlock(&self->lock);
 		return -1;
@@ -343,6 +492,489 @@ int str_swap_word(struct Str *self, const char *word1, const char *word2)
 
 	free(self->data);
 	self->data = buf;
+	self->size = new_size;
+	self->capacity = new_size;
+
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+/*
+ * Replace every match of @pat with @to. The caller holds self->lock and
+ * has checked that self->data is set and the pattern is not empty.
+ */
+static int replace_locked(struct Str *self, const struct Str_pattern *pat,
+			  const char *to, size_t to_size)
+{
+	char *data = self->data;
+	size_t data_size = self->size;
+	size_t from_size = pat->size;
+	size_t count = 0;
+	char *p;
+
+	if (from_size == to_size) {
+		/*
+		 * Same length: overwrite every match in place, no allocation.
+		 * Each write waits until the next search is done, so whole
+		 * word checks still see the original byte before it.
+		 */
+		char *pending = NULL;
+		p = data;
+		while ((p = str_find_from(self, p, pat)) != NULL) {
+			if (pending)
+				memcpy(pending, to, to_size);
+			pending = p;
+			p += from_size;
+			count++;
+		}
+		if (pending)
+			memcpy(pending, to, to_size);
+		return (count > INT_MAX ? INT_MAX : (int)count);
+	}
+
+	if (to_size < from_size) {
+		// Shrinking: compact in place, the write head never passes the read head
+		char *rd = data;
+		char *wr = data;
+		while ((p = str_find_from(self, rd, pat)) != NULL) {
+			size_t run = (size_t)(p - rd);
+			memmove(wr, rd, run);
+			wr += run;
+			memcpy(wr, to, to_size);
+			wr += to_size;
+			rd = p + from_size;
+			count++;
+		}
+		if (!count)
+			return 0;
+
+		size_t tail = data_size - (size_t)(rd - data);
+		memmove(wr, rd, tail + 1);
+		self->size = (size_t)(wr - data) + tail;
+
+		str_shrink(self); // Trim memory
+		return (count > INT_MAX ? INT_MAX : (int)count);
+	}
+
+	// Growing: record every match offset in one scan, then size exactly
+	size_t stack_offsets[64];
+	size_t *offsets = stack_offsets;
+	size_t offsets_cap = sizeof(stack_offsets) / sizeof(stack_offsets[0]);
+
+	p = data;
+	while ((p = str_find_from(self, p, pat)) != NULL) {
+		if (count == offsets_cap) {
+			size_t *tmp;
+			if (offsets == stack_offsets) {
+				tmp = (size_t *)malloc(2 * offsets_cap * sizeof(size_t));
+				if (tmp)
+					memcpy(tmp, stack_offsets, sizeof(stack_offsets));
+			} else {
+				tmp = (size_t *)realloc(offsets, 2 * offsets_cap * sizeof(size_t));
+			}
+			if (!tmp) {
+				if (offsets != stack_offsets)
+					free(offsets);
+				return -ENOMEM;
+			}
+			offsets = tmp;
+			offsets_cap *= 2;
+		}
+		offsets[count++] = (size_t)(p - data);
+		p += from_size;
+	}
+
+	if (!count)
+		return 0;
+
+	size_t growth = to_size - from_size;
+	if (growth > (MAX_STRING_SIZE - data_size) / count) {
+		if (offsets != stack_offsets)
+			free(offsets);
+		return -E2BIG;
+	}
+
+	size_t new_size = data_size + count * growth;
+	char *buf = (char *)malloc(new_size + 1);
+	if (!buf) {
+		if (offsets != stack_offsets)
+			free(offsets);
+		return -ENOMEM;
+	}
+
+	// Single forward write: untouched run, replacement, untouched run, ...
+	char *wr = buf;
+	size_t rd = 0;
+	for (size_t i = 0; i < count; i++) {
+		size_t run = offsets[i] - rd;
+		memcpy(wr, data + rd, run);
+		wr += run;
+		memcpy(wr, to, to_size);
+		wr += to_size;
+		rd = offsets[i] + from_size;
+	}
+	memcpy(wr, data + rd, data_size - rd + 1);
+
+	if (offsets != stack_offsets)
+		free(offsets);
+
+	free(self->data);
+	self->data = buf;
+	self->size = new_size;
+	self->capacity = new_size;
+	return (count > INT_MAX ? INT_MAX : (int)count);
+}
+
+
+/*
+ * Remove every match of @pat. The caller holds self->lock and has checked
+ * that self->data is set and the pattern is not empty.
+ */
+static int remove_locked(struct Str *self, const struct Str_pattern *pat,
+			 unsigned int flags)
+{
+	size_t count = 0;
+	char *rd = self->data;
+	char *wr = self->data;
+	char *p;
+
+	// Read head jumps over matches, write head trails it copying the gaps
+	while ((p = str_find_from(self, rd, pat)) != NULL) {
+		size_t run = (size_t)(p - rd);
+		if (wr != rd)
+			memmove(wr, rd, run);
+		wr += run;
+		rd = p + pat->size;
+		count++;
+	}
+
+	if (count) {
+		size_t tail = self->size - (size_t)(rd - self->data);
+		memmove(wr, rd, tail + 1);
+		self->size = (size_t)(wr - self->data) + tail;
+
+		if (!(flags & STR_KEEP_CAPACITY))
+			str_shrink(self);
+	}
+	return (count > INT_MAX ? INT_MAX : (int)count);
+}
+
+
+/*
+ * Count the non-overlapping matches of @pat and store the offsets of the
+ * first @max of them in @out (which may be NULL when @max is 0). Single
+ * bytes that nothing has to be recorded for are counted by the SIMD byte
+ * count kernel instead. The caller must hold self->lock.
+ */
+static size_t find_all_locked(struct Str *self, const struct Str_pattern *pat,
+			      size_t *out, size_t max)
+{
+	size_t count = 0;
+	char *p = self->data;
+
+	if (!p || !pat->size)
+		return 0;
+
+	if (pat->size == 1 && !max && !(pat->flags & STR_WHOLE_WORD)) {
+		const struct str_kernels *k = str_kernels_get();
+		const unsigned char *h = (const unsigned char *)self->data;
+		unsigned char c = pat->needle[0];
+		unsigned char lo = str_fold(c);
+
+		if (pat->icase && lo >= 'a' && lo <= 'z')
+			return k->count_byte(h, self->size, lo) +
+			       k->count_byte(h, self->size, lo & ~0x20u);
+		return k->count_byte(h, self->size, c);
+	}
+
+	while ((p = str_find_from(self, p, pat)) != NULL) {
+		if (count < max)
+			out[count] = (size_t)(p - self->data);
+		p += pat->size;
+		count++;
+	}
+	return count;
+}
+
+
+int str_replace_all(struct Str *self, const char *from, const char *to)
+{
+	return str_replace_all_ex(self, from, to, 0);
+}
+
+
+int str_replace_all_ex(struct Str *self, const char *from, const char *to,
+		       unsigned int flags)
+{
+	if (!self) {
+		return -1;
+	} else if (!from || !to || !*from) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, from, strlen(from), flags);
+	int ret = replace_locked(self, &pat, to, strlen(to));
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+size_t str_find(struct Str *self, const char *needle, size_t len, size_t start)
+{
+	return str_find_ex(self, needle, len, start, 0);
+}
+
+
+size_t str_find_ex(struct Str *self, const char *needle, size_t len,
+		   size_t start, unsigned int flags)
+{
+	if (!self || !needle)
+		return STR_NPOS;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data || start > self->size) {
+		pthread_mutex_unlock(&self->lock);
+		return STR_NPOS;
+	}
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, needle, len, flags);
+	size_t pos = str_pattern_find_from(&pat, self->data, self->size, start);
+
+	pthread_mutex_unlock(&self->lock);
+	return pos;
+}
+
+
+int str_rem_all(struct Str *self, const char *needle, unsigned int flags)
+{
+	if (!self) {
+		return -1;
+	} else if (!needle || !*needle) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, needle, strlen(needle), flags);
+	int ret = remove_locked(self, &pat, flags);
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+size_t str_find_pattern(struct Str *self, const struct Str_pattern *pat,
+			size_t start)
+{
+	if (!self || !pat)
+		return STR_NPOS;
+
+	pthread_mutex_lock(&self->lock);
+	if (!self->data || start > self->size) {
+		pthread_mutex_unlock(&self->lock);
+		return STR_NPOS;
+	}
+
+	size_t pos = str_pattern_find_from(pat, self->data, self->size, start);
+
+	pthread_mutex_unlock(&self->lock);
+	return pos;
+}
+
+
+size_t str_count_pattern(struct Str *self, const struct Str_pattern *pat)
+{
+	if (!self || !pat)
+		return 0;
+
+	pthread_mutex_lock(&self->lock);
+	size_t count = find_all_locked(self, pat, NULL, 0);
+	pthread_mutex_unlock(&self->lock);
+	return count;
+}
+
+
+size_t str_count_char(struct Str *self, char c)
+{
+	if (!self)
+		return 0;
+
+	pthread_mutex_lock(&self->lock);
+	size_t count = 0;
+	if (self->data)
+		count = str_kernels_get()->count_byte((const unsigned char *)self->data,
+						      self->size, (unsigned char)c);
+	pthread_mutex_unlock(&self->lock);
+	return count;
+}
+
+
+size_t str_count(struct Str *self, const char *needle)
+{
+	return str_find_all(self, needle, NULL, 0);
+}
+
+
+size_t str_find_all(struct Str *self, const char *needle, size_t *out_offsets,
+		    size_t max)
+{
+	if (!self || !needle || (max && !out_offsets))
+		return 0;
+
+	struct Str_pattern pat;
+	str_pattern_init(&pat, needle, strlen(needle), 0);
+
+	pthread_mutex_lock(&self->lock);
+	size_t count = find_all_locked(self, &pat, out_offsets, max);
+	pthread_mutex_unlock(&self->lock);
+	return count;
+}
+
+
+int str_rem_pattern(struct Str *self, const struct Str_pattern *pat,
+		    unsigned int flags)
+{
+	if (!self) {
+		return -1;
+	} else if (!pat || !pat->size) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	int ret = remove_locked(self, pat, flags);
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+int str_replace_pattern(struct Str *self, const struct Str_pattern *pat,
+			const char *to)
+{
+	if (!self) {
+		return -1;
+	} else if (!pat || !pat->size || !to) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	int ret = replace_locked(self, pat, to, strlen(to));
+
+	pthread_mutex_unlock(&self->lock);
+	return ret;
+}
+
+
+int str_apply_edits(struct Str *self, const struct Str_edit *edits, size_t n)
+{
+	if (!self) {
+		return -1;
+	} else if (n && !edits) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
+	}
+
+	/*
+	 * Validate and size everything up front, so a bad list leaves the
+	 * string untouched. @in_place stays true while the write head can
+	 * never pass the read head, i.e. no prefix of the list grows.
+	 */
+	const size_t data_size = self->size;
+	size_t end = 0;
+	size_t grow = 0;
+	size_t shrink = 0;
+	bool in_place = true;
+	for (size_t i = 0; i < n; i++) {
+		const struct Str_edit *e = &edits[i];
+		if (e->offset < end || e->offset > data_size ||
+		    e->del_len > data_size - e->offset || (e->ins_len && !e->ins)) {
+			pthread_mutex_unlock(&self->lock);
+			return -EINVAL;
+		}
+		end = e->offset + e->del_len;
+		if (e->ins_len > e->del_len) {
+			grow += e->ins_len - e->del_len;
+			if (grow > MAX_STRING_SIZE - data_size) {
+				pthread_mutex_unlock(&self->lock);
+				return -E2BIG;
+			}
+		} else {
+			shrink += e->del_len - e->ins_len;
+		}
+		if (grow > shrink)
+			in_place = false;
+	}
+
+	const size_t new_size = data_size + grow - shrink;
+	char *data = self->data;
+	char *buf = data;
+	if (!in_place) {
+		buf = (char *)malloc(new_size + 1);
+		if (!buf) {
+			pthread_mutex_unlock(&self->lock);
+			return -ENOMEM;
+		}
+	}
+
+	// One sequential pass: untouched run, insertion, untouched run, ...
+	char *wr = buf;
+	size_t rd = 0;
+	for (size_t i = 0; i < n; i++) {
+		const struct Str_edit *e = &edits[i];
+		size_t run = e->offset - rd;
+		if (wr != data + rd)
+			memmove(wr, data + rd, run);
+		wr += run;
+		if (e->ins_len)
+			memcpy(wr, e->ins, e->ins_len);
+		wr += e->ins_len;
+		rd = e->offset + e->del_len;
+	}
+	memmove(wr, data + rd, data_size - rd + 1);
+	self->size = new_size;
+
+	if (in_place) {
+		str_shrink(self);
+	} else {
+		free(data);
+		self->data = buf;
+		self->capacity = new_size;
+	}
 
 	pthread_mutex_unlock(&self->lock);
 	return 0;
@@ -357,13 +989,7 @@ int str_to_upper(struct Str *self)
 		return -1;
 	}
 	pthread_mutex_lock(&self->lock);
-
-	char *p = self->data;
-	while (*p) {
-		if ((*p >= 'a') && (*p <= 'z'))
-			*p &= ~(1 << 5);
-		p++;
-	}
+	str_kernels_get()->case_flip((unsigned char *)self->data, self->size, 'a');
 	pthread_mutex_unlock(&self->lock);
 	return 0;
 }
@@ -378,69 +1004,482 @@ int str_to_lower(struct Str *self)
 	}
 	
 	pthread_mutex_lock(&self->lock);
-	char *p = self->data;
-	while (*p) {
-		if ((*p >= 'A') && (*p <= 'Z'))
-			*p |= (1 << 5); // yes, faster than tolower :/
-		p++;
-	}
-
+	str_kernels_get()->case_flip((unsigned char *)self->data, self->size, 'A');
 	pthread_mutex_unlock(&self->lock);
 	return 0;
 }
 
 
 int str_to_title_case(struct Str *self)
+{
+	return str_to_title_case_set(self, NULL);
+}
+
+
+int str_to_title_case_set(struct Str *self, const struct Str_charset *boundaries)
 {
 	if (!self) {
 		return -1;
-	} else if (!self->data || !strlen(self->data)) {
+	} else if (!self->data || !self->size) {
 		return -1;
 	}
-	
+	if (!boundaries)
+		boundaries = &str_title_boundaries;
+
 	pthread_mutex_lock(&self->lock);
+	str_kernels_get()->title_case((unsigned char *)self->data, self->size, boundaries, true);
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
 
-	char *p = self->data;
-	short flag = 1;
-
-	while (*p) {
-		if (flag && (*p >= 'a') && (*p <= 'z')) {
-			*p &= ~(1 << 5);
-			flag = 0;
-		} else if (*p == ' ') {
-			flag = 1;
+
+void str_charset_init(struct Str_charset *set, const char *chars)
+{
+	memset(set, 0, sizeof(*set));
+	if (!chars)
+		return;
+
+	for (const unsigned char *p = (const unsigned char *)chars; *p; p++)
+		set->bits[*p >> 6] |= 1ull << (*p & 63);
+}
+
+
+/*
+ * str_transform() runs its ops as a chain of stages. A stage is a byte map
+ * with deletions, followed by at most one op that needs the byte before
+ * (title case or squeeze). Maps and deletes fold into the table of the
+ * current stage, so a chain has only as many stages as it has title and
+ * squeeze ops. The string is fed through all stages a block at a time,
+ * small enough to stay in L1, so every stage can use its own kernel
+ * without another trip through memory.
+ */
+#define XF_DELETE	0x100u
+#define XF_BLOCK	4096
+
+// How a stage's map is applied
+enum xform_kind {
+	XF_IDENTITY,
+	XF_UPPER,	/* exactly the ASCII case maps: case_flip kernel */
+	XF_LOWER,
+	XF_TABLE,	/* any other map: translate kernel */
+};
+
+struct xform_stage {
+	uint16_t map[256];	/* new value of each byte, or XF_DELETE */
+	struct Str_table table;	/* the map for XF_TABLE */
+	bool	filter;		/* remove the bytes in del first */
+	struct Str_charset del;
+	enum xform_kind kind;	/* how the bytes that are left are mapped */
+	enum str_op_type tail;	/* STR_OP_TITLE, STR_OP_SQUEEZE or STR_OP_MAP (none) */
+	const struct Str_charset *set;
+	unsigned int prev;	/* title: last byte was a boundary; squeeze: last byte */
+};
+
+
+static void xform_stage_init(struct xform_stage *st)
+{
+	for (unsigned int c = 0; c < 256; c++)
+		st->map[c] = (uint16_t)c;
+	st->tail = STR_OP_MAP;
+	st->set = NULL;
+}
+
+
+static int xform_build(const struct Str_op *ops, size_t n,
+		       struct xform_stage *st, size_t *nst)
+{
+	size_t k = 0;
+	xform_stage_init(&st[0]);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct Str_op *op = &ops[i];
+
+		switch (op->type) {
+		case STR_OP_TITLE:
+		case STR_OP_SQUEEZE:
+			if (op->type == STR_OP_SQUEEZE && !op->set)
+				return -EINVAL;
+			if (st[k].tail != STR_OP_MAP)
+				xform_stage_init(&st[++k]);
+			st[k].tail = op->type;
+			st[k].set = op->set ? op->set : &str_title_boundaries;
+			continue;
+		case STR_OP_LOWER:
+		case STR_OP_UPPER:
+			break;
+		case STR_OP_MAP:
+			if (!op->table)
+				return -EINVAL;
+			break;
+		case STR_OP_DELETE:
+			if (!op->set)
+				return -EINVAL;
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		if (st[k].tail != STR_OP_MAP)
+			xform_stage_init(&st[++k]);
+		for (unsigned int c = 0; c < 256; c++) {
+			unsigned int v = st[k].map[c];
+			if (v == XF_DELETE)
+				continue;
+			if (op->type == STR_OP_LOWER && v - 'A' < 26)
+				v |= 0x20;
+			else if (op->type == STR_OP_UPPER && v - 'a' < 26)
+				v &= ~0x20u;
+			else if (op->type == STR_OP_MAP)
+				v = op->table[v];
+			else if (op->type == STR_OP_DELETE && str_charset_has(op->set, (unsigned char)v))
+				v = XF_DELETE;
+			st[k].map[c] = (uint16_t)v;
+		}
+	}
+
+	*nst = k + 1;
+	return 0;
+}
+
+
+// Byte range @first .. @first + 25 flipped, everything else kept or deleted
+static bool xform_is_case_flip(const uint16_t *map, unsigned char first)
+{
+	for (unsigned int c = 0; c < 256; c++) {
+		if (map[c] != XF_DELETE && map[c] != ((c - first < 26) ? (c ^ 0x20) : c))
+			return false;
+	}
+	return true;
+}
+
+
+/*
+ * True if @map only ever changes the case of ASCII letters, and never
+ * moves a byte in or out of @set: title case overwrites the case anyway.
+ */
+static bool xform_case_only(const uint16_t *map, const struct Str_charset *set)
+{
+	for (unsigned int c = 0; c < 256; c++) {
+		unsigned int v = map[c];
+		if (v == c || v == XF_DELETE)
+			continue;
+		if (v != (c ^ 0x20) || (c | 0x20) - 'a' >= 26 ||
+		    str_charset_has(set, (unsigned char)c) != str_charset_has(set, (unsigned char)v))
+			return false;
+	}
+	return true;
+}
+
+
+/*
+ * Deletions become a byte set for the remove_set kernel; the bytes that
+ * are left then go through the cheapest kernel that does their map.
+ */
+static void xform_classify(struct xform_stage *st)
+{
+	bool identity = true;
+
+	memset(&st->del, 0, sizeof(st->del));
+	st->filter = false;
+	for (unsigned int c = 0; c < 256; c++) {
+		if (st->map[c] == XF_DELETE) {
+			st->del.bits[c >> 6] |= 1ull << (c & 63);
+			st->filter = true;
+		} else {
+			identity &= st->map[c] == c;
 		}
-		p++;
+	}
+
+	if (identity || (st->tail == STR_OP_TITLE && xform_case_only(st->map, st->set)))
+		st->kind = XF_IDENTITY;
+	else if (xform_is_case_flip(st->map, 'a'))
+		st->kind = XF_UPPER;
+	else if (xform_is_case_flip(st->map, 'A'))
+		st->kind = XF_LOWER;
+	else
+		st->kind = XF_TABLE;
+
+	if (st->kind == XF_TABLE) {
+		unsigned char map[256];
+		for (unsigned int c = 0; c < 256; c++)
+			map[c] = (unsigned char)(st->map[c] == XF_DELETE ? c : st->map[c]);
+		str_table_prepare(&st->table, map);
+	}
+
+	st->prev = st->tail == STR_OP_TITLE ? 1 : XF_DELETE;
+}
+
+
+// Runs one stage over @size bytes in place, returns how many are left
+static size_t xform_stage_run(struct xform_stage *st, const struct str_kernels *k,
+			      unsigned char *s, size_t size)
+{
+	if (st->filter)
+		size = k->remove_set(s, size, &st->del);
+
+	switch (st->kind) {
+	case XF_IDENTITY:
+		break;
+	case XF_UPPER:
+		k->case_flip(s, size, 'a');
+		break;
+	case XF_LOWER:
+		k->case_flip(s, size, 'A');
+		break;
+	case XF_TABLE:
+		k->translate(s, size, &st->table);
+		break;
+	}
+
+	if (st->tail == STR_OP_TITLE) {
+		st->prev = k->title_case(s, size, st->set, st->prev);
+	} else if (st->tail == STR_OP_SQUEEZE) {
+		// A local copy of the set: stores to @s may alias it
+		const struct Str_charset set = *st->set;
+		unsigned int prev = st->prev;
+		size_t w = 0;
+		for (size_t r = 0; r < size; r++) {
+			unsigned char c = s[r];
+			s[w] = c;
+			w += (c != prev) | !str_charset_has(&set, c);
+			prev = c;
+		}
+		st->prev = prev;
+		size = w;
+	}
+	return size;
+}
+
+
+int str_transform(struct Str *self, const struct Str_op *ops, size_t n)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
+		return -1;
+	}
+	if (!ops && n)
+		return -EINVAL;
+
+	struct xform_stage *st = (struct xform_stage *)malloc((n ? n : 1) * sizeof(*st));
+	if (!st)
+		return -ENOMEM;
+
+	size_t nst;
+	int ret = xform_build(ops, n, st, &nst);
+	if (ret) {
+		free(st);
+		return ret;
+	}
+	for (size_t i = 0; i < nst; i++)
+		xform_classify(&st[i]);
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *data = (unsigned char *)self->data;
+	size_t size = self->size;
+	size_t w = 0;
+
+	for (size_t r = 0; r < size; r += XF_BLOCK) {
+		size_t len = size - r < XF_BLOCK ? size - r : XF_BLOCK;
+		for (size_t i = 0; i < nst && len; i++)
+			len = xform_stage_run(&st[i], k, data + r, len);
+		if (w != r)
+			memmove(data + w, data + r, len);
+		w += len;
+	}
+
+	if (w != self->size) {
+		data[w] = '\0';
+		self->size = w;
+		str_shrink(self);
 	}
 
 	pthread_mutex_unlock(&self->lock);
+	free(st);
 	return 0;
 }
 
-int str_reverse(struct Str *self)
+
+int str_translate(struct Str *self, const uint8_t table[256])
+{
+	if (!table)
+		return -EINVAL;
+
+	struct Str_table t;
+	str_table_prepare(&t, table);
+	return str_translate_table(self, &t);
+}
+
+
+int str_translate_table(struct Str *self, const struct Str_table *table)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
+		return -1;
+	}
+	if (!table)
+		return -EINVAL;
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	str_kernels_get()->translate((unsigned char *)self->data, self->size, table);
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+int str_trim(struct Str *self)
 {
 	if (!self) {
 		return -1;
 	} else if (!self->data) {
 		return -1;
-	} else if (!strlen(self->data)) {
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_index_reset(self);
+	const struct str_kernels *k = str_kernels_get();
+	unsigned char *data = (unsigned char *)self->data;
+	size_t lead = k->ws_span(data, self->size);
+	size_t size = self->size - lead;
+
+	size -= k->ws_rspan(data + lead, size);
+	if (lead)
+		memmove(data, data + lead, size);
+	data[size] = '\0';
+	self->size = size;
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+int str_trim_left(struct Str *self)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
 		return -1;
 	}
-    
+
 	pthread_mutex_lock(&self->lock);
-	char buf;
-	char *data = self->data;
-	size_t head = 0;
-	size_t tail = strlen(self->data) - 1;
+	str_index_reset(self);
+	size_t lead = str_kernels_get()->ws_span((const unsigned char *)self->data, self->size);
+	if (lead) {
+		self->size -= lead;
+		memmove(self->data, self->data + lead, self->size + 1);
+	}
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+int str_trim_right(struct Str *self)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_index_reset(self);
+	self->size -= str_kernels_get()->ws_rspan((const unsigned char *)self->data, self->size);
+	self->data[self->size] = '\0';
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+int str_squeeze_ws(struct Str *self)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_index_reset(self);
+	self->size = str_kernels_get()->squeeze_ws((unsigned char *)self->data, self->size);
+	self->data[self->size] = '\0';
+	pthread_mutex_unlock(&self->lock);
+	return 0;
+}
+
+
+size_t str_span(struct Str *self, const struct Str_charset *set)
+{
+	if (!self || !set)
+		return 0;
+
+	pthread_mutex_lock(&self->lock);
+	size_t n = 0;
+	if (self->data)
+		n = str_kernels_get()->span((const unsigned char *)self->data, self->size, set, true);
+	pthread_mutex_unlock(&self->lock);
+	return n;
+}
+
+
+size_t str_cspan(struct Str *self, const struct Str_charset *set)
+{
+	if (!self || !set)
+		return 0;
 
-	while (head < tail) {
-		buf = data[head];
-		data[head] = data[tail];
-		data[tail] = buf;
-		head++;
-		tail--;
+	pthread_mutex_lock(&self->lock);
+	size_t n = 0;
+	if (self->data)
+		n = str_kernels_get()->span((const unsigned char *)self->data, self->size, set, false);
+	pthread_mutex_unlock(&self->lock);
+	return n;
+}
+
+
+int str_remove_chars(struct Str *self, const struct Str_charset *set, unsigned int flags)
+{
+	if (!self) {
+		return -1;
+	} else if (!set) {
+		return -EINVAL;
+	}
+
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	if (!self->data) {
+		pthread_mutex_unlock(&self->lock);
+		return -1;
 	}
 
+	size_t size = str_kernels_get()->remove_set((unsigned char *)self->data, self->size, set);
+	size_t removed = self->size - size;
+	if (removed) {
+		self->data[size] = '\0';
+		self->size = size;
+		if (!(flags & STR_KEEP_CAPACITY))
+			str_shrink(self);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	return removed > INT_MAX ? INT_MAX : (int)removed;
+}
+
+
+int str_reverse(struct Str *self)
+{
+	if (!self) {
+		return -1;
+	} else if (!self->data) {
+		return -1;
+	} else if (!self->size) {
+		return -1;
+	}
+    
+	pthread_mutex_lock(&self->lock);
+	str_data_changed(self);
+	str_kernels_get()->reverse((unsigned char *)self->data, self->size);
 	pthread_mutex_unlock(&self->lock);
 	return 0;
 }
@@ -450,7 +1489,7 @@ bool str_is_empty(struct Str *self)
 	if (self){
 		if (self->data == NULL){
 			return true;
-		} else if (strlen(self->data) == 0) {
+		} else if (self->size == 0) {
 			return true;
 		} else {
 			return false;
@@ -12,6 +12,30 @@ int main()
 	test_str_get_size(s);
 	test_str_rem_word(s);
 	test_str_swap_word(s);
+	test_str_replace_all(s);
+	test_str_rem_all(s);
+	test_str_find(s);
+	test_str_pattern(s);
+	test_str_dict_replace(s);
+	test_str_whole_word(s);
+	test_str_icase(s);
+	test_str_count(s);
+	test_str_apply_edits(s);
+	test_str_rfind(s);
+	test_str_glob(s);
+	test_str_regex(s);
+	test_str_edit_distance(s);
+	test_str_case_levels(s);
+	test_str_title_case(s);
+	test_str_transform(s);
+	test_str_translate(s);
+	test_str_trim(s);
+	test_str_span(s);
+	test_str_utf8(s);
+	test_str_utf8_case(s);
+	test_str_utf8_index(s);
+	test_str_codec(s);
+	test_str_escape(s);
 	test_str_to_upper(s);
 	test_str_to_lower(s);
 	test_str_reverse(s);
@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
 #include "strutil.h"
 
 
@@ -203,7 +206,966 @@ void test_str_reverse(struct Str *s)
 	if (strncmp(s->data, rev_msg, strlen(rev_msg))) 
 		STR_PRINTERR_CLEAR_AND_RETURN(s);
 
+	// Every length up to a few blocks, on each kernel
+	char text[300];
+	char expect[300];
+	for (size_t i = 0; i < sizeof(text) - 1; i++)
+		text[i] = (char)('!' + i % 90);
+	text[sizeof(text) - 1] = '\0';
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		for (size_t len = 1; len < sizeof(text); len++) {
+			const char *tail = text + sizeof(text) - 1 - len;
+			for (size_t i = 0; i < len; i++)
+				expect[i] = tail[len - 1 - i];
+			expect[len] = '\0';
+			str_clear(s);
+			if (str_add(s, tail) || str_reverse(s) ||
+			    memcmp(s->data, expect, len + 1)) {
+				str_simd_set_level(best);
+				STR_PRINTERR_CLEAR_AND_RETURN(s);
+			}
+		}
+	}
+	str_simd_set_level(best);
+
 	FINISH_MSG(s, test_str_reverse);
 }
  
 
+void test_str_replace_all(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "a-b-c-d"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all(s, "-", "+") != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "a+b+c+d"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all(s, "+", "::") != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "a::b::c::d"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all(s, "::", "") != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "abcd"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all(s, "x", "y") != 0)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_replace_all);
+}
+
+void test_str_rem_all(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "xx-a-xx-b-xxx"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	size_t capacity = s->capacity;
+
+	if (str_rem_all(s, "xx", STR_KEEP_CAPACITY) != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "-a--b-x") || s->size != 7 || s->capacity != capacity)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_rem_all(s, "-", 0) != 4)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "abx") || s->capacity != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_rem_all);
+}
+
+void test_str_find(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Long enough for the vector loops, match near the end
+	for (int i = 0; i < 8; i++) {
+		if (str_add(s, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"))
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+	if (str_add(s, "needle!"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find(s, "needle", 6, 0) != 512)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find(s, "aab", 3, 0) != 61 || str_find(s, "aab", 3, 62) != 125)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find(s, "ba", 2, 0) != 63 || str_find(s, "", 0, 7) != 7)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find(s, "needles", 7, 0) != STR_NPOS || str_find(s, "a", 1, 600) != STR_NPOS)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_find);
+}
+
+void test_str_pattern(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_pattern *pat = str_pattern_compile("cat", 0);
+	if (!pat)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "cat concat category dog")) {
+		str_pattern_free(pat);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	if (str_find_pattern(s, pat, 1) != 7 || str_count_pattern(s, pat) != 3) {
+		str_pattern_free(pat);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	if (str_replace_pattern(s, pat, "dog") != 3 ||
+	    strcmp(s->data, "dog condog dogegory dog")) {
+		str_pattern_free(pat);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+	str_pattern_free(pat);
+
+	pat = str_pattern_compile("dog", 0);
+	if (!pat)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_rem_pattern(s, pat, 0) != 4 || strcmp(s->data, " con egory ")) {
+		str_pattern_free(pat);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+	str_pattern_free(pat);
+
+	FINISH_MSG(s, test_str_pattern);
+}
+
+void test_str_dict_replace(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	const char *words[] = { "York", "New York", "ssn", "he", "hers" };
+	const char *repl[] = { "Y", "NYC", "***", "HE", NULL };
+
+	struct Str_dict *dict = str_dict_compile(words, repl, 5);
+	if (!dict)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "New York, York, ssn: ushers he")) {
+		str_dict_free(dict);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	if (str_dict_replace(s, dict) != 5) {
+		str_dict_free(dict);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+	str_dict_free(dict);
+
+	if (strcmp(s->data, "NYC, Y, ***: us HE") || s->size != strlen(s->data))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_dict_replace);
+}
+
+void test_str_whole_word(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "cat concat cat_x cat-nip (cat)"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find_ex(s, "cat", 3, 1, STR_WHOLE_WORD) != 17)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// "-nip" starts with a non-word byte, so its left side is free
+	if (str_find_ex(s, "-nip", 4, 0, STR_WHOLE_WORD) != 20)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all_ex(s, "cat", "dog", STR_WHOLE_WORD) != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (strcmp(s->data, "dog concat cat_x dog-nip (dog)"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_rem_all(s, "dog", STR_WHOLE_WORD) != 3 ||
+	    strcmp(s->data, " concat cat_x -nip ()") || s->size != strlen(s->data))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_whole_word);
+}
+
+void test_str_icase(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "Content-Type: text/plain; CONTENT-length: 12; content-TYPE"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_find_ex(s, "content-length", 14, 0, STR_ICASE) != 26 ||
+	    str_find_ex(s, "content-type", 12, 1, STR_ICASE) != 46 ||
+	    str_find_ex(s, "CONTENT-TYPE", 12, 1, 0) != STR_NPOS)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_replace_all_ex(s, "content-type", "ct", STR_ICASE) != 2 ||
+	    strcmp(s->data, "ct: text/plain; CONTENT-length: 12; ct"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_rem_all(s, "CT", STR_ICASE) != 2 ||
+	    strcmp(s->data, ": text/plain; CONTENT-length: 12; ") || s->size != strlen(s->data))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_icase);
+}
+
+void test_str_count(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "a,b,,c,aaaa,d"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_count_char(s, ',') != 5 || str_count_char(s, 'x') != 0 ||
+	    str_count(s, "aa") != 2 || str_count(s, "a") != 5)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	size_t offsets[2];
+	if (str_find_all(s, ",", NULL, 0) != 5 ||
+	    str_find_all(s, "aa", offsets, 2) != 2 || offsets[0] != 7 || offsets[1] != 9 ||
+	    str_find_all(s, ",", offsets, 2) != 5 || offsets[0] != 1 || offsets[1] != 3)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_count);
+}
+
+void test_str_apply_edits(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "Emrah Vladislav Celil"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Overlapping edits are rejected and leave the string alone
+	struct Str_edit bad[] = {
+		{ 0, 5, NULL, 0 },
+		{ 4, 1, "x", 1 },
+	};
+	if (str_apply_edits(s, bad, 2) != -EINVAL || strcmp(s->data, "Emrah Vladislav Celil"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_edit edits[] = {
+		{ 0, 0, "[", 1 },
+		{ 5, 1, "] [", 3 },
+		{ 6, 9, "V.", 2 },
+		{ 21, 0, "]", 1 },
+	};
+	if (str_apply_edits(s, edits, 4) ||
+	    strcmp(s->data, "[Emrah] [V. Celil]") || s->size != strlen(s->data))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Shrinking only: done in place
+	struct Str_edit cut[] = {
+		{ 0, 1, NULL, 0 },
+		{ 6, 3, " ", 1 },
+		{ 17, 1, NULL, 0 },
+	};
+	if (str_apply_edits(s, cut, 3) || strcmp(s->data, "Emrah V. Celil"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_apply_edits);
+}
+
+void test_str_rfind(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "/usr/lib\\gcc::x86_64::libgcc.tar.gz"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_rfind(s, "::", 2, STR_NPOS) != 20 || str_rfind(s, "::", 2, 19) != 12 ||
+	    str_rfind(s, "gcc", 3, STR_NPOS) != 25 || str_rfind(s, "zip", 3, STR_NPOS) != STR_NPOS)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_pop_back_str(s, ".tar") || strcmp(s->data, "/usr/lib\\gcc::x86_64::libgcc.tar"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_pop_back_str(s, "::") || strcmp(s->data, "/usr/lib\\gcc::x86_64::"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_pop_back_any(s, "/\\") || strcmp(s->data, "/usr/lib\\") || s->size != 9)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_pop_back_any(s, "#") != -EINVAL || str_pop_back_str(s, "") != -EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_rfind);
+}
+
+void test_str_glob(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_glob *log = str_glob_compile("*.log", 0);
+	struct Str_glob *user = str_glob_compile("user-?\?-[!0-9]*", STR_ICASE);
+	if (!log || !user || str_glob_compile("[a-", 0) != NULL) {
+		str_glob_free(log);
+		str_glob_free(user);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	if (str_add(s, "var/app.log") || !str_glob_match(s, log) || str_glob_match(s, user)) {
+		str_glob_free(log);
+		str_glob_free(user);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	str_clear(s);
+	if (str_add(s, "USER-42-x.log.gz") || str_glob_match(s, log) || !str_glob_match(s, user)) {
+		str_glob_free(log);
+		str_glob_free(user);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	str_glob_free(log);
+	str_glob_free(user);
+	FINISH_MSG(s, test_str_glob);
+}
+
+void test_str_regex(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_regex *num = str_regex_compile("[0-9]+(\\.[0-9]+)?", 0);
+	struct Str_regex *id = str_regex_compile("^(user|admin)-\\d{2,3}$", STR_ICASE);
+	if (!num || !id || str_regex_compile("(ab", 0) != NULL ||
+	    str_regex_compile("a{3,2}", 0) != NULL || str_regex_compile("*a", 0) != NULL) {
+		str_regex_free(num);
+		str_regex_free(id);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	size_t len = 0;
+	if (str_add(s, "pi is 3.14, e is 2.718") || str_search(s, num, 0, &len) != 6 ||
+	    len != 4 || str_search(s, num, 10, &len) != 17 || len != 5 || str_match(s, id)) {
+		str_regex_free(num);
+		str_regex_free(id);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	if (str_replace_regex(s, num, "N") != 2 || strcmp(s->data, "pi is N, e is N") != 0) {
+		str_regex_free(num);
+		str_regex_free(id);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	str_clear(s);
+	if (str_add(s, "Admin-042") || !str_match(s, id) || str_add(s, "7") || str_match(s, id)) {
+		str_regex_free(num);
+		str_regex_free(id);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	// ^ after $ holds only where the end is also the start
+	str_regex_free(num);
+	num = str_regex_compile("a*$^", 0);
+	str_clear(s);
+	if (!num || !str_match(s, num) || str_search(s, num, 0, &len) != 0 || len != 0 ||
+	    str_add(s, "a") || str_match(s, num) || str_search(s, num, 0, &len) != STR_NPOS) {
+		str_regex_free(num);
+		str_regex_free(id);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	str_regex_free(num);
+	str_regex_free(id);
+	FINISH_MSG(s, test_str_regex);
+}
+
+void test_str_edit_distance(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str *t = str_init();
+	if (!t || str_add(s, "kitten") || str_add(t, "sitting") ||
+	    str_edit_distance(s, t, STR_NPOS) != 3 || str_edit_distance(t, s, 2) != STR_NPOS) {
+		str_free(t);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	struct Str *words[4] = { str_init(), str_init(), NULL, str_init() };
+	if (!words[0] || !words[1] || !words[3] || str_add(words[0], "sitter") ||
+	    str_add(words[1], "mitten") || str_add(words[3], "kitchen")) {
+		str_free(t);
+		str_free(words[0]);
+		str_free(words[1]);
+		str_free(words[3]);
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	struct Str_fuzzy_hit hits[2];
+	size_t count = str_fuzzy_topk(s, words, 4, 2, hits);
+	str_free(t);
+	str_free(words[0]);
+	str_free(words[1]);
+	str_free(words[3]);
+	if (count != 2 || hits[0].index != 1 || hits[0].distance != 1 ||
+	    hits[1].index != 0 || hits[1].distance != 2)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_edit_distance);
+}
+
+void test_str_case_levels(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Every byte value, so the range edges '@' '[' '`' '{' and 0xc1 / 0xe1 are in
+	char all[256];
+	char upper[256];
+	for (int i = 0; i < 255; i++) {
+		all[i] = (char)(i + 1);
+		upper[i] = (char)((i + 1 >= 'a' && i + 1 <= 'z') ? i + 1 - 32 : i + 1);
+	}
+	all[255] = upper[255] = '\0';
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		str_clear(s);
+		if (str_add(s, all) || str_to_upper(s) || memcmp(s->data, upper, 256) ||
+		    str_to_lower(s) || str_to_upper(s) || memcmp(s->data, upper, 256)) {
+			str_simd_set_level(best);
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+		}
+	}
+	str_simd_set_level(best);
+
+	FINISH_MSG(s, test_str_case_levels);
+}
+
+// Plain per-byte title case to check the kernels against
+static void title_case_ref(char *buf, size_t size, const struct Str_charset *set)
+{
+	int start = 1;
+	for (size_t i = 0; i < size; i++) {
+		unsigned char c = (unsigned char)buf[i];
+		if (isalpha(c) && c < 0x80)
+			buf[i] = (char)(start ? toupper(c) : tolower(c));
+		start = (set->bits[c >> 6] >> (c & 63)) & 1;
+	}
+}
+
+void test_str_title_case(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, "hello wORLD\tfoo\nbar-baz it's x_y (3rd) \xc3\xa9t\xc3\xa9") ||
+	    str_to_title_case(s) ||
+	    strcmp(s->data, "Hello World\tFoo\nBar-Baz It's X_y (3rd) \xc3\xa9t\xc3\xa9"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_charset spaces;
+	str_charset_init(&spaces, " ");
+	str_clear(s);
+	if (str_add(s, "aB-cD eF") || str_to_title_case_set(s, &spaces) ||
+	    strcmp(s->data, "Ab-cd Ef"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Long mixed text, so boundaries fall on every block and lane edge
+	char text[300];
+	char expect[300];
+	struct Str_charset set;
+	str_charset_init(&set, " -.\t");
+	srand(40);
+	for (size_t i = 0; i < sizeof(text) - 1; i++)
+		text[i] = " -.\tAbcXyz\xc3"[rand() % 11];
+	text[sizeof(text) - 1] = '\0';
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		for (size_t len = 1; len < sizeof(text); len += 7) {
+			memcpy(expect, text, len);
+			expect[len] = '\0';
+			title_case_ref(expect, len, &set);
+			str_clear(s);
+			if (str_add(s, expect) || str_to_lower(s) ||
+			    str_to_title_case_set(s, &set) || memcmp(s->data, expect, len + 1)) {
+				str_simd_set_level(best);
+				STR_PRINTERR_CLEAR_AND_RETURN(s);
+			}
+		}
+	}
+	str_simd_set_level(best);
+
+	FINISH_MSG(s, test_str_title_case);
+}
+
+void test_str_transform(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_charset digits, spaces;
+	str_charset_init(&digits, "0123456789");
+	str_charset_init(&spaces, " ");
+	unsigned char dash_to_space[256];
+	for (int c = 0; c < 256; c++)
+		dash_to_space[c] = (unsigned char)(c == '-' ? ' ' : c);
+
+	const struct Str_op ops[] = {
+		{ .type = STR_OP_LOWER },
+		{ .type = STR_OP_DELETE, .set = &digits },
+		{ .type = STR_OP_MAP, .table = dash_to_space },
+		{ .type = STR_OP_SQUEEZE, .set = &spaces },
+		{ .type = STR_OP_TITLE },
+	};
+	if (str_add(s, "HELLO2  wo-rld 42 -- AGAIN") || str_transform(s, ops, 5) ||
+	    strcmp(s->data, "Hello Wo Rld Again") || s->size != 18)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Squeeze before the map sees the dashes, not the spaces they become
+	const struct Str_op order[] = {
+		{ .type = STR_OP_SQUEEZE, .set = &spaces },
+		{ .type = STR_OP_MAP, .table = dash_to_space },
+		{ .type = STR_OP_UPPER },
+	};
+	str_clear(s);
+	if (str_add(s, "a  b--c") || str_transform(s, order, 3) || strcmp(s->data, "A B  C"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	const struct Str_op bad = { .type = STR_OP_DELETE };
+	if (str_transform(s, &bad, 1) != -EINVAL || str_transform(s, NULL, 0) ||
+	    strcmp(s->data, "A B  C"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_transform);
+}
+
+void test_str_translate(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Separators to tabs, digits masked, 0xff to '?'
+	uint8_t table[256];
+	for (int c = 0; c < 256; c++)
+		table[c] = (uint8_t)c;
+	table[','] = table[';'] = '\t';
+	for (int c = '0'; c <= '9'; c++)
+		table[c] = '#';
+	table[0xff] = '?';
+
+	char text[200];
+	char expect[200];
+	for (size_t i = 0; i < sizeof(text) - 1; i++)
+		text[i] = "a,b;1234 \xff"[i % 10];
+	text[sizeof(text) - 1] = '\0';
+	for (size_t i = 0; i < sizeof(text); i++)
+		expect[i] = (char)table[(unsigned char)text[i]];
+
+	struct Str_table *compiled = str_table_compile(table);
+	if (!compiled)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		for (size_t len = 1; len < sizeof(text); len += 5) {
+			const char *tail = text + sizeof(text) - 1 - len;
+			const char *want = expect + sizeof(expect) - 1 - len;
+			str_clear(s);
+			if (str_add(s, tail) || str_translate(s, table) ||
+			    memcmp(s->data, want, len + 1))
+				goto fail;
+			str_clear(s);
+			if (str_add(s, tail) || str_translate_table(s, compiled) ||
+			    memcmp(s->data, want, len + 1))
+				goto fail;
+		}
+	}
+	str_simd_set_level(best);
+	str_table_free(compiled);
+
+	if (str_translate(s, NULL) != -EINVAL || str_table_compile(NULL) || errno != EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_translate);
+	return;
+
+fail:
+	str_simd_set_level(best);
+	str_table_free(compiled);
+	STR_PRINTERR_CLEAR_AND_RETURN(s);
+}
+
+void test_str_trim(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_add(s, " \t hello \n\n  big\r\n world\f \v"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	size_t capacity = s->capacity;
+
+	if (str_trim_right(s) || strcmp(s->data, " \t hello \n\n  big\r\n world"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	if (str_trim_left(s) || strcmp(s->data, "hello \n\n  big\r\n world"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	if (str_squeeze_ws(s) || strcmp(s->data, "hello big world") || s->size != 15 ||
+	    s->capacity != capacity)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Runs that cross the vector blocks, on each kernel
+	char text[300];
+	char expect[300];
+	size_t n = 0;
+	for (size_t i = 0; i < sizeof(text) - 1; i++)
+		text[i] = (i % 37 < 20) ? (char)('a' + i % 26) : " \t\n"[i % 3];
+	text[sizeof(text) - 1] = '\0';
+	for (size_t i = 0; text[i]; i++) {
+		if (i % 37 < 20)
+			expect[n++] = text[i];
+		else if (i % 37 == 20)
+			expect[n++] = ' ';
+	}
+	while (n && expect[n - 1] == ' ')
+		n--;
+	expect[n] = '\0';
+
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		str_clear(s);
+		if (str_add(s, "    ") || str_add(s, text) || str_trim(s) ||
+		    str_squeeze_ws(s) || strcmp(s->data, expect)) {
+			str_simd_set_level(best);
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+		}
+	}
+	str_simd_set_level(best);
+
+	str_clear(s);
+	if (str_add(s, " \t\n ") || str_trim(s) || s->size != 0 || s->data[0])
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_trim);
+}
+
+void test_str_span(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	struct Str_charset ident, bad;
+	str_charset_init(&ident, "abcdefghijklmnopqrstuvwxyz0123456789_");
+	str_charset_init(&bad, "<>\"'&");
+
+	if (str_add(s, "user_name42=<b>bold</b> & \"quoted\""))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	if (str_span(s, &ident) != 11 || str_cspan(s, &bad) != 12 || str_span(s, &bad) != 0)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	if (str_remove_chars(s, &bad, 0) != 7 || strcmp(s->data, "user_name42=bbold/b  quoted") ||
+	    s->capacity != s->size)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Spans and removals ending in every position of the vector blocks
+	char text[300];
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		str_simd_set_level((enum str_simd_level)lv);
+		for (size_t len = 0; len + 5 <= sizeof(text); len += 3) {
+			memset(text, 'a', len);
+			strcpy(text + len, "<x>y");
+			str_clear(s);
+			if (str_add(s, text) || str_span(s, &ident) != len ||
+			    str_cspan(s, &bad) != len ||
+			    str_remove_chars(s, &bad, STR_KEEP_CAPACITY) != 2 ||
+			    s->size != len + 2 || strcmp(s->data + len, "xy")) {
+				str_simd_set_level(best);
+				STR_PRINTERR_CLEAR_AND_RETURN(s);
+			}
+		}
+	}
+	str_simd_set_level(best);
+
+	if (str_remove_chars(s, NULL, 0) != -EINVAL || str_span(s, NULL) != 0)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_span);
+}
+
+void test_str_utf8(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	static const char *const valid[] = {
+		"", "plain", "caf\xc3\xa9", "\xe2\x82\xac 5", "\xf0\x9f\x98\x80",
+		"\xed\x9f\xbf\xee\x80\x80", "\xf4\x8f\xbf\xbf",
+	};
+	static const char *const invalid[] = {
+		"\x80", "\xc0\xaf", "\xc3", "\xe0\x80\xaf", "\xed\xa0\x80",
+		"\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "ab\xe2\x82",
+	};
+
+	for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+		str_clear(s);
+		if (str_add(s, valid[i]) || !str_utf8_validate(s) || s->utf8 != STR_UTF8_VALID)
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		str_clear(s);
+		if (str_add(s, invalid[i]) || str_utf8_validate(s))
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+	}
+
+	// Unicode's example of replacing maximal subparts
+	str_clear(s);
+	if (str_add(s, "\x61\xf1\x80\x80\xe1\x80\xc2\x62\x80\x63\x80\xbf\x64") ||
+	    str_utf8_repair(s) != 6 ||
+	    strcmp(s->data, "a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" "b\xef\xbf\xbd"
+			    "c\xef\xbf\xbd\xef\xbf\xbd" "d") ||
+	    s->utf8 != STR_UTF8_VALID || str_utf8_repair(s) != 0)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Mutations drop the cached result, ASCII case mapping keeps it
+	str_to_upper(s);
+	if (s->utf8 != STR_UTF8_VALID || str_add(s, "\xff") || s->utf8 != STR_UTF8_UNKNOWN ||
+	    str_utf8_validate(s) || s->utf8 != STR_UTF8_INVALID)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// A sequence cut off at or broken across every block position
+	char text[200];
+	enum str_simd_level best = str_simd_get_level();
+	for (int lv = STR_SIMD_SCALAR; lv <= (int)best; lv++) {
+		size_t len;
+		str_simd_set_level((enum str_simd_level)lv);
+		for (len = 0; len + 5 <= sizeof(text); len++) {
+			memset(text, 'a', len);
+			strcpy(text + len, "\xf0\x9f\x98\x80");
+			str_clear(s);
+			if (str_add(s, text) || !str_utf8_validate(s))
+				break;
+			text[len + 3] = '\0';
+			str_clear(s);
+			if (str_add(s, text) || str_utf8_validate(s) || str_utf8_repair(s) != 1 ||
+			    s->size != len + 3 || strcmp(s->data + len, "\xef\xbf\xbd"))
+				break;
+		}
+		if (len + 5 <= sizeof(text)) {
+			str_simd_set_level(best);
+			STR_PRINTERR_CLEAR_AND_RETURN(s);
+		}
+	}
+	str_simd_set_level(best);
+
+	FINISH_MSG(s, test_str_utf8);
+}
+
+void test_str_utf8_case(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Same length in place, then mappings that grow and shrink
+	if (str_add(s, "\xc3\xa9t\xc3\xa9 \xd0\xbc\xd0\xb8\xd1\x80 stra\xc3\x9f" "e") ||
+	    str_utf8_to_upper(s, 0) ||
+	    strcmp(s->data, "\xc3\x89T\xc3\x89 \xd0\x9c\xd0\x98\xd0\xa0 STRASSE") ||
+	    str_utf8_to_lower(s, 0) ||
+	    strcmp(s->data, "\xc3\xa9t\xc3\xa9 \xd0\xbc\xd0\xb8\xd1\x80 strasse"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Title case uses the title case digraph, ill-formed bytes stay
+	str_clear(s);
+	if (str_add(s, "\xc7\x86ungla \xff\xc3\xa9LAN o'neil") ||
+	    str_utf8_to_title_case(s, 0) ||
+	    strcmp(s->data, "\xc7\x85ungla \xff\xc3\xa9lan O'neil"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Dotted and dotless i, with and without the Turkic rules
+	str_clear(s);
+	if (str_add(s, "istanbul D\xc4\xb0YARBAKIR") || str_utf8_to_upper(s, STR_TURKIC) ||
+	    strcmp(s->data, "\xc4\xb0STANBUL D\xc4\xb0YARBAKIR") ||
+	    str_utf8_to_lower(s, STR_TURKIC) ||
+	    strcmp(s->data, "istanbul diyarbak\xc4\xb1r"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "I\xcc\x87 \xc4\xb0") || str_utf8_to_lower(s, STR_TURKIC) ||
+	    strcmp(s->data, "i i") || str_utf8_to_upper(s, 0) || strcmp(s->data, "I I") ||
+	    str_utf8_to_title_case(s, STR_TURKIC) || strcmp(s->data, "I I"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "\xc4\xb0") || str_utf8_to_lower(s, 0) || strcmp(s->data, "i\xcc\x87"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	if (str_utf8_to_upper(s, STR_ICASE) != -EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_utf8_case);
+}
+
+void test_str_utf8_index(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Offsets on both sides of an index sample, and one past the end
+	char text[1200] = "";
+	for (int i = 0; i < 300; i++)
+		strcat(text, (i % 3) ? "a" : "\xd0\xb6");
+	if (str_add(s, text) || str_utf8_length(s) != 300 ||
+	    str_utf8_offset(s, 0) != 0 || str_utf8_offset(s, 1) != 2 ||
+	    str_utf8_offset(s, 256) != 342 || str_utf8_offset(s, 259) != 346 ||
+	    str_utf8_offset(s, 300) != s->size || str_utf8_offset(s, 301) != STR_NPOS)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Edits drop the cached positions
+	size_t size = s->size;
+	if (str_add(s, "\xd0\xb6") || str_utf8_length(s) != 301 ||
+	    str_utf8_offset(s, 300) != size || str_utf8_offset(s, 301) != s->size)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	s->data[0] = 'o';
+	s->data[1] = 'k';
+	str_touch(s);
+	if (str_utf8_length(s) != 302 || str_utf8_offset(s, 2) != 2)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Marks, emoji sequences, flags and CR LF keep their order
+	str_clear(s);
+	if (str_add(s, "ae\xcc\x81\r\n\xf0\x9f\x91\xa9\xe2\x80\x8d\xf0\x9f\x92\xbb"
+		       "\xf0\x9f\x87\xab\xf0\x9f\x87\xb7z") ||
+	    str_utf8_reverse(s) ||
+	    strcmp(s->data, "z\xf0\x9f\x87\xab\xf0\x9f\x87\xb7"
+			    "\xf0\x9f\x91\xa9\xe2\x80\x8d\xf0\x9f\x92\xbb\r\ne\xcc\x81" "a"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_utf8_index);
+}
+
+void test_str_codec(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// RFC 4648 test vectors, appended to what is there
+	const unsigned char bytes[] = { 0x00, 0xde, 0xad, 0xbe, 0xef, 0xff };
+	if (str_add(s, "f") || str_add_base64(s, "fooba", 5) ||
+	    strcmp(s->data, "fZm9vYmE=") || str_add_base64(s, "fo", 2) ||
+	    strcmp(s->data, "fZm9vYmE=Zm8="))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add_hex(s, bytes, sizeof(bytes), 0) || strcmp(s->data, "00deadbeefff") ||
+	    str_add_hex(s, bytes + 1, 2, STR_HEX_UPPER) || strcmp(s->data, "00deadbeefffDEAD"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Long enough for the vector loops, round trip through both
+	unsigned char blob[300];
+	for (size_t i = 0; i < sizeof(blob); i++)
+		blob[i] = (unsigned char)(i * 7 + 3);
+	str_clear(s);
+	if (str_add_hex(s, blob, sizeof(blob), 0) || str_decode_hex(s, 0) ||
+	    s->size != sizeof(blob) || memcmp(s->data, blob, sizeof(blob)))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add_base64(s, blob, sizeof(blob) - 1) || str_decode_base64(s, 0) ||
+	    s->size != sizeof(blob) - 1 || memcmp(s->data, blob, sizeof(blob) - 1))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Malformed input is refused and left alone
+	str_clear(s);
+	if (str_add(s, "Zm9v YmE=") || str_decode_base64(s, 0) != -EINVAL ||
+	    strcmp(s->data, "Zm9v YmE=") || str_decode_hex(s, 0) != -EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "abc") || str_decode_hex(s, 0) != -EINVAL ||
+	    str_add_hex(s, "", 0, STR_ICASE) != -EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_codec);
+}
+
+void test_str_escape(struct Str *s)
+{
+	if (s == NULL || s->data != NULL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Appended in every format, then undone
+	const char *text = "say \"hi\", <b>&</b>\n\x01 caf\xc3\xa9 ~";
+	if (str_add_escaped(s, text, strlen(text), STR_ESC_JSON) ||
+	    strcmp(s->data, "say \\\"hi\\\", <b>&</b>\\n\\u0001 caf\xc3\xa9 ~") ||
+	    str_unescape(s, STR_ESC_JSON, 0) || strcmp(s->data, text))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add_escaped(s, text, strlen(text), STR_ESC_CSV) ||
+	    strcmp(s->data, "\"say \"\"hi\"\", <b>&</b>\n\x01 caf\xc3\xa9 ~\"") ||
+	    str_unescape(s, STR_ESC_CSV, 0) || strcmp(s->data, text))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add_escaped(s, text, strlen(text), STR_ESC_HTML) ||
+	    strcmp(s->data, "say &quot;hi&quot;, &lt;b&gt;&amp;&lt;/b&gt;\n\x01 caf\xc3\xa9 ~") ||
+	    str_unescape(s, STR_ESC_HTML, 0) || strcmp(s->data, text))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "q=") || str_add_escaped(s, text, 9, STR_ESC_URL) ||
+	    strcmp(s->data, "q=say%20%22hi%22%2C") ||
+	    str_unescape(s, STR_ESC_URL, 0) || strcmp(s->data, "q=say \"hi\","))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Plain CSV fields stay unquoted; references and pairs beyond our own
+	str_clear(s);
+	if (str_add_escaped(s, "plain", 5, STR_ESC_CSV) || strcmp(s->data, "plain"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "\\ud83d\\ude00\\/\\u00e9") || str_unescape(s, STR_ESC_JSON, 0) ||
+	    strcmp(s->data, "\xf0\x9f\x98\x80/\xc3\xa9"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "&#x1F600;&#233;&nbsp;&bogus; & &#0;") ||
+	    str_unescape(s, STR_ESC_HTML, 0) ||
+	    strcmp(s->data, "\xf0\x9f\x98\x80\xc3\xa9\xc2\xa0&bogus; & \xef\xbf\xbd"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	// Malformed escapes leave the string alone
+	str_clear(s);
+	if (str_add(s, "ok\\ud800") || str_unescape(s, STR_ESC_JSON, 0) != -EINVAL ||
+	    strcmp(s->data, "ok\\ud800") || str_unescape(s, STR_ESC_URL, 0) ||
+	    str_unescape(s, 4, 0) != -EINVAL)
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+	str_clear(s);
+	if (str_add(s, "100%") || str_unescape(s, STR_ESC_URL, 0) != -EINVAL ||
+	    strcmp(s->data, "100%"))
+		STR_PRINTERR_CLEAR_AND_RETURN(s);
+
+	FINISH_MSG(s, test_str_escape);
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Generate src/str_case_tables.c, the Unicode case mapping tables used by
+str_utf8_to_upper() and friends, from the Unicode database that ships
+with Python.
+
+Each code point below CASE_LIMIT gets a record of three mappings (upper,
+lower, title). A mapping to a single code point is stored as the
+difference to the code point itself, so whole alphabets share a record;
+a mapping to several code points (the unconditional SpecialCasing ones,
+such as U+00DF -> "SS") is marked SPECIAL and listed, sorted by code
+point and mapping, in a separate table that is binary searched.
+
+The records are found through two stages: stage1 maps the block
+(cp >> BLOCK_SHIFT) to one of the distinct blocks in stage2, which
+holds the record index of each code point in it.
+
+Usage: tools/gen_case_tables.py > src/str_case_tables.c
+"""
+
+import sys
+import unicodedata
+
+BLOCK_SHIFT = 7         # STR_CASE_SHIFT in str_simd.h
+BLOCK = 1 << BLOCK_SHIFT
+SPECIAL = 0x200000      # look the mapping up in the special table
+
+
+def mappings(cp):
+    c = chr(cp)
+    return c.upper(), c.lower(), c.title()
+
+
+def main():
+    specials = []
+    records = [(0, 0, 0)]
+    record_index = {(0, 0, 0): 0}
+    per_cp = []
+    last = 0
+
+    for cp in range(0x110000):
+        if 0xd800 <= cp < 0xe000:
+            per_cp.append(0)
+            continue
+        rec = []
+        for kind, m in enumerate(mappings(cp)):
+            if len(m) == 1:
+                rec.append(ord(m) - cp)
+            else:
+                seq = tuple(ord(x) for x in m)
+                assert len(seq) <= 3
+                specials.append((cp, kind) + seq + (0,) * (3 - len(seq)))
+                rec.append(SPECIAL)
+        rec = tuple(rec)
+        if rec != (0, 0, 0):
+            last = cp
+        if rec not in record_index:
+            record_index[rec] = len(records)
+            records.append(rec)
+        per_cp.append(record_index[rec])
+
+    limit = (last // BLOCK + 1) * BLOCK
+    blocks = []
+    block_index = {}
+    stage1 = []
+    for b in range(0, limit, BLOCK):
+        blk = tuple(per_cp[b:b + BLOCK])
+        if blk not in block_index:
+            block_index[blk] = len(blocks)
+            blocks.append(blk)
+        stage1.append(block_index[blk])
+
+    assert len(blocks) <= 256 and len(records) <= 256
+
+    out = sys.stdout
+    w = out.write
+    w("/*\n")
+    w(" * Unicode %s case mapping tables, generated by tools/gen_case_tables.py.\n"
+      % unicodedata.unidata_version)
+    w(" * Do not edit.\n")
+    w(" */\n")
+    w('#include "str_simd.h"\n\n\n')
+    w("const uint32_t str_case_limit = 0x%x;\n\n\n" % limit)
+
+    def array(decl, values, per_line, fmt):
+        w("%s = {\n" % decl)
+        for i in range(0, len(values), per_line):
+            w("\t" + ", ".join(fmt % v for v in values[i:i + per_line]) + ",\n")
+        w("};\n\n\n")
+
+    array("const uint8_t str_case_stage1[%d]" % len(stage1), stage1, 16, "%d")
+    w("const uint8_t str_case_stage2[%d][%d] = {\n" % (len(blocks), BLOCK))
+    for blk in blocks:
+        w("\t{\n")
+        for i in range(0, BLOCK, 16):
+            w("\t\t" + ", ".join("%d" % v for v in blk[i:i + 16]) + ",\n")
+        w("\t},\n")
+    w("};\n\n\n")
+
+    w("const int32_t str_case_records[%d][3] = {\n" % len(records))
+    for r in records:
+        w("\t{ %s },\n" % ", ".join("STR_CASE_SPECIAL" if v == SPECIAL else str(v) for v in r))
+    w("};\n\n\n")
+
+    w("const size_t str_case_nspecial = %d;\n\n" % len(specials))
+    w("const struct str_case_special str_case_special[%d] = {\n" % len(specials))
+    for sp in specials:
+        w("\t{ 0x%04x, %d, { %s } },\n" % (sp[0], sp[1], ", ".join("0x%04x" % v for v in sp[2:])))
+    w("};\n")
+
+    print("records=%d blocks=%d specials=%d limit=0x%x" %
+          (len(records), len(blocks), len(specials), limit), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""
+Generate src/str_grapheme_tables.c, the code point ranges that
+str_utf8_reverse() keeps attached to the character before them, from the
+Unicode database that ships with Python.
+
+Python has no Grapheme_Cluster_Break property, so Extend and SpacingMark
+are approximated by the general categories Mn, Me and Mc, plus the
+emoji modifiers, the tag characters and ZWNJ. The zero width joiner and
+regional indicators have rules of their own in the code.
+
+Usage: tools/gen_grapheme_tables.py > src/str_grapheme_tables.c
+"""
+
+import unicodedata
+
+EXTRA = [
+    (0x200c, 0x200c),       # ZERO WIDTH NON-JOINER
+    (0x1f3fb, 0x1f3ff),     # emoji modifiers
+    (0xe0020, 0xe007f),     # tags
+]
+
+
+def main():
+    cps = set()
+    for cp in range(0x110000):
+        if unicodedata.category(chr(cp)) in ("Mn", "Me", "Mc"):
+            cps.add(cp)
+    for lo, hi in EXTRA:
+        cps.update(range(lo, hi + 1))
+
+    ranges = []
+    for cp in sorted(cps):
+        if ranges and ranges[-1][1] == cp - 1:
+            ranges[-1][1] = cp
+        else:
+            ranges.append([cp, cp])
+
+    print("/*")
+    print(" * Unicode %s grapheme extender ranges, generated by"
+          % unicodedata.unidata_version)
+    print(" * tools/gen_grapheme_tables.py. Do not edit.")
+    print(" */")
+    print('#include "str_simd.h"')
+    print()
+    print()
+    print("const size_t str_extend_nranges = %d;" % len(ranges))
+    print()
+    print()
+    print("const uint32_t str_extend_ranges[%d][2] = {" % len(ranges))
+    for lo, hi in ranges:
+        print("\t{ 0x%05x, 0x%05x }," % (lo, hi))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()